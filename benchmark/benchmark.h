@@ -0,0 +1,122 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Helpers shared by the benchmarks. Benchmarks are plain executables that
+// print their result, they are not run by ctest.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nekit {
+namespace benchmark {
+
+// Parses arguments in the form of `--name=value` or `--flag`.
+class Arguments {
+ public:
+  Arguments(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg.compare(0, 2, "--")) {
+        std::cerr << "Unknown argument " << arg << std::endl;
+        std::exit(1);
+      }
+
+      auto pos = arg.find('=');
+      if (pos == std::string::npos) {
+        values_[arg.substr(2)] = "1";
+      } else {
+        values_[arg.substr(2, pos - 2)] = arg.substr(pos + 1);
+      }
+    }
+  }
+
+  long Int(const std::string& name, long default_value) const {
+    auto iter = values_.find(name);
+    if (iter == values_.end()) {
+      return default_value;
+    }
+    return std::strtol(iter->second.c_str(), nullptr, 10);
+  }
+
+  double Double(const std::string& name, double default_value) const {
+    auto iter = values_.find(name);
+    if (iter == values_.end()) {
+      return default_value;
+    }
+    return std::strtod(iter->second.c_str(), nullptr);
+  }
+
+  bool Flag(const std::string& name) const {
+    return values_.find(name) != values_.end();
+  }
+
+  std::string String(const std::string& name,
+                     const std::string& default_value) const {
+    auto iter = values_.find(name);
+    if (iter == values_.end()) {
+      return default_value;
+    }
+    return iter->second;
+  }
+
+ private:
+  std::map<std::string, std::string> values_;
+};
+
+class Stopwatch {
+ public:
+  Stopwatch() : start_{std::chrono::steady_clock::now()} {}
+
+  void Reset() { start_ = std::chrono::steady_clock::now(); }
+
+  double ElapsedSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+  double ElapsedMicroseconds() const { return ElapsedSeconds() * 1e6; }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+// `samples` is sorted in place. `p` is in [0, 1].
+inline double Percentile(std::vector<double>& samples, double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  auto index = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+  return samples[std::min(index, samples.size() - 1)];
+}
+
+}  // namespace benchmark
+}  // namespace nekit
@@ -0,0 +1,151 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares a `DomainSet` of `domains` random domains with the
+// `std::unordered_set<std::string>` `DomainRule` used to, by the memory
+// allocated to build them and by `lookups` lookups, `hit-rate` of them hits.
+// With `filter` the set gets a Bloom filter of that false positive rate.
+//
+// domain_set_benchmark [--domains=1000000] [--lookups=2000000]
+//     [--hit-rate=0.5] [--filter=0]
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "benchmark.h"
+#include "nekit/utils/domain_set.h"
+
+using namespace nekit;
+
+namespace {
+size_t allocated = 0;
+
+std::string RandomDomain(std::mt19937_64* random) {
+  static const char kLetters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+  static const char* kTlds[] = {".com", ".net", ".org", ".cn", ".io"};
+  std::string domain;
+  size_t length = 4 + (*random)() % 12;
+  for (size_t i = 0; i < length; i++) {
+    domain += kLetters[(*random)() % 36];
+  }
+  return domain + kTlds[(*random)() % 5];
+}
+}  // namespace
+
+// Counts the bytes allocated, the size is kept in front of each block.
+void* operator new(size_t size) {
+  void* block = std::malloc(size + sizeof(max_align_t));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *static_cast<size_t*>(block) = size;
+  allocated += size;
+  return static_cast<char*>(block) + sizeof(max_align_t);
+}
+
+void operator delete(void* pointer) noexcept {
+  if (!pointer) {
+    return;
+  }
+  void* block = static_cast<char*>(pointer) - sizeof(max_align_t);
+  allocated -= *static_cast<size_t*>(block);
+  std::free(block);
+}
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+
+  auto domain_count = static_cast<size_t>(args.Int("domains", 1000000));
+  auto lookup_count = static_cast<size_t>(args.Int("lookups", 2000000));
+  double hit_rate = args.Double("hit-rate", 0.5);
+  double filter = args.Double("filter", 0);
+
+  std::mt19937_64 random{1};
+  std::vector<std::string> domains, lookups;
+  for (size_t i = 0; i < domain_count; i++) {
+    domains.push_back(RandomDomain(&random));
+  }
+  for (size_t i = 0; i < lookup_count; i++) {
+    bool hit = std::uniform_real_distribution<>()(random) < hit_rate;
+    lookups.push_back(hit ? domains[random() % domains.size()]
+                          : RandomDomain(&random));
+  }
+
+  size_t before = allocated;
+  benchmark::Stopwatch stopwatch;
+  utils::DomainSet set;
+  for (const auto& domain : domains) {
+    set.AddDomain(domain);
+  }
+  set.ShrinkToFit();
+  if (filter > 0) {
+    set.BuildFilter(utils::BloomFilter::BitsPerKey(filter));
+  }
+  double set_build = stopwatch.ElapsedSeconds();
+  size_t set_memory = allocated - before;
+
+  before = allocated;
+  stopwatch.Reset();
+  std::unordered_set<std::string> unordered_set;
+  for (const auto& domain : domains) {
+    unordered_set.emplace(domain);
+  }
+  double unordered_build = stopwatch.ElapsedSeconds();
+  size_t unordered_memory = allocated - before;
+
+  stopwatch.Reset();
+  size_t set_hits = 0;
+  for (const auto& lookup : lookups) {
+    set_hits += set.Contains(lookup);
+  }
+  double set_seconds = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  size_t unordered_hits = 0;
+  for (const auto& lookup : lookups) {
+    unordered_hits += unordered_set.count(lookup);
+  }
+  double unordered_seconds = stopwatch.ElapsedSeconds();
+
+  std::cout << "domains: " << domain_count << ", distinct: " << set.size()
+            << std::endl;
+  std::cout << "domain set: build " << set_build * 1e3 << " ms, "
+            << set_memory / 1024 << " KiB, "
+            << lookup_count / set_seconds << " lookups per second, "
+            << set_hits << " hits" << std::endl;
+  std::cout << "unordered set: build " << unordered_build * 1e3 << " ms, "
+            << unordered_memory / 1024 << " KiB, "
+            << lookup_count / unordered_seconds << " lookups per second"
+            << std::endl;
+
+  if (set_hits != unordered_hits) {
+    std::cerr << "Results differ: " << set_hits << " and " << unordered_hits
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,165 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares searching `hosts` random hosts for `expressions` generated
+// expressions with a `RegexSet` and with calling `std::regex_search` on each
+// expression the way `DomainRegexRule` used to. The list scan is much slower,
+// so it is run for `scan-hosts` hosts only.
+//
+// regex_benchmark [--expressions=1000] [--hosts=100000] [--scan-hosts=1000]
+//     [--dfa-states=4096]
+
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "nekit/utils/regex_set.h"
+
+using namespace nekit;
+
+namespace {
+std::string RandomLabel(std::mt19937_64* random) {
+  static const char kLetters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+  std::string label;
+  size_t length = 3 + (*random)() % 8;
+  for (size_t i = 0; i < length; i++) {
+    label += kLetters[(*random)() % 36];
+  }
+  return label;
+}
+
+// The shapes of expressions often seen in rule lists. Saves the domains the
+// first shape matches in `domains`.
+std::string RandomExpression(std::mt19937_64* random,
+                             std::vector<std::string>* domains) {
+  std::string label = RandomLabel(random), other = RandomLabel(random);
+  switch ((*random)() % 6) {
+    case 0:
+      domains->push_back(label + ".com");
+      return "(^|\\.)" + label + "\\.com$";
+    case 1:
+      return "^" + label + "\\d*\\.";
+    case 2:
+      return label + "(ads?|track(er|ing))";
+    case 3:
+      return "^(www\\.)?" + label + "\\." + other + "\\.(net|org)$";
+    case 4:
+      return "\\." + label + "[0-9]{1,3}\\.";
+    default:
+      return label + ".*" + other;
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+
+  auto expression_count = static_cast<size_t>(args.Int("expressions", 1000));
+  auto host_count = static_cast<size_t>(args.Int("hosts", 100000));
+  auto scan_hosts = static_cast<size_t>(args.Int("scan-hosts", 1000));
+  auto dfa_states =
+      static_cast<size_t>(args.Int("dfa-states", NEKIT_REGEX_DFA_STATES));
+
+  std::mt19937_64 random{1};
+  std::vector<std::string> expressions, domains;
+  for (size_t i = 0; i < expression_count; i++) {
+    expressions.push_back(RandomExpression(&random, &domains));
+  }
+
+  // Take some hosts from the expressions so a few of them match.
+  std::vector<std::string> hosts;
+  for (size_t i = 0; i < host_count; i++) {
+    if (i % 20 == 0 && !domains.empty()) {
+      hosts.push_back("www." + domains[random() % domains.size()]);
+      continue;
+    }
+    hosts.push_back(RandomLabel(&random) + "." + RandomLabel(&random) +
+                    (i % 3 ? ".com" : ".net"));
+  }
+
+  benchmark::Stopwatch stopwatch;
+  utils::RegexSet set(true, dfa_states);
+  for (const auto& expression : expressions) {
+    set.Add(expression);
+  }
+  double set_build = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  std::vector<std::regex> list;
+  for (const auto& expression : expressions) {
+    list.emplace_back(expression, std::regex::ECMAScript | std::regex::nosubs |
+                                      std::regex::icase |
+                                      std::regex::optimize);
+  }
+  double list_build = stopwatch.ElapsedSeconds();
+
+  // The first pass builds the DFA.
+  stopwatch.Reset();
+  size_t set_matches = 0;
+  for (const auto& host : hosts) {
+    set_matches += set.Search(host);
+  }
+  double set_cold = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  for (const auto& host : hosts) {
+    set.Search(host);
+  }
+  double set_warm = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  size_t list_matches = 0, set_check = 0;
+  for (size_t i = 0; i < scan_hosts && i < hosts.size(); i++) {
+    for (const auto& regex : list) {
+      if (std::regex_search(hosts[i], regex)) {
+        list_matches++;
+        break;
+      }
+    }
+  }
+  double list_seconds = stopwatch.ElapsedSeconds();
+  for (size_t i = 0; i < scan_hosts && i < hosts.size(); i++) {
+    set_check += set.Search(hosts[i]);
+  }
+
+  std::cout << "expressions: " << expression_count
+            << ", compiled: " << set.compiled_count()
+            << ", fallback: " << set.fallback_count()
+            << ", DFA states: " << set.dfa_state_count() << std::endl;
+  std::cout << "set: build " << set_build * 1e3 << " ms, "
+            << host_count / set_cold << " searches per second cold, "
+            << host_count / set_warm << " warm, " << set_matches
+            << " matched" << std::endl;
+  std::cout << "list: build " << list_build * 1e3 << " ms, "
+            << scan_hosts / list_seconds << " searches per second"
+            << std::endl;
+
+  if (list_matches != set_check) {
+    std::cerr << "Results differ: " << list_matches << " and " << set_check
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,220 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Measures resolution latency and throughput of the resolvers. A fake DNS
+// server runs on its own thread and answers `--domains` names, a fraction of
+// the queries ask for names it does not know and get NXDOMAIN. The clients
+// keep `concurrency` `Endpoint::Resolve` calls in flight until `queries`
+// calls are done. Every resolver gets the same sequence of names. NXDOMAIN
+// answers are counted as failed.
+//
+// `system` goes through `getaddrinfo` which cannot be pointed to the fake
+// server, it resolves numeric addresses instead so only the queue and the
+// threads are measured.
+//
+// resolver_benchmark [--queries=20000] [--concurrency=256] [--domains=1000]
+//     [--nxdomain=0.1] [--loss=0] [--latency=1] [--ttl=300] [--timeout=200]
+//     [--threads=4] [--dual-stack]
+//     [--resolvers=stub,caching,coalescing,caching-coalescing,system]
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/log/core.hpp>
+
+#include "benchmark.h"
+#include "fake_dns_server.h"
+#include "nekit/utils/caching_resolver.h"
+#include "nekit/utils/coalescing_resolver.h"
+#include "nekit/utils/endpoint.h"
+#include "nekit/utils/stub_resolver.h"
+#include "nekit/utils/system_resolver.h"
+
+using namespace nekit;
+using Preference = utils::ResolverInterface::AddressPreference;
+
+namespace {
+
+class Clients {
+ public:
+  Clients(const std::vector<std::string>* names, size_t concurrency,
+          utils::ResolverInterface* resolver, Preference preference)
+      : names_{names},
+        concurrency_{concurrency},
+        resolver_{resolver},
+        preference_{preference} {}
+
+  void Start() {
+    for (size_t i = 0; i < concurrency_ && started_ < names_->size(); i++) {
+      Resolve();
+    }
+  }
+
+  std::vector<double>& resolve_us() { return resolve_us_; }
+  size_t failed() const { return failed_; }
+
+ private:
+  void Resolve() {
+    auto endpoint =
+        std::make_shared<utils::Endpoint>((*names_)[started_++], 80);
+    endpoint->set_resolver(resolver_);
+    endpoint->set_address_preference(preference_);
+    benchmark::Stopwatch stopwatch;
+    (void)endpoint->Resolve([this, endpoint, stopwatch](std::error_code ec) {
+      resolve_us_.push_back(stopwatch.ElapsedMicroseconds());
+      if (ec) {
+        failed_++;
+      }
+
+      if (started_ < names_->size()) {
+        Resolve();
+      }
+    });
+  }
+
+  const std::vector<std::string>* names_;
+  size_t concurrency_;
+  utils::ResolverInterface* resolver_;
+  Preference preference_;
+  size_t started_{0}, failed_{0};
+  std::vector<double> resolve_us_;
+};
+
+std::unique_ptr<utils::ResolverInterface> MakeStub(
+    boost::asio::io_context* io, const boost::asio::ip::udp::endpoint& server,
+    const benchmark::Arguments& args) {
+  auto resolver = std::make_unique<utils::StubResolver>(
+      io, std::vector<boost::asio::ip::udp::endpoint>{server});
+  resolver->set_timeout(std::chrono::milliseconds(args.Int("timeout", 200)));
+  return std::move(resolver);
+}
+
+std::unique_ptr<utils::ResolverInterface> MakeResolver(
+    const std::string& name, boost::asio::io_context* io,
+    const boost::asio::ip::udp::endpoint& server,
+    const benchmark::Arguments& args) {
+  if (name == "stub") {
+    return MakeStub(io, server, args);
+  }
+  if (name == "caching") {
+    return std::make_unique<utils::CachingResolver>(
+        MakeStub(io, server, args), std::make_shared<utils::DnsCache>());
+  }
+  if (name == "coalescing") {
+    return std::make_unique<utils::CoalescingResolver>(
+        MakeStub(io, server, args));
+  }
+  if (name == "caching-coalescing") {
+    return std::make_unique<utils::CachingResolver>(
+        std::make_unique<utils::CoalescingResolver>(
+            MakeStub(io, server, args)),
+        std::make_shared<utils::DnsCache>());
+  }
+  if (name == "system") {
+    auto threads = static_cast<size_t>(args.Int("threads", 4));
+    return std::make_unique<utils::SystemResolver>(io, threads);
+  }
+  return nullptr;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+  // Every NXDOMAIN is logged otherwise.
+  boost::log::core::get()->set_logging_enabled(false);
+
+  auto queries = static_cast<size_t>(args.Int("queries", 20000));
+  auto concurrency = static_cast<size_t>(args.Int("concurrency", 256));
+  auto domains = static_cast<size_t>(args.Int("domains", 1000));
+  auto nxdomain = args.Double("nxdomain", 0.1);
+  auto ttl = static_cast<uint32_t>(args.Int("ttl", 300));
+  auto preference =
+      args.Flag("dual-stack") ? Preference::Any : Preference::IPv4Only;
+
+  boost::asio::io_context server_io;
+  test::FakeDnsServer server{&server_io};
+  server.set_loss(args.Double("loss", 0));
+  server.set_delay(std::chrono::milliseconds(args.Int("latency", 1)));
+  for (size_t i = 0; i < domains; i++) {
+    auto name = "host" + std::to_string(i) + ".bench";
+    server.AddRecord(name, "10.0." + std::to_string(i / 256 % 256) + "." +
+                               std::to_string(i % 256),
+                     ttl);
+    server.AddRecord(name, "2001:db8::" + std::to_string(i % 10000), ttl);
+  }
+
+  // The same sequence for every resolver. `numeric` is the sequence for the
+  // system resolver.
+  std::vector<std::string> names, numeric;
+  std::mt19937 random{1};
+  std::uniform_int_distribution<size_t> pick(0, domains - 1);
+  std::bernoulli_distribution missing(nxdomain);
+  for (size_t i = 0; i < queries; i++) {
+    auto index = pick(random);
+    names.push_back((missing(random) ? "nx" : "host") +
+                    std::to_string(index) + ".bench");
+    numeric.push_back("127.0." + std::to_string(index / 256 % 256) + "." +
+                      std::to_string(index % 256));
+  }
+
+  auto work = boost::asio::make_work_guard(server_io);
+  std::thread server_thread{[&server_io]() { server_io.run(); }};
+
+  std::stringstream resolvers{args.String(
+      "resolvers", "stub,caching,coalescing,caching-coalescing,system")};
+  std::string name;
+  int result = 0;
+  while (std::getline(resolvers, name, ',')) {
+    boost::asio::io_context client_io;
+    auto resolver = MakeResolver(name, &client_io, server.endpoint(), args);
+    if (!resolver) {
+      std::cerr << "Unknown resolver " << name << std::endl;
+      result = 1;
+      continue;
+    }
+
+    Clients clients{name == "system" ? &numeric : &names, concurrency,
+                    resolver.get(), preference};
+    benchmark::Stopwatch stopwatch;
+    clients.Start();
+    client_io.run();
+    double seconds = stopwatch.ElapsedSeconds();
+    resolver->Stop();
+
+    std::cout << name << ": " << queries << " queries, " << clients.failed()
+              << " failed, " << queries / seconds << " queries per second, "
+              << "p50/p99/max (us): "
+              << benchmark::Percentile(clients.resolve_us(), 0.5) << " / "
+              << benchmark::Percentile(clients.resolve_us(), 0.99) << " / "
+              << benchmark::Percentile(clients.resolve_us(), 1) << std::endl;
+  }
+
+  work.reset();
+  server_io.stop();
+  server_thread.join();
+
+  return result;
+}
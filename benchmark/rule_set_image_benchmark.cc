@@ -0,0 +1,186 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares loading `domains` random domains, half of them matching their
+// subdomains too, and `subnets` random IPv4 prefixes from text lists, the way
+// rules are filled one entry at a time, with opening a rule set image of the
+// same lists and mapping them. Then compares `lookups` lookups in the built
+// and the mapped domain sets.
+//
+// rule_set_image_benchmark [--domains=500000] [--subnets=50000]
+//     [--lookups=1000000]
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+
+#include "benchmark.h"
+#include "nekit/rule/rule_set_image.h"
+
+using namespace nekit;
+
+namespace {
+std::string RandomDomain(std::mt19937_64* random) {
+  static const char kLetters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+  static const char* kTlds[] = {".com", ".net", ".org", ".cn", ".io"};
+  std::string domain;
+  size_t length = 4 + (*random)() % 12;
+  for (size_t i = 0; i < length; i++) {
+    domain += kLetters[(*random)() % 36];
+  }
+  return domain + kTlds[(*random)() % 5];
+}
+
+// Reads the lists the way a configuration is loaded without an image.
+void LoadText(const std::string& domain_path, const std::string& subnet_path,
+              utils::DomainSet* domains, utils::SubnetTree* subnets) {
+  std::ifstream domain_file(domain_path);
+  std::string line;
+  while (std::getline(domain_file, line)) {
+    if (line[0] == '.') {
+      domains->AddSuffix(line.substr(1));
+    } else {
+      domains->AddDomain(line);
+    }
+  }
+
+  std::ifstream subnet_file(subnet_path);
+  while (std::getline(subnet_file, line)) {
+    size_t slash = line.find('/');
+    subnets->Insert(boost::asio::ip::make_address(line.substr(0, slash)),
+                    unsigned(std::stoul(line.substr(slash + 1))));
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+
+  auto domain_count = static_cast<size_t>(args.Int("domains", 500000));
+  auto subnet_count = static_cast<size_t>(args.Int("subnets", 50000));
+  auto lookup_count = static_cast<size_t>(args.Int("lookups", 1000000));
+
+  std::string prefix = "/tmp/nekit_rule_set_" + std::to_string(getpid());
+  std::string domain_path = prefix + "_domains.txt";
+  std::string subnet_path = prefix + "_subnets.txt";
+  std::string image_path = prefix + ".bin";
+
+  std::mt19937_64 random{1};
+  std::vector<std::string> lookups;
+  {
+    std::ofstream domain_file(domain_path);
+    for (size_t i = 0; i < domain_count; i++) {
+      std::string domain = RandomDomain(&random);
+      domain_file << (i % 2 ? "." : "") << domain << "\n";
+      if (lookups.size() < lookup_count) {
+        lookups.push_back(i % 2 ? "www." + domain : domain);
+      }
+    }
+    std::ofstream subnet_file(subnet_path);
+    for (size_t i = 0; i < subnet_count; i++) {
+      unsigned length = 16 + random() % 17;
+      subnet_file << boost::asio::ip::address_v4(uint32_t(random())) << "/"
+                  << length << "\n";
+    }
+  }
+  while (lookups.size() < lookup_count) {
+    lookups.push_back(RandomDomain(&random));
+  }
+
+  benchmark::Stopwatch stopwatch;
+  utils::DomainSet built_domains;
+  utils::SubnetTree built_subnets;
+  LoadText(domain_path, subnet_path, &built_domains, &built_subnets);
+  double text_seconds = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  {
+    rule::RuleSetImage::Builder builder;
+    builder.AddDomains("domains", built_domains);
+    builder.AddSubnets("subnets", built_subnets);
+    if (builder.Write(image_path)) {
+      std::cerr << "Can not write " << image_path << "." << std::endl;
+      return 1;
+    }
+  }
+  double write_seconds = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  std::error_code ec;
+  auto image = rule::RuleSetImage::Open(image_path, ec);
+  utils::DomainSet mapped_domains;
+  utils::SubnetTree mapped_subnets;
+  const void* data;
+  size_t size;
+  if (ec || !image->Find("domains", rule::RuleSetImage::Kind::Domains, &data,
+                         &size) ||
+      !mapped_domains.Map(data, size, image) ||
+      !image->Find("subnets", rule::RuleSetImage::Kind::Subnets, &data,
+                   &size) ||
+      !mapped_subnets.Map(data, size, image)) {
+    std::cerr << "Can not load " << image_path << "." << std::endl;
+    return 1;
+  }
+  double map_seconds = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  size_t built_hits = 0;
+  for (const auto& lookup : lookups) {
+    built_hits += built_domains.Contains(lookup);
+  }
+  double built_lookup_seconds = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  size_t mapped_hits = 0;
+  for (const auto& lookup : lookups) {
+    mapped_hits += mapped_domains.Contains(lookup);
+  }
+  double mapped_lookup_seconds = stopwatch.ElapsedSeconds();
+
+  std::cout << "domains: " << built_domains.size()
+            << ", subnets: " << built_subnets.size()
+            << ", image: " << image->size() / 1024 << " KiB" << std::endl;
+  std::cout << "text: load " << text_seconds * 1e3 << " ms, "
+            << (built_domains.memory_usage() + built_subnets.memory_usage()) /
+                   1024
+            << " KiB, " << lookup_count / built_lookup_seconds
+            << " lookups per second, " << built_hits << " hits" << std::endl;
+  std::cout << "image: write " << write_seconds * 1e3 << " ms, load "
+            << map_seconds * 1e3 << " ms, "
+            << (mapped_domains.memory_usage() +
+                mapped_subnets.memory_usage()) /
+                   1024
+            << " KiB, " << lookup_count / mapped_lookup_seconds
+            << " lookups per second, " << mapped_hits << " hits" << std::endl;
+
+  std::remove(domain_path.c_str());
+  std::remove(subnet_path.c_str());
+  std::remove(image_path.c_str());
+  return 0;
+}
@@ -0,0 +1,144 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares looking up addresses in `prefixes` random prefixes with a
+// `SubnetTree` and with scanning a vector of `Subnet` the way `SubnetRule`
+// used to. A tenth of the prefixes are IPv6. The scan is much slower, so it is
+// run for `scan-lookups` addresses only. With `filter` the tree gets a Bloom
+// filter of that false positive rate. With `host-routes` all prefixes are
+// single addresses, like an IP blocklist.
+//
+// subnet_benchmark [--prefixes=100000] [--lookups=1000000]
+//     [--scan-lookups=1000] [--filter=0] [--host-routes]
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+#include "nekit/utils/subnet.h"
+#include "nekit/utils/subnet_tree.h"
+
+using namespace nekit;
+using boost::asio::ip::address;
+
+namespace {
+address RandomAddress(std::mt19937_64* random, bool v6) {
+  if (!v6) {
+    return boost::asio::ip::address_v4(uint32_t((*random)()));
+  }
+
+  boost::asio::ip::address_v6::bytes_type bytes;
+  uint64_t high = (*random)(), low = (*random)();
+  for (size_t i = 0; i < 8; i++) {
+    bytes[i] = uint8_t(high >> (8 * i));
+    bytes[i + 8] = uint8_t(low >> (8 * i));
+  }
+  // Keep the addresses in 2000::/4 so they are close to each other.
+  bytes[0] = 0x20 | (bytes[0] & 0x0F);
+  return boost::asio::ip::address_v6(bytes);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+
+  auto prefixes = static_cast<size_t>(args.Int("prefixes", 100000));
+  auto lookups = static_cast<size_t>(args.Int("lookups", 1000000));
+  auto scan_lookups = static_cast<size_t>(args.Int("scan-lookups", 1000));
+  double filter = args.Double("filter", 0);
+  bool host_routes = args.Flag("host-routes");
+
+  std::mt19937_64 random{1};
+  std::vector<std::pair<address, unsigned>> blocks;
+  for (size_t i = 0; i < prefixes; i++) {
+    bool v6 = i % 10 == 9;
+    // Most routes are between /16 and /24, or /32 and /48 for IPv6.
+    unsigned prefix = v6 ? 32 + random() % 17 : 16 + random() % 9;
+    if (host_routes) {
+      prefix = v6 ? 128 : 32;
+    }
+    blocks.emplace_back(RandomAddress(&random, v6), prefix);
+  }
+
+  std::vector<address> addresses;
+  for (size_t i = 0; i < lookups; i++) {
+    addresses.push_back(RandomAddress(&random, i % 10 == 9));
+  }
+
+  benchmark::Stopwatch stopwatch;
+  utils::SubnetTree tree;
+  for (const auto& block : blocks) {
+    tree.Insert(block.first, block.second);
+  }
+  tree.ShrinkToFit();
+  if (filter > 0) {
+    tree.BuildFilter(utils::BloomFilter::BitsPerKey(filter));
+  }
+  double tree_build = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  std::vector<utils::Subnet> subnets;
+  for (const auto& block : blocks) {
+    subnets.emplace_back(block.first, block.second);
+  }
+  double scan_build = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  size_t tree_matches = 0;
+  for (const auto& address : addresses) {
+    tree_matches += tree.Contains(address);
+  }
+  double tree_seconds = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  size_t scan_matches = 0, tree_check = 0;
+  for (size_t i = 0; i < scan_lookups && i < addresses.size(); i++) {
+    for (const auto& subnet : subnets) {
+      if (subnet.Contains(addresses[i])) {
+        scan_matches++;
+        break;
+      }
+    }
+  }
+  double scan_seconds = stopwatch.ElapsedSeconds();
+  for (size_t i = 0; i < scan_lookups && i < addresses.size(); i++) {
+    tree_check += tree.Contains(addresses[i]);
+  }
+
+  std::cout << "prefixes: " << prefixes << ", distinct: " << tree.size()
+            << std::endl;
+  std::cout << "tree: build " << tree_build * 1e3 << " ms, "
+            << tree.memory_usage() / 1024 << " KiB, "
+            << lookups / tree_seconds << " lookups per second, "
+            << tree_matches << " matched" << std::endl;
+  std::cout << "scan: build " << scan_build * 1e3 << " ms, "
+            << scan_lookups / scan_seconds << " lookups per second"
+            << std::endl;
+
+  if (scan_matches != tree_check) {
+    std::cerr << "Results differ: " << scan_matches << " and " << tree_check
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,164 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Measures how fast a `TcpListener` takes new connections. The listener runs
+// on its own thread and drops every accepted socket right away, the clients
+// keep `concurrency` connects in flight until `connections` connects are done.
+// A small backlog shows up as a long connect tail since the kernel drops SYNs
+// once the accept queue is full.
+//
+// tcp_accept_benchmark [--port=16181] [--connections=20000]
+//     [--concurrency=512] [--backlog=N] [--accepts=1]
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "benchmark.h"
+#include "nekit/transport/tcp_listener.h"
+
+using namespace nekit;
+using boost::asio::ip::tcp;
+
+namespace {
+
+class Clients {
+ public:
+  Clients(boost::asio::io_context* io, uint16_t port, size_t connections,
+          size_t concurrency)
+      : io_{io},
+        endpoint_{boost::asio::ip::address_v4::loopback(), port},
+        connections_{connections},
+        concurrency_{concurrency} {}
+
+  void Start() {
+    for (size_t i = 0; i < concurrency_ && started_ < connections_; i++) {
+      Connect();
+    }
+  }
+
+  bool Done() const { return finished_ == connections_; }
+
+  std::vector<double>& connect_us() { return connect_us_; }
+  size_t failed() const { return failed_; }
+
+ private:
+  void Connect() {
+    started_++;
+    auto socket = std::make_shared<tcp::socket>(*io_);
+    benchmark::Stopwatch stopwatch;
+    socket->async_connect(endpoint_, [this, socket, stopwatch](
+                                         const boost::system::error_code& ec) {
+      finished_++;
+      if (ec) {
+        failed_++;
+      } else {
+        connect_us_.push_back(stopwatch.ElapsedMicroseconds());
+        // Reset instead of close so the client ports do not pile up in
+        // TIME_WAIT.
+        boost::system::error_code error;
+        socket->set_option(tcp::socket::linger(true, 0), error);
+        socket->close(error);
+      }
+
+      if (started_ < connections_) {
+        Connect();
+      }
+    });
+  }
+
+  boost::asio::io_context* io_;
+  tcp::endpoint endpoint_;
+  size_t connections_, concurrency_, started_{0}, finished_{0}, failed_{0};
+  std::vector<double> connect_us_;
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+
+  auto port = static_cast<uint16_t>(args.Int("port", 16181));
+  auto connections = static_cast<size_t>(args.Int("connections", 20000));
+  auto concurrency = static_cast<size_t>(args.Int("concurrency", 512));
+
+  boost::asio::io_context server_io;
+  std::atomic<size_t> accepted{0};
+  transport::TcpListener listener{
+      &server_io,
+      [](std::unique_ptr<data_flow::LocalDataFlowInterface>&& data_flow) {
+        return std::move(data_flow);
+      }};
+  if (args.Flag("backlog")) {
+    listener.set_backlog(static_cast<int>(args.Int("backlog", 0)));
+  }
+  listener.set_concurrent_accepts(static_cast<size_t>(args.Int("accepts", 1)));
+
+  auto ec = listener.Bind("127.0.0.1", port);
+  if (ec) {
+    std::cerr << "Failed to bind listener: " << ec.message() << std::endl;
+    return 1;
+  }
+  listener.Accept(
+      [&accepted](std::unique_ptr<data_flow::LocalDataFlowInterface>&&,
+                  std::error_code ec) {
+        if (!ec) {
+          accepted++;
+        }
+      });
+
+  auto work = boost::asio::make_work_guard(server_io);
+  std::thread server_thread{[&server_io]() { server_io.run(); }};
+
+  boost::asio::io_context client_io;
+  Clients clients{&client_io, port, connections, concurrency};
+  benchmark::Stopwatch stopwatch;
+  clients.Start();
+  client_io.run();
+  double seconds = stopwatch.ElapsedSeconds();
+
+  // Connects complete once the connection is queued, give the listener a
+  // moment to take the rest.
+  benchmark::Stopwatch grace;
+  while (accepted < connections - clients.failed() &&
+         grace.ElapsedSeconds() < 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  boost::asio::post(server_io, [&listener]() { listener.Close(); });
+  work.reset();
+  server_thread.join();
+
+  std::cout << "connections: " << connections
+            << ", failed: " << clients.failed()
+            << ", accepted: " << accepted << std::endl;
+  std::cout << "connections per second: "
+            << (connections - clients.failed()) / seconds << std::endl;
+  std::cout << "connect p50/p99/max (us): "
+            << benchmark::Percentile(clients.connect_us(), 0.5) << " / "
+            << benchmark::Percentile(clients.connect_us(), 0.99) << " / "
+            << benchmark::Percentile(clients.connect_us(), 1) << std::endl;
+
+  return clients.failed() ? 1 : 0;
+}
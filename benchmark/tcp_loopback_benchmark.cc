@@ -0,0 +1,312 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Measures the effect of `TcpOptions` over loopback. The server is a
+// `TcpListener` echoing everything back, the clients connect with
+// `TcpConnector`. Each client measures the connect time, the round trip time
+// of a request sent in two writes (which exposes Nagle's algorithm) and the
+// throughput of echoing a bulk payload.
+//
+// tcp_loopback_benchmark [--port=16180] [--connections=16] [--rounds=1000]
+//     [--message_size=256] [--bulk_size=16777216] [--no_delay]
+//     [--rcvbuf=N] [--sndbuf=N] [--lowat=N] [--keep_alive] [--fast_open]
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "benchmark.h"
+#include "nekit/transport/tcp_connector.h"
+#include "nekit/transport/tcp_listener.h"
+#include "nekit/transport/tcp_options.h"
+
+using namespace nekit;
+using boost::asio::ip::tcp;
+
+namespace {
+const size_t kChunkSize = 65536;
+
+class EchoServer {
+ public:
+  EchoServer(boost::asio::io_context* io,
+             std::shared_ptr<const transport::TcpOptions> options)
+      : listener_{io, [](std::unique_ptr<data_flow::LocalDataFlowInterface>&&
+                             data_flow) { return std::move(data_flow); }} {
+    listener_.set_tcp_options(options);
+  }
+
+  bool Start(uint16_t port) {
+    auto ec = listener_.Bind("127.0.0.1", port);
+    if (ec) {
+      std::cerr << "Failed to bind listener: " << ec.message() << std::endl;
+      return false;
+    }
+
+    listener_.Accept(
+        [this](std::unique_ptr<data_flow::LocalDataFlowInterface>&& data_flow,
+               std::error_code ec) {
+          if (ec) {
+            return;
+          }
+
+          auto flow = data_flow.get();
+          flows_.emplace_back(std::move(data_flow));
+          (void)flow->Open([flow](std::error_code ec) {
+            if (ec) {
+              return;
+            }
+            (void)flow->Continue([flow](std::error_code ec) {
+              if (ec) {
+                return;
+              }
+              Echo(flow);
+            });
+          });
+        });
+    return true;
+  }
+
+  void Stop() {
+    listener_.Close();
+    flows_.clear();
+  }
+
+ private:
+  static void Echo(data_flow::LocalDataFlowInterface* flow) {
+    (void)flow->Read(
+        std::make_unique<utils::Buffer>(kChunkSize),
+        [flow](std::unique_ptr<utils::Buffer>&& buffer, std::error_code ec) {
+          if (ec) {
+            return;
+          }
+
+          (void)flow->Write(std::move(buffer), [flow](std::error_code ec) {
+            if (ec) {
+              return;
+            }
+            Echo(flow);
+          });
+        });
+  }
+
+  transport::TcpListener listener_;
+  std::vector<std::unique_ptr<data_flow::LocalDataFlowInterface>> flows_;
+};
+
+struct Result {
+  std::vector<double> connect_us, rtt_us;
+  size_t bulk_bytes{0};
+  double bulk_seconds{0};
+  size_t finished{0}, failed{0};
+};
+
+class Client {
+ public:
+  Client(boost::asio::io_context* io, uint16_t port,
+         std::shared_ptr<const transport::TcpOptions> options,
+         const benchmark::Arguments& args, Result* result)
+      : connector_{boost::asio::ip::address_v4::loopback(), port, io},
+        socket_{*io},
+        rounds_{static_cast<size_t>(args.Int("rounds", 1000))},
+        message_size_{static_cast<size_t>(args.Int("message_size", 256))},
+        bulk_size_{static_cast<size_t>(args.Int("bulk_size", 16 << 20))},
+        send_buffer_(kChunkSize, 'x'),
+        receive_buffer_(kChunkSize),
+        result_{result} {
+    connector_.set_tcp_options(options);
+    if (options->fast_open) {
+      // Otherwise the connector does not use TCP Fast Open.
+      connector_.set_attempt_timeout(std::chrono::milliseconds(0));
+      connector_.set_connect_timeout(std::chrono::milliseconds(0));
+    }
+  }
+
+  void Start() {
+    stopwatch_.Reset();
+    cancelable_ =
+        connector_.Connect([this](tcp::socket&& socket, std::error_code ec) {
+          if (ec) {
+            std::cerr << "Failed to connect: " << ec.message() << std::endl;
+            result_->failed++;
+            return;
+          }
+
+          result_->connect_us.push_back(stopwatch_.ElapsedMicroseconds());
+          socket_ = std::move(socket);
+          Round();
+        });
+  }
+
+ private:
+  void Round() {
+    if (round_ == rounds_) {
+      stopwatch_.Reset();
+      Bulk();
+      return;
+    }
+
+    stopwatch_.Reset();
+    // Send the header and the body separately like a naive protocol does.
+    size_t header = std::min<size_t>(8, message_size_);
+    boost::asio::async_write(
+        socket_, boost::asio::buffer(send_buffer_.data(), header),
+        [this, header](const boost::system::error_code& ec, size_t) {
+          if (ec) {
+            return Fail(ec);
+          }
+
+          boost::asio::async_write(
+              socket_,
+              boost::asio::buffer(send_buffer_.data(), message_size_ - header),
+              [this](const boost::system::error_code& ec, size_t) {
+                if (ec) {
+                  return Fail(ec);
+                }
+              });
+
+          boost::asio::async_read(
+              socket_,
+              boost::asio::buffer(receive_buffer_.data(), message_size_),
+              [this](const boost::system::error_code& ec, size_t) {
+                if (ec) {
+                  return Fail(ec);
+                }
+
+                result_->rtt_us.push_back(stopwatch_.ElapsedMicroseconds());
+                round_++;
+                Round();
+              });
+        });
+  }
+
+  void Bulk() {
+    if (sent_ < bulk_size_) {
+      size_t size = std::min(kChunkSize, bulk_size_ - sent_);
+      boost::asio::async_write(
+          socket_, boost::asio::buffer(send_buffer_.data(), size),
+          [this](const boost::system::error_code& ec, size_t bytes) {
+            if (ec) {
+              return Fail(ec);
+            }
+            sent_ += bytes;
+            Bulk();
+          });
+    }
+
+    if (!receiving_) {
+      receiving_ = true;
+      ReceiveBulk();
+    }
+  }
+
+  void ReceiveBulk() {
+    socket_.async_read_some(
+        boost::asio::buffer(receive_buffer_),
+        [this](const boost::system::error_code& ec, size_t bytes) {
+          if (ec) {
+            return Fail(ec);
+          }
+
+          received_ += bytes;
+          if (received_ == bulk_size_) {
+            result_->bulk_bytes += bulk_size_;
+            result_->bulk_seconds += stopwatch_.ElapsedSeconds();
+            result_->finished++;
+            boost::system::error_code error;
+            socket_.close(error);
+            return;
+          }
+          ReceiveBulk();
+        });
+  }
+
+  void Fail(const boost::system::error_code& ec) {
+    std::cerr << "Client failed: " << ec.message() << std::endl;
+    result_->failed++;
+  }
+
+  transport::TcpConnector connector_;
+  tcp::socket socket_;
+  utils::Cancelable cancelable_;
+
+  size_t rounds_, round_{0}, message_size_, bulk_size_, sent_{0},
+      received_{0};
+  bool receiving_{false};
+  std::vector<char> send_buffer_, receive_buffer_;
+
+  benchmark::Stopwatch stopwatch_;
+  Result* result_;
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+
+  auto options = std::make_shared<transport::TcpOptions>();
+  options->no_delay = args.Flag("no_delay");
+  options->receive_buffer_size = args.Int("rcvbuf", 0);
+  options->send_buffer_size = args.Int("sndbuf", 0);
+  options->not_sent_low_water_mark = args.Int("lowat", 0);
+  options->keep_alive = args.Flag("keep_alive");
+  options->fast_open = args.Flag("fast_open");
+
+  auto port = static_cast<uint16_t>(args.Int("port", 16180));
+  auto connections = static_cast<size_t>(args.Int("connections", 16));
+
+  boost::asio::io_context io;
+  EchoServer server{&io, options};
+  if (!server.Start(port)) {
+    return 1;
+  }
+
+  Result result;
+  std::vector<std::unique_ptr<Client>> clients;
+  for (size_t i = 0; i < connections; i++) {
+    clients.emplace_back(
+        std::make_unique<Client>(&io, port, options, args, &result));
+    clients.back()->Start();
+  }
+
+  while (result.finished + result.failed < connections) {
+    io.run_one();
+  }
+
+  server.Stop();
+
+  std::cout << "connections: " << connections << ", failed: " << result.failed
+            << std::endl;
+  std::cout << "connect p50/p99 (us): "
+            << benchmark::Percentile(result.connect_us, 0.5) << " / "
+            << benchmark::Percentile(result.connect_us, 0.99) << std::endl;
+  std::cout << "rtt p50/p99 (us): " << benchmark::Percentile(result.rtt_us, 0.5)
+            << " / " << benchmark::Percentile(result.rtt_us, 0.99)
+            << std::endl;
+  if (result.bulk_seconds > 0) {
+    std::cout << "bulk echo throughput per connection (MiB/s): "
+              << result.bulk_bytes / result.bulk_seconds / (1 << 20)
+              << std::endl;
+  }
+
+  return result.failed ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares matching `lookups` random hosts against `suffixes` random domain
+// suffixes with a `CompactTrie` and with the `ReverseDomainTrie`
+// `DomainSuffixRule` used to. The memory of the latter is estimated from its
+// node count since it does not track it.
+//
+// trie_benchmark [--suffixes=50000] [--lookups=1000000]
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "nekit/utils/compact_trie.h"
+#include "nekit/utils/trie.h"
+
+using namespace nekit;
+
+namespace {
+std::string RandomLabel(std::mt19937_64* random) {
+  static const char kLetters[] = "abcdefghijklmnopqrstuvwxyz0123456789-";
+  std::string label;
+  size_t length = 3 + (*random)() % 10;
+  for (size_t i = 0; i < length; i++) {
+    label += kLetters[(*random)() % 36];
+  }
+  return label;
+}
+
+// Mirrors the node of `utils::Trie` for the domain alphabet.
+struct TrieNodeLayout {
+  std::array<std::unique_ptr<TrieNodeLayout>, 78> nodes;
+  bool end;
+};
+
+const char* kTlds[] = {".com", ".net", ".org", ".cn", ".io", ".co.uk"};
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Arguments args(argc, argv);
+
+  auto suffix_count = static_cast<size_t>(args.Int("suffixes", 50000));
+  auto lookups = static_cast<size_t>(args.Int("lookups", 1000000));
+
+  std::mt19937_64 random{1};
+  std::vector<std::string> suffixes;
+  for (size_t i = 0; i < suffix_count; i++) {
+    std::string suffix = RandomLabel(&random) + kTlds[random() % 6];
+    // Half of the rules match subdomains only.
+    suffixes.push_back(i % 2 ? "." + suffix : suffix);
+  }
+
+  // Every fifth host is under a listed suffix.
+  std::vector<std::string> hosts;
+  for (size_t i = 0; i < lookups; i++) {
+    if (i % 5 == 0) {
+      hosts.push_back("www" + suffixes[random() % suffixes.size()]);
+    } else {
+      hosts.push_back("www." + RandomLabel(&random) + kTlds[random() % 6]);
+    }
+  }
+
+  benchmark::Stopwatch stopwatch;
+  utils::CompactTrie compact_trie(true);
+  for (const auto& suffix : suffixes) {
+    compact_trie.AddPrefix(suffix);
+  }
+  compact_trie.Build();
+  double compact_build = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  utils::ReverseDomainTrie trie;
+  for (const auto& suffix : suffixes) {
+    trie.AddPrefix(suffix);
+  }
+  double trie_build = stopwatch.ElapsedSeconds();
+
+  // `Trie` has a node for every distinct reversed prefix of the suffixes.
+  std::set<std::string> prefixes;
+  for (const auto& suffix : suffixes) {
+    for (size_t i = 1; i <= suffix.size(); i++) {
+      prefixes.insert(suffix.substr(suffix.size() - i));
+    }
+  }
+  size_t trie_memory = (prefixes.size() + 1) * sizeof(TrieNodeLayout);
+
+  stopwatch.Reset();
+  size_t compact_matches = 0;
+  for (const auto& host : hosts) {
+    compact_matches += compact_trie.MatchPrefixWith(host);
+  }
+  double compact_seconds = stopwatch.ElapsedSeconds();
+
+  stopwatch.Reset();
+  size_t trie_matches = 0;
+  for (const auto& host : hosts) {
+    trie_matches += trie.MatchPrefixWith(host);
+  }
+  double trie_seconds = stopwatch.ElapsedSeconds();
+
+  std::cout << "suffixes: " << suffix_count << std::endl;
+  std::cout << "compact: build " << compact_build * 1e3 << " ms, "
+            << compact_trie.node_count() << " nodes, "
+            << compact_trie.memory_usage() / 1024 << " KiB, "
+            << lookups / compact_seconds << " lookups per second, "
+            << compact_matches << " matched" << std::endl;
+  std::cout << "trie: build " << trie_build * 1e3 << " ms, "
+            << prefixes.size() + 1 << " nodes, " << trie_memory / 1024
+            << " KiB, " << lookups / trie_seconds << " lookups per second"
+            << std::endl;
+
+  if (compact_matches != trie_matches) {
+    std::cerr << "Results differ: " << compact_matches << " and "
+              << trie_matches << std::endl;
+    return 1;
+  }
+  return 0;
+}
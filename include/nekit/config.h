@@ -41,3 +41,127 @@
 #ifndef NEKIT_HTTP_HEADER_MAX_FIELD
 #define NEKIT_HTTP_HEADER_MAX_FIELD 100
 #endif
+
+// Timeout of connecting to one resolved address in milliseconds. The connector
+// will try the next address when it expires. Set it to 0 to rely on the OS.
+#ifndef NEKIT_TCP_CONNECT_ATTEMPT_TIMEOUT
+#define NEKIT_TCP_CONNECT_ATTEMPT_TIMEOUT 5000
+#endif
+
+// Timeout of the whole connect process in milliseconds, including resolving
+// and trying every address. Set it to 0 to disable the deadline.
+#ifndef NEKIT_TCP_CONNECT_TIMEOUT
+#define NEKIT_TCP_CONNECT_TIMEOUT 15000
+#endif
+
+// The maximum number of connections a TCP listener accepts synchronously after
+// an asynchronous accept completes, before going back to the event loop.
+#ifndef NEKIT_TCP_LISTENER_MAX_DRAIN
+#define NEKIT_TCP_LISTENER_MAX_DRAIN 64
+#endif
+
+// Pooled upstream TCP connections are closed after being idle for this long in
+// milliseconds. It should be shorter than the idle timeout of the upstream.
+#ifndef NEKIT_TCP_POOL_IDLE_TIMEOUT
+#define NEKIT_TCP_POOL_IDLE_TIMEOUT 30000
+#endif
+
+// The number of entries kept by a DNS cache.
+#ifndef NEKIT_DNS_CACHE_SIZE
+#define NEKIT_DNS_CACHE_SIZE 4096
+#endif
+
+// Bounds in seconds on how long a resolved result is cached. The default TTL is
+// used when the resolver does not know the TTL of the records.
+#ifndef NEKIT_DNS_CACHE_MIN_TTL
+#define NEKIT_DNS_CACHE_MIN_TTL 5
+#endif
+
+#ifndef NEKIT_DNS_CACHE_MAX_TTL
+#define NEKIT_DNS_CACHE_MAX_TTL 3600
+#endif
+
+#ifndef NEKIT_DNS_CACHE_DEFAULT_TTL
+#define NEKIT_DNS_CACHE_DEFAULT_TTL 60
+#endif
+
+// How long in seconds a name known not to exist, or to have no address, is
+// cached.
+#ifndef NEKIT_DNS_CACHE_NEGATIVE_TTL
+#define NEKIT_DNS_CACHE_NEGATIVE_TTL 10
+#endif
+
+// How long in seconds a failure reported by the DNS server is cached. Other
+// failures, such as timeouts, are not cached.
+#ifndef NEKIT_DNS_CACHE_FAILURE_TTL
+#define NEKIT_DNS_CACHE_FAILURE_TTL 1
+#endif
+
+// How long in milliseconds the stub resolver waits for one DNS server before
+// retrying, and how many times each server is tried.
+#ifndef NEKIT_DNS_TIMEOUT
+#define NEKIT_DNS_TIMEOUT 2000
+#endif
+
+#ifndef NEKIT_DNS_ATTEMPTS
+#define NEKIT_DNS_ATTEMPTS 2
+#endif
+
+// When both address families are queried, how long in milliseconds to wait for
+// the other family after the preferred one has answered.
+#ifndef NEKIT_DNS_DUAL_STACK_GRACE
+#define NEKIT_DNS_DUAL_STACK_GRACE 50
+#endif
+
+// A cached domain is resolved again in background when it is looked up in the
+// last tenth of its TTL, if it has been looked up at least this many times.
+#ifndef NEKIT_DNS_PREFETCH_MIN_HITS
+#define NEKIT_DNS_PREFETCH_MIN_HITS 3
+#endif
+
+// The maximum number of background resolutions per second.
+#ifndef NEKIT_DNS_PREFETCH_RATE
+#define NEKIT_DNS_PREFETCH_RATE 10
+#endif
+
+// The maximum number of lookups waiting for a system resolver thread, more
+// lookups fail immediately.
+#ifndef NEKIT_SYSTEM_RESOLVER_QUEUE_SIZE
+#define NEKIT_SYSTEM_RESOLVER_QUEUE_SIZE 256
+#endif
+
+// How long in milliseconds a lookup of the system resolver can take, including
+// the time it waits in the queue.
+#ifndef NEKIT_SYSTEM_RESOLVER_TIMEOUT
+#define NEKIT_SYSTEM_RESOLVER_TIMEOUT 5000
+#endif
+
+// How long in milliseconds an idle system resolver thread is kept above the
+// minimum thread count.
+#ifndef NEKIT_SYSTEM_RESOLVER_IDLE_TIMEOUT
+#define NEKIT_SYSTEM_RESOLVER_IDLE_TIMEOUT 30000
+#endif
+
+// The number of hosts whose matched rule is cached by the rule manager, when
+// the cache is enabled.
+#ifndef NEKIT_RULE_DECISION_CACHE_SIZE
+#define NEKIT_RULE_DECISION_CACHE_SIZE 4096
+#endif
+
+// The maximum number of DFA states a regex set caches. The cache is flushed and
+// built again when it is full.
+#ifndef NEKIT_REGEX_DFA_STATES
+#define NEKIT_REGEX_DFA_STATES 4096
+#endif
+
+// The false positive rate of the Bloom filters in front of the domain and
+// subnet tables of the rule index, when they are enabled.
+#ifndef NEKIT_RULE_PREFILTER_FALSE_POSITIVE_RATE
+#define NEKIT_RULE_PREFILTER_FALSE_POSITIVE_RATE 0.01
+#endif
+
+// One in this many evaluations of each rule is timed when the rule manager
+// profiles the rules.
+#ifndef NEKIT_RULE_PROFILE_SAMPLE_INTERVAL
+#define NEKIT_RULE_PROFILE_SAMPLE_INTERVAL 16
+#endif
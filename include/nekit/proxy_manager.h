@@ -22,9 +22,13 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
+
 #include "transport/listener_interface.h"
 #include "transport/tunnel.h"
 #include "utils/async_io_interface.h"
+#include "utils/dns_cache.h"
 #include "utils/resolver_interface.h"
 
 namespace nekit {
@@ -33,6 +37,20 @@ class ProxyManager : public utils::AsyncIoInterface {
   void SetRuleManager(std::unique_ptr<rule::RuleManager> &&rule_manager);
   void SetResolver(std::unique_ptr<utils::ResolverInterface> &&resolver);
   void AddListener(std::unique_ptr<transport::ListenerInterface> &&listener);
+  // `cache` is warmed from the snapshot at `path` when running and saved to
+  // it when stopped. If the decision cache of the rule manager is enabled and
+  // `rule_set_tag` is not zero, the rule decisions are saved too and loaded
+  // back if the tag matches. The tag must change whenever the rules change,
+  // publishing rules with the same tag keeps the loaded decisions.
+  void SetWarmSnapshot(std::shared_ptr<utils::DnsCache> cache,
+                       const std::string &path, uint64_t rule_set_tag = 0);
+
+  // Replaces the rules without stopping, see `RuleManager::Publish`. Tunnels
+  // already matching finish with the old rules. `rule_set_tag` replaces the
+  // one given to `SetWarmSnapshot`. It can be called from any thread, the
+  // manager must be alive until the rules are swapped on its thread.
+  void PublishRules(std::shared_ptr<const rule::RuleSnapshot> snapshot,
+                    uint64_t rule_set_tag = 0);
 
   void Run();
   void Stop();
@@ -42,11 +60,21 @@ class ProxyManager : public utils::AsyncIoInterface {
 
  private:
   bool CheckOrSetIo(utils::AsyncIoInterface *io_interface);
+  void LoadWarmSnapshot();
+  // Gives the decisions of the warm snapshot to the decision cache if they
+  // are made with the current rules.
+  bool RestoreDecisions();
+  void SaveWarmSnapshot();
 
   std::unique_ptr<rule::RuleManager> rule_manager_;
   std::unique_ptr<utils::ResolverInterface> resolver_;
   std::vector<std::unique_ptr<transport::ListenerInterface>> listeners_;
   transport::TunnelManager tunnel_manager_;
+  std::shared_ptr<utils::DnsCache> dns_cache_;
+  std::string snapshot_path_;
+  // Null until loaded.
+  std::shared_ptr<const utils::WarmSnapshot> warm_snapshot_;
+  uint64_t rule_set_tag_{0};
 
   boost::asio::io_context *io_{nullptr};
 };
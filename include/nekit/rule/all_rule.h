@@ -31,6 +31,7 @@ class AllRule : public RuleInterface {
   explicit AllRule(RuleHandler);
 
   MatchResult Match(std::shared_ptr<utils::Session> session) override;
+  bool DependsOnResolution() const override { return false; }
   std::unique_ptr<data_flow::RemoteDataFlowInterface> GetDataFlow(
       std::shared_ptr<utils::Session> session) override;
 
@@ -0,0 +1,85 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+
+#include "../config.h"
+#include "../utils/warm_snapshot.h"
+
+namespace nekit {
+namespace rule {
+
+// A LRU cache of the position of the rule matched for a host, or
+// `RuleIndex::kNoMatch` if no rule matches. Entries missing from the cache are
+// looked up in the snapshot if one is set.
+class DecisionCache : private boost::noncopyable {
+ public:
+  struct Statistics {
+    uint64_t hits;
+    uint64_t misses;
+    // Misses answered by the snapshot.
+    uint64_t snapshot_hits;
+    // Decisions that depend on the resolution of the domain.
+    uint64_t uncacheable;
+  };
+
+  explicit DecisionCache(size_t capacity = NEKIT_RULE_DECISION_CACHE_SIZE);
+
+  bool Lookup(const std::string& key, uint32_t* position);
+  void Insert(const std::string& key, uint32_t position);
+  void RecordUncacheable() { statistics_.uncacheable++; }
+
+  // Also drops the snapshot, its positions are of the rules it was saved
+  // with. Logs the decisions dropped that way.
+  void Clear();
+
+  void set_snapshot(std::shared_ptr<const utils::WarmSnapshot> snapshot) {
+    snapshot_ = snapshot;
+  }
+
+  utils::WarmSnapshot::Decisions Decisions() const;
+
+  size_t size() const { return entries_.size(); }
+  const Statistics& statistics() const { return statistics_; }
+  double hit_ratio() const;
+
+ private:
+  using List = std::list<std::pair<std::string, uint32_t>>;
+
+  size_t capacity_;
+  // The most recently used entry is at front.
+  List list_;
+  std::unordered_map<std::string, List::iterator> entries_;
+  std::shared_ptr<const utils::WarmSnapshot> snapshot_;
+  Statistics statistics_{0, 0, 0, 0};
+};
+}  // namespace rule
+}  // namespace nekit
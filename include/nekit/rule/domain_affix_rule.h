@@ -22,30 +22,45 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
 #include <type_traits>
 
 #include <boost/assert.hpp>
 
-#include "../utils/trie.h"
+#include "../utils/compact_trie.h"
 #include "rule_interface.h"
+#include "rule_set_image.h"
 
 namespace nekit {
 namespace rule {
 template <bool reverse>
 class DomainAffixRule : public RuleInterface {
  public:
-  explicit DomainAffixRule(RuleHandler handler) : handler_{handler} {}
+  explicit DomainAffixRule(RuleHandler handler)
+      : trie_{reverse}, handler_{handler} {}
 
-  template <typename = std::enable_if_t<!reverse>>
+  template <bool r = reverse, typename = std::enable_if_t<!r>>
   void AddPrefix(const std::string& prefix) {
     trie_.AddPrefix(prefix);
   }
 
-  template <typename = std::enable_if_t<reverse>>
+  template <bool r = reverse, typename = std::enable_if_t<r>>
   void AddSuffix(const std::string& suffix) {
     trie_.AddPrefix(suffix);
   }
 
+  // Replaces the affixes with the list `name` of `image`, see
+  // `DomainRule::Load`. The list must hold prefixes for a prefix rule and
+  // suffixes for a suffix rule.
+  bool Load(std::shared_ptr<const RuleSetImage> image,
+            const std::string& name) {
+    const void* data;
+    size_t size;
+    return image->Find(name, RuleSetImage::Kind::Trie, &data, &size) &&
+           trie_.Map(data, size, std::move(image));
+  }
+
   MatchResult Match(std::shared_ptr<utils::Session> session) override {
     BOOST_ASSERT(session->endpoint());
 
@@ -60,6 +75,24 @@ class DomainAffixRule : public RuleInterface {
     }
   }
 
+  RuleIndex::Kind AddToIndex(RuleIndex* index, uint32_t position) override {
+    if (trie_.mapped()) {
+      trie_.Build();
+      return RuleIndex::Kind::Dynamic;
+    }
+
+    for (const auto& affix : trie_.entries()) {
+      if (reverse) {
+        index->AddSuffix(affix, position);
+      } else {
+        index->AddPrefix(affix, position);
+      }
+    }
+    return RuleIndex::Kind::Domain;
+  }
+
+  bool DependsOnResolution() const override { return false; }
+
   std::unique_ptr<data_flow::RemoteDataFlowInterface> GetDataFlow(
       std::shared_ptr<utils::Session> session) override {
     BOOST_ASSERT(session->endpoint());
@@ -68,7 +101,7 @@ class DomainAffixRule : public RuleInterface {
   }
 
  private:
-  utils::DomainTrie<reverse> trie_;
+  utils::CompactTrie trie_;
 
   RuleHandler handler_;
 };
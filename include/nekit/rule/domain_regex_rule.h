@@ -22,10 +22,12 @@
 
 #pragma once
 
-#include <regex>
-#include <vector>
+#include <memory>
+#include <string>
 
+#include "../utils/regex_set.h"
 #include "rule_interface.h"
+#include "rule_set_image.h"
 
 namespace nekit {
 namespace rule {
@@ -35,12 +37,20 @@ class DomainRegexRule : public RuleInterface {
 
   bool AddRegex(const std::string &expression);
 
+  // Adds the expressions of the list `name` of `image`. They are compiled
+  // here, only their parsing from text is saved. Returns `false` if there is
+  // no such valid list.
+  bool Load(std::shared_ptr<const RuleSetImage> image, const std::string &name);
+
   MatchResult Match(std::shared_ptr<utils::Session> session) override;
+  RuleIndex::Kind AddToIndex(RuleIndex *index, uint32_t position) override;
+  bool DependsOnResolution() const override { return false; }
   std::unique_ptr<data_flow::RemoteDataFlowInterface> GetDataFlow(
       std::shared_ptr<utils::Session> session) override;
 
  private:
-  std::vector<std::regex> regex_list_;
+  // All expressions are searched in one pass, see `utils::RegexSet`.
+  utils::RegexSet regex_set_{true};
 
   RuleHandler handler_;
 };
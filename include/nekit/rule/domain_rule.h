@@ -22,9 +22,12 @@
 
 #pragma once
 
-#include <unordered_set>
+#include <memory>
+#include <string>
 
+#include "../utils/domain_set.h"
 #include "rule_interface.h"
+#include "rule_set_image.h"
 
 namespace nekit {
 namespace rule {
@@ -33,13 +36,22 @@ class DomainRule : public RuleInterface {
   explicit DomainRule(RuleHandler handler);
 
   void AddDomain(const std::string &domain);
+  // Matches `domain` and all its subdomains.
+  void AddSuffix(const std::string &domain);
+
+  // Replaces the domains with the list `name` of `image`, used in place. A
+  // loaded rule is matched by `Match` instead of being copied into the index.
+  // Returns `false` if there is no such valid list.
+  bool Load(std::shared_ptr<const RuleSetImage> image, const std::string &name);
 
   MatchResult Match(std::shared_ptr<utils::Session> session) override;
+  RuleIndex::Kind AddToIndex(RuleIndex *index, uint32_t position) override;
+  bool DependsOnResolution() const override { return false; }
   std::unique_ptr<data_flow::RemoteDataFlowInterface> GetDataFlow(
       std::shared_ptr<utils::Session> session) override;
 
  private:
-  std::unordered_set<std::string> domains_;
+  utils::DomainSet domains_;
 
   RuleHandler handler_;
 };
@@ -0,0 +1,89 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include <boost/asio/ip/address.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "../utils/compact_trie.h"
+#include "../utils/domain_set.h"
+#include "../utils/subnet_tree.h"
+
+namespace nekit {
+namespace rule {
+// Merges the entries of the rules whose result only depends on the domain or
+// the address into one index. A lookup returns the lowest position of the
+// rules that match, so one lookup replaces matching those rules in turn.
+//
+// Domains are compared ignoring ASCII case, as `utils::DomainSet` does, for
+// both exact and subdomain matches. Prefixes and suffixes are case sensitive
+// as they are in the affix rules.
+class RuleIndex : private boost::noncopyable {
+ public:
+  // How a rule is matched by `RuleManager`.
+  enum class Kind {
+    // `Match` is called.
+    Dynamic,
+    // Matched by `MatchDomain`, never matches an address endpoint.
+    Domain,
+    // Matched by `MatchAddress`, needs the domain resolved first.
+    Address
+  };
+
+  static constexpr uint32_t kNoMatch = std::numeric_limits<uint32_t>::max();
+
+  void AddDomain(const std::string& domain, uint32_t rule);
+  // Matches `domain` and all its subdomains, see `utils::DomainSet`.
+  void AddDomainSuffix(const std::string& domain, uint32_t rule);
+  void AddPrefix(const std::string& prefix, uint32_t rule);
+  void AddSuffix(const std::string& suffix, uint32_t rule);
+  void AddSubnet(const boost::asio::ip::address& address, unsigned prefix,
+                 uint32_t rule);
+
+  // Builds the prefix and suffix tries. Called after all rules are added and
+  // before matching.
+  void Build();
+
+  // Adds Bloom filters to the domain and subnet tables, see
+  // `utils::BloomFilter`. Called after all rules are added.
+  void BuildFilters(double bits_per_key);
+
+  uint32_t MatchDomain(const std::string& domain) const;
+  uint32_t MatchAddress(const boost::asio::ip::address& address) const;
+
+ private:
+  static void Lower(uint32_t* current, uint32_t rule);
+
+  utils::DomainSet domains_;
+  // The value of each affix is the lowest rule adding it.
+  utils::CompactTrie prefixes_{false}, suffixes_{true};
+  // Each prefix keeps the lowest rule, all prefixes on the path of the
+  // address are visited.
+  utils::SubnetTree subnets_;
+};
+}  // namespace rule
+}  // namespace nekit
@@ -29,6 +29,7 @@
 #include "../data_flow/remote_data_flow_interface.h"
 #include "../utils/session.h"
 #include "match_result.h"
+#include "rule_index.h"
 
 namespace nekit {
 namespace rule {
@@ -45,6 +46,20 @@ class RuleInterface : private boost::noncopyable {
   virtual ~RuleInterface() = default;
 
   virtual MatchResult Match(std::shared_ptr<utils::Session> session) = 0;
+
+  // Rules that `RuleIndex` can match add their entries as the rule at
+  // `position` and return how they are matched, `Match` is not called then.
+  // Other rules build what `Match` needs here, so it can be called from
+  // several threads. The rule must not be changed afterwards.
+  virtual RuleIndex::Kind AddToIndex(RuleIndex* index, uint32_t position) {
+    (void)index;
+    (void)position;
+    return RuleIndex::Kind::Dynamic;
+  }
+
+  // Whether the result for a domain may change once it is resolved. Such
+  // results are not cached by `RuleManager`.
+  virtual bool DependsOnResolution() const { return true; }
   virtual std::unique_ptr<data_flow::RemoteDataFlowInterface> GetDataFlow(
       std::shared_ptr<utils::Session> session) = 0;
 };
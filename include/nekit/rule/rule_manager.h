@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <system_error>
@@ -32,10 +33,20 @@
 #include "../utils/async_io_interface.h"
 #include "../utils/cancelable.h"
 #include "../utils/resolver_interface.h"
+#include "decision_cache.h"
+#include "rule_index.h"
 #include "rule_interface.h"
+#include "rule_profile.h"
+#include "rule_snapshot.h"
 
 namespace nekit {
 namespace rule {
+// Returns the first rule that matches the session. Rules that `RuleIndex`
+// supports are matched together by one lookup, the others are asked in turn.
+//
+// The rules are matched from an immutable `RuleSnapshot`, so they can be
+// replaced while tunnels are running. A match started before keeps using the
+// snapshot it started with, including after waiting for resolution.
 class RuleManager final : public utils::AsyncIoInterface,
                           private utils::LifeTime {
  public:
@@ -46,8 +57,53 @@ class RuleManager final : public utils::AsyncIoInterface,
 
   explicit RuleManager(boost::asio::io_context* io);
 
+  // The rule is matched by a new snapshot, see `Compile`.
   void AppendRule(std::shared_ptr<RuleInterface> rule);
 
+  // Builds a snapshot of the rules. It is done by the first `Match` after a
+  // rule is appended if it is not called.
+  void Compile();
+
+  // Replaces the rules with those of `snapshot`, e.g., one built for the
+  // managers of all threads. It can be called from any thread, the snapshot
+  // is only swapped on the thread running `io()`, at once if it is the
+  // calling thread or else by a posted handler, so matching never takes a
+  // lock. The manager must be alive until then. Later `AppendRule` calls
+  // append to the rules of `snapshot`.
+  void Publish(std::shared_ptr<const RuleSnapshot> snapshot);
+
+  // Compiles first if needed.
+  std::shared_ptr<const RuleSnapshot> snapshot();
+
+  // Caches the matched rule by host, or by address for address endpoints.
+  // Decisions that depend on the resolution of the domain are not cached. The
+  // cache is cleared when a rule is appended.
+  void EnableDecisionCache(size_t capacity = NEKIT_RULE_DECISION_CACHE_SIZE);
+  DecisionCache* decision_cache() { return decision_cache_.get(); }
+
+  // Puts a Bloom filter in front of the domain and subnet tables of the index
+  // so most hosts matching none of them skip the tables. A lower
+  // `false_positive_rate` takes more memory, about 10 bits per entry at 1%.
+  // Takes effect when the index is built.
+  void EnablePrefilter(
+      double false_positive_rate = NEKIT_RULE_PREFILTER_FALSE_POSITIVE_RATE);
+
+  // Starts resolving the domain of a session as soon as it is matched, while
+  // the rules that only need the domain are tried. Address rules and the
+  // connector then wait for that resolution instead of starting their own.
+  // Domains of sessions that end up proxied or rejected are resolved too,
+  // which costs queries and tells the resolver about them.
+  void EnableSpeculativeResolution() { speculative_resolution_ = true; }
+
+  // Counts for each rule how often it matches, does not match or asks for
+  // resolution, and times one in `sample_interval` of its evaluations with
+  // the steady clock. Counting restarts whenever the rules change. A decision
+  // served by the decision cache counts as a match of its rule.
+  void EnableProfiling(
+      unsigned sample_interval = NEKIT_RULE_PROFILE_SAMPLE_INTERVAL);
+  // Empty unless profiling, see `SuggestRuleOrder` to make use of it.
+  std::vector<RuleProfile> Profile() const;
+
   utils::Cancelable Match(std::shared_ptr<utils::Session> session,
                           EventHandler handler)
       __attribute__((warn_unused_result));
@@ -55,12 +111,56 @@ class RuleManager final : public utils::AsyncIoInterface,
   boost::asio::io_context* io() override;
 
  private:
-  void MatchIterator(
-      std::vector<std::shared_ptr<RuleInterface>>::const_iterator iter,
-      std::shared_ptr<utils::Session> session, utils::Cancelable cancelable,
-      EventHandler handler);
-
+  using Snapshot = std::shared_ptr<const RuleSnapshot>;
+  // The wait of a match for the resolution of its domain, canceled with the
+  // match.
+  using ResolutionWait = std::shared_ptr<utils::Cancelable>;
+
+  struct Counters {
+    uint64_t matches;
+    uint64_t not_matches;
+    uint64_t resolve_needed;
+    uint64_t samples;
+    std::chrono::nanoseconds sampled_time;
+  };
+
+  // The counters of the rules of `snapshot`, null if they are not counted.
+  Counters* CountersOf(const Snapshot& snapshot) {
+    return profiling_ && snapshot == snapshot_ ? counters_.data() : nullptr;
+  }
+  MatchResult ProfileMatch(RuleInterface* rule,
+                           std::shared_ptr<utils::Session> session,
+                           Counters* counters);
+
+  void Swap(Snapshot snapshot);
+
+  // `cache` is whether the decision can be cached if it does not depend on
+  // resolution.
+  void MatchFrom(Snapshot snapshot, size_t position, bool cache,
+                 std::shared_ptr<utils::Session> session,
+                 utils::Cancelable cancelable, ResolutionWait wait,
+                 EventHandler handler);
+  void Decide(const Snapshot& snapshot, size_t position, bool cache,
+              std::shared_ptr<utils::Session> session, EventHandler handler);
+
+  static std::string DecisionKey(utils::Endpoint* endpoint);
+  void ResolveAndMatchFrom(Snapshot snapshot, size_t position,
+                           std::shared_ptr<utils::Session> session,
+                           utils::Cancelable cancelable, ResolutionWait wait,
+                           EventHandler handler);
+
+  // The rules of the next snapshot.
   std::vector<std::shared_ptr<RuleInterface>> rules_;
+  // Null until compiled after a change.
+  Snapshot snapshot_;
+  std::unique_ptr<DecisionCache> decision_cache_;
+  // 0 if the prefilter is disabled.
+  double prefilter_bits_per_key_{0};
+  bool speculative_resolution_{false};
+  bool profiling_{false};
+  unsigned sample_interval_{1};
+  // Of the rules of `snapshot_`, by position.
+  std::vector<Counters> counters_;
   boost::asio::io_context* io_;
 };
 
@@ -0,0 +1,78 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rule_interface.h"
+
+namespace nekit {
+namespace rule {
+
+// What `RuleManager` observed of a rule while profiling, see
+// `RuleManager::EnableProfiling`.
+struct RuleProfile {
+  std::shared_ptr<RuleInterface> rule;
+  // Matched by `RuleIndex` instead of `Match`. Only its matches and the
+  // resolutions it asks for are counted, and it costs nothing on its own.
+  bool indexed;
+  uint64_t matches;
+  uint64_t not_matches;
+  uint64_t resolve_needed;
+  // The evaluations that are timed and how long they take in total.
+  uint64_t samples;
+  std::chrono::nanoseconds sampled_time;
+
+  uint64_t evaluations() const {
+    return matches + not_matches + resolve_needed;
+  }
+  // Zero if no evaluation is timed.
+  std::chrono::nanoseconds mean_time() const {
+    return samples ? sampled_time / int64_t(samples)
+                   : std::chrono::nanoseconds(0);
+  }
+};
+
+// Whether the rule before can be moved after the other without changing a
+// decision, e.g., they lead to the same proxy or their lists are disjoint.
+using CanSwap = std::function<bool(const RuleInterface& before,
+                                   const RuleInterface& after)>;
+
+// Returns the positions of the rules in a suggested order. A rule is moved
+// before another if it matches more of the sessions it is evaluated for per
+// unit of time it takes, which is the order that takes the least time if
+// rules do not overlap, and only past rules `can_swap` allows.
+std::vector<size_t> SuggestRuleOrder(const std::vector<RuleProfile>& profiles,
+                                     const CanSwap& can_swap);
+
+// A table of the profiles with the suggested position of each rule.
+std::string RuleProfileReport(const std::vector<RuleProfile>& profiles,
+                              const CanSwap& can_swap);
+}  // namespace rule
+}  // namespace nekit
@@ -0,0 +1,97 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "../utils/compact_trie.h"
+#include "../utils/domain_set.h"
+#include "../utils/subnet_tree.h"
+
+namespace nekit {
+namespace rule {
+
+// A binary file of named rule lists compiled ahead of time, e.g., by
+// `rule_compiler`, so a rule loads a large list without parsing it.
+//
+// Domain sets, tries and subnet trees are saved with their arrays as they are
+// in memory and only refer to each other by index, so a loaded rule uses them
+// in place in the mapped file and processes mapping the same file share its
+// pages. Only the header and the list table are checked when the file is
+// opened, a list is checked when it is loaded. Regular expressions are kept as
+// strings and compiled when loaded. The file is written in native byte order
+// and rejected on a host with a different one.
+class RuleSetImage : private boost::noncopyable {
+ public:
+  enum class Kind : uint32_t { Domains = 1, Trie, Subnets, Regexes };
+
+  // Collects the lists of an image. A list added with the name of an earlier
+  // one replaces it.
+  class Builder {
+   public:
+    void AddDomains(const std::string& name, const utils::DomainSet& domains);
+    // Prefixes, or suffixes if the trie is reversed.
+    void AddTrie(const std::string& name, utils::CompactTrie* trie);
+    void AddSubnets(const std::string& name, const utils::SubnetTree& subnets);
+    void AddRegexes(const std::string& name,
+                    const std::vector<std::string>& expressions);
+
+    // The file is replaced atomically.
+    std::error_code Write(const std::string& path) const;
+
+   private:
+    std::map<std::string, std::pair<Kind, std::string>> lists_;
+  };
+
+  ~RuleSetImage();
+
+  static std::shared_ptr<const RuleSetImage> Open(const std::string& path,
+                                                  std::error_code& ec);
+
+  // Returns `false` if there is no list of `kind` named `name`. The list is
+  // 8 byte aligned and valid while the image is.
+  bool Find(const std::string& name, Kind kind, const void** data,
+            size_t* size) const;
+
+  bool ReadRegexes(const std::string& name,
+                   std::vector<std::string>* expressions) const;
+
+  size_t list_count() const;
+  size_t size() const { return size_; }
+
+ private:
+  RuleSetImage(const uint8_t* data, size_t size);
+
+  const uint8_t* data_;
+  size_t size_;
+};
+}  // namespace rule
+}  // namespace nekit
@@ -0,0 +1,77 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "rule_index.h"
+#include "rule_interface.h"
+
+namespace nekit {
+namespace rule {
+
+// An immutable list of rules with their index. `RuleManager` matches against
+// one snapshot at a time and replaces it as a whole, a match started before
+// keeps the snapshot it started with alive until it finishes.
+//
+// A snapshot can be published to the managers of several threads. Rules build
+// what they match with when added to the index, and a `DomainRegexRule` builds
+// a DFA for each thread, so matching never changes what the threads share.
+class RuleSnapshot : private boost::noncopyable {
+ public:
+  // Builds the index of `rules`, which must not be changed afterwards. See
+  // `RuleManager::EnablePrefilter` for `prefilter_bits_per_key`, 0 disables
+  // the prefilter.
+  explicit RuleSnapshot(std::vector<std::shared_ptr<RuleInterface>> rules,
+                        double prefilter_bits_per_key = 0);
+
+  const std::vector<std::shared_ptr<RuleInterface>>& rules() const {
+    return rules_;
+  }
+  size_t size() const { return rules_.size(); }
+  const RuleIndex& index() const { return index_; }
+  RuleIndex::Kind kind(size_t position) const { return kinds_[position]; }
+
+  // The position of the first dynamic rule from `position`, the size of the
+  // snapshot if there is none.
+  size_t next_dynamic(size_t position) const {
+    return next_dynamic_[position];
+  }
+  // Same as `next_dynamic` for address rules.
+  size_t next_address(size_t position) const {
+    return next_address_[position];
+  }
+
+ private:
+  std::vector<std::shared_ptr<RuleInterface>> rules_;
+  RuleIndex index_;
+  std::vector<RuleIndex::Kind> kinds_;
+  std::vector<size_t> next_dynamic_;
+  std::vector<size_t> next_address_;
+};
+}  // namespace rule
+}  // namespace nekit
@@ -22,31 +22,32 @@
 
 #pragma once
 
-#include <utility>
-#include <vector>
+#include <memory>
+#include <string>
 
-#include "../utils/subnet.h"
+#include "../utils/subnet_tree.h"
 #include "rule_interface.h"
+#include "rule_set_image.h"
 
 namespace nekit {
 namespace rule {
-// TODO: Current implementation is far from efficient. The subnet block should
-// be stored in binary tree to be looked up in O(log n) time and overrlapping
-// and contiguous blocks should be merged.
 class SubnetRule : public RuleInterface {
  public:
   SubnetRule(RuleHandler handler);
 
   void AddSubnet(const boost::asio::ip::address &address, uint prefix);
 
+  // Replaces the subnets with the list `name` of `image`, see
+  // `DomainRule::Load`.
+  bool Load(std::shared_ptr<const RuleSetImage> image, const std::string &name);
+
   MatchResult Match(std::shared_ptr<utils::Session> session) override;
+  RuleIndex::Kind AddToIndex(RuleIndex *index, uint32_t position) override;
   std::unique_ptr<data_flow::RemoteDataFlowInterface> GetDataFlow(
       std::shared_ptr<utils::Session> session) override;
 
  private:
-  bool LookUp(const boost::asio::ip::address &address);
-
-  std::vector<utils::Subnet> subnets_;
+  utils::SubnetTree subnets_;
 
   RuleHandler handler_;
 };
@@ -0,0 +1,137 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <boost/asio.hpp>
+
+#include "../config.h"
+#include "../utils/cancelable.h"
+#include "../utils/endpoint.h"
+#include "../utils/resolver_interface.h"
+#include "tcp_connector.h"
+#include "tcp_options.h"
+
+namespace nekit {
+namespace transport {
+
+// Keeps a few established connections to fixed upstream endpoints so that a
+// tunnel to them can skip the handshake. The pool only takes endpoints that are
+// added explicitly, it refills itself in background after a connection is
+// taken, broken or expired.
+//
+// Upstreams are not supposed to send anything before the client does, so any
+// readable event on an idle connection means it is closed or unusable.
+class TcpConnectionPool : private utils::LifeTime {
+ public:
+  struct Statistics {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t expired;
+    uint64_t broken;
+  };
+
+  // `resolver` is used to resolve domain endpoints, it must outlive the pool.
+  TcpConnectionPool(boost::asio::io_context* io,
+                    utils::ResolverInterface* resolver, size_t size);
+  ~TcpConnectionPool();
+
+  // Must be set before `Add`. `fast_open` is cleared since a pooled connection
+  // has to be established to be of any use.
+  void set_tcp_options(std::shared_ptr<const TcpOptions> options);
+
+  // Must be set before `Add`. Zero disables expiration.
+  void set_idle_timeout(std::chrono::milliseconds timeout) {
+    idle_timeout_ = timeout;
+  }
+
+  // Starts keeping connections to `host:port`.
+  void Add(const std::string& host, uint16_t port);
+
+  // Moves the most recently established connection to `endpoint` into
+  // `socket` and returns `true` if there is one. Expired connections are
+  // dropped on the way.
+  bool Take(const utils::Endpoint& endpoint,
+            boost::asio::ip::tcp::socket* socket);
+
+  // Closes every pooled connection and stops refilling.
+  void Close();
+
+  Statistics statistics() const { return statistics_; }
+
+  size_t IdleCount(const std::string& host, uint16_t port) const;
+
+ private:
+  struct Connection {
+    explicit Connection(boost::asio::ip::tcp::socket&& socket)
+        : socket{std::move(socket)},
+          since{std::chrono::steady_clock::now()} {}
+
+    boost::asio::ip::tcp::socket socket;
+    std::chrono::steady_clock::time_point since;
+    bool removed{false};
+  };
+
+  struct Connecting {
+    std::unique_ptr<TcpConnector> connector;
+    utils::Cancelable cancelable;
+  };
+
+  struct Pool {
+    std::string host;
+    uint16_t port;
+    // The most recently established connection is at back.
+    std::list<std::shared_ptr<Connection>> idle;
+    std::list<Connecting> connectors;
+    bool failed{false};
+  };
+
+  static std::string Key(const std::string& host, uint16_t port);
+  static bool IsHealthy(boost::asio::ip::tcp::socket& socket);
+
+  void Refill(Pool* pool);
+  void Watch(Pool* pool, std::shared_ptr<Connection> connection);
+  void Remove(Pool* pool, std::shared_ptr<Connection> connection);
+  void Expire(Pool* pool, std::chrono::steady_clock::time_point now);
+  void ScheduleSweep();
+  void Sweep();
+
+  boost::asio::io_context* io_;
+  utils::ResolverInterface* resolver_;
+  size_t size_;
+  std::chrono::milliseconds idle_timeout_{NEKIT_TCP_POOL_IDLE_TIMEOUT};
+  std::shared_ptr<const TcpOptions> tcp_options_;
+
+  std::unordered_map<std::string, std::unique_ptr<Pool>> pools_;
+  boost::asio::steady_timer sweep_timer_;
+  bool sweeping_{false}, closed_{false};
+  Statistics statistics_{0, 0, 0, 0};
+};
+
+}  // namespace transport
+}  // namespace nekit
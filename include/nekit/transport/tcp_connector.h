@@ -22,13 +22,16 @@
 
 #pragma once
 
+#include <chrono>
 #include <vector>
 
 #include <boost/asio.hpp>
 
+#include "../config.h"
 #include "../utils/cancelable.h"
 #include "../utils/device.h"
 #include "../utils/endpoint.h"
+#include "tcp_options.h"
 
 namespace nekit {
 namespace transport {
@@ -38,6 +41,18 @@ class TcpConnector : public utils::AsyncIoInterface, private utils::LifeTime {
   using EventHandler =
       std::function<void(boost::asio::ip::tcp::socket&&, std::error_code)>;
 
+  // Counters shared by all connectors. They can be read from any thread.
+  struct Statistics {
+    uint64_t attempts;
+    uint64_t connected;
+    // One address did not respond in time and the next one was tried.
+    uint64_t attempt_timeouts;
+    // The whole connect process did not finish before the deadline.
+    uint64_t deadline_timeouts;
+    uint64_t refused;
+    uint64_t other_failures;
+  };
+
   TcpConnector(const boost::asio::ip::address& address, uint16_t port,
                boost::asio::io_context* io);
 
@@ -48,29 +63,59 @@ class TcpConnector : public utils::AsyncIoInterface, private utils::LifeTime {
   TcpConnector(std::shared_ptr<utils::Endpoint> endpoint,
                boost::asio::io_context* io);
 
+  ~TcpConnector();
+
   utils::Cancelable Connect(EventHandler handler)
       __attribute__((warn_unused_result));
 
   void Bind(std::shared_ptr<utils::DeviceInterface> device);
 
+  // Must be set before calling `Connect`. `fast_open` is ignored unless both
+  // timeouts are disabled.
+  void set_tcp_options(std::shared_ptr<const TcpOptions> options) {
+    tcp_options_ = options;
+  }
+
+  // Zero disables the timeout. Must be set before calling `Connect`.
+  void set_attempt_timeout(std::chrono::milliseconds timeout) {
+    attempt_timeout_ = timeout;
+  }
+  void set_connect_timeout(std::chrono::milliseconds timeout) {
+    connect_timeout_ = timeout;
+  }
+
   boost::asio::io_context* io() override;
 
+  static Statistics GetStatistics();
+
  private:
+  void StartDeadline(EventHandler handler);
   void DoConnect(EventHandler handler);
+  // Moves on to the next address after the socket failed to open or bind.
+  void TryNext(EventHandler handler);
+  void Finish(EventHandler handler, std::error_code ec);
 
   boost::asio::ip::tcp::socket socket_;
   std::shared_ptr<const std::vector<boost::asio::ip::address>> addresses_;
   boost::asio::ip::address address_;
   std::shared_ptr<utils::Endpoint> endpoint_;
+  // Of the wait for `endpoint_` to be resolved.
+  utils::Cancelable resolve_cancelable_;
 
   uint16_t port_;
   std::shared_ptr<utils::DeviceInterface> device_;
+  std::shared_ptr<const TcpOptions> tcp_options_;
 
   std::error_code last_error_;
 
   std::size_t current_ind_{0};
 
-  bool connecting_{false};
+  boost::asio::steady_timer attempt_timer_, deadline_timer_;
+  std::chrono::milliseconds attempt_timeout_{
+      NEKIT_TCP_CONNECT_ATTEMPT_TIMEOUT},
+      connect_timeout_{NEKIT_TCP_CONNECT_TIMEOUT};
+
+  bool connecting_{false}, attempt_timed_out_{false}, finished_{false};
 };
 
 }  // namespace transport
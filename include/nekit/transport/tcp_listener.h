@@ -28,6 +28,7 @@
 #include <boost/noncopyable.hpp>
 
 #include "listener_interface.h"
+#include "tcp_options.h"
 
 namespace nekit {
 namespace transport {
@@ -41,6 +42,18 @@ class TcpListener : public ListenerInterface, private boost::noncopyable {
   std::error_code Bind(std::string ip, uint16_t port);
   std::error_code Bind(boost::asio::ip::address ip, uint16_t port);
 
+  // Must be set before `Bind`.
+  void set_tcp_options(std::shared_ptr<const TcpOptions> options) {
+    tcp_options_ = options;
+  }
+
+  // Must be set before `Bind`. Defaults to `SOMAXCONN`.
+  void set_backlog(int backlog) { backlog_ = backlog; }
+
+  // The number of accept operations kept outstanding. Must be set before
+  // `Accept`.
+  void set_concurrent_accepts(size_t count) { concurrent_accepts_ = count; }
+
   void Accept(EventHandler handler) override;
 
   void Close() override;
@@ -48,10 +61,17 @@ class TcpListener : public ListenerInterface, private boost::noncopyable {
   boost::asio::io_context* io() override;
 
  private:
+  void DoAccept(EventHandler handler);
+  void Drain(EventHandler handler);
+  void HandleAccepted(boost::asio::ip::tcp::socket&& socket,
+                      EventHandler handler);
+
   boost::asio::ip::tcp::acceptor acceptor_;
-  boost::asio::ip::tcp::socket socket_;
 
   DataFlowHandler handler_;
+  std::shared_ptr<const TcpOptions> tcp_options_;
+  int backlog_{boost::asio::socket_base::max_listen_connections};
+  size_t concurrent_accepts_{1};
 };
 
 std::error_code make_error_code(TcpListener::ErrorCode ec);
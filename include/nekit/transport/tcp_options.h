@@ -0,0 +1,80 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <system_error>
+
+#include <boost/asio.hpp>
+
+namespace nekit {
+namespace transport {
+
+// A socket tuning profile shared by listeners and connectors. Every option
+// defaults to the system behavior. Options that are not supported on the
+// current platform are silently skipped. The `Apply*` methods try every option
+// even if some are rejected and return the first error.
+struct TcpOptions {
+  bool no_delay{false};
+
+  // In bytes, 0 keeps the system default. The listener applies them before
+  // listening so the window scale of accepted connections honors them.
+  int receive_buffer_size{0};
+  int send_buffer_size{0};
+
+  // In bytes, 0 keeps the system default.
+  int not_sent_low_water_mark{0};
+
+  bool keep_alive{false};
+  // In seconds, 0 keeps the system default. Only used if `keep_alive` is set.
+  int keep_alive_idle{0};
+  int keep_alive_interval{0};
+  int keep_alive_count{0};
+
+  // In milliseconds, 0 keeps the system default.
+  unsigned int user_timeout{0};
+
+  // The first write on a connecting socket is sent in the SYN. Once a cookie is
+  // cached, `connect` completes before the handshake even starts, so a dead
+  // upstream only shows up as a failed first write; connect timeouts and
+  // failover to the next address do not apply. `TcpConnector` thus ignores it,
+  // with a warning, unless both of its timeouts are disabled, see
+  // `TcpSocket::set_connect_timeouts`. On the listener it enables
+  // accepting data in SYN with at most `fast_open_queue_length` pending
+  // requests.
+  bool fast_open{false};
+  int fast_open_queue_length{64};
+
+  // Must be called after the acceptor is opened and before it listens.
+  std::error_code ApplyToAcceptor(
+      boost::asio::ip::tcp::acceptor& acceptor) const;
+
+  std::error_code ApplyToAcceptedSocket(
+      boost::asio::ip::tcp::socket& socket) const;
+
+  // Must be called after the socket is opened and before it connects.
+  std::error_code ApplyToConnectingSocket(
+      boost::asio::ip::tcp::socket& socket) const;
+};
+
+}  // namespace transport
+}  // namespace nekit
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <system_error>
 #include <vector>
@@ -31,8 +32,10 @@
 
 #include "../data_flow/local_data_flow_interface.h"
 #include "../data_flow/remote_data_flow_interface.h"
+#include "tcp_connection_pool.h"
 #include "tcp_connector.h"
 #include "tcp_listener.h"
+#include "tcp_options.h"
 
 namespace nekit {
 namespace transport {
@@ -40,9 +43,29 @@ namespace transport {
 class TcpSocket final : public data_flow::LocalDataFlowInterface,
                         public data_flow::RemoteDataFlowInterface {
  public:
-  explicit TcpSocket(std::shared_ptr<utils::Session> session);
+  // `options` is applied to the socket when connecting to remote.
+  explicit TcpSocket(std::shared_ptr<utils::Session> session,
+                     std::shared_ptr<const TcpOptions> options = nullptr);
   ~TcpSocket();
 
+  // If set, `Connect` takes an established connection from `pool` when there
+  // is one. `pool` must outlive the socket.
+  void set_connection_pool(TcpConnectionPool* pool) { connection_pool_ = pool; }
+
+  // If set, the socket connecting to remote is bound to the source address
+  // picked by `device`.
+  void set_device(std::shared_ptr<utils::DeviceInterface> device) {
+    device_ = device;
+  }
+
+  // Timeouts of the connector used by `Connect`, zero disables them. Both have
+  // to be disabled for `TcpOptions::fast_open` to take effect.
+  void set_connect_timeouts(std::chrono::milliseconds attempt_timeout,
+                            std::chrono::milliseconds connect_timeout) {
+    attempt_timeout_ = attempt_timeout;
+    connect_timeout_ = connect_timeout;
+  }
+
   utils::Cancelable Read(std::unique_ptr<utils::Buffer>&&,
                          DataEventHandler) override
       __attribute__((warn_unused_result));
@@ -100,6 +123,12 @@ class TcpSocket final : public data_flow::LocalDataFlowInterface,
   std::unique_ptr<TcpConnector> connector_;
   std::shared_ptr<utils::Session> session_;
   std::shared_ptr<utils::Endpoint> connect_to_;
+  std::shared_ptr<const TcpOptions> tcp_options_;
+  TcpConnectionPool* connection_pool_{nullptr};
+  std::shared_ptr<utils::DeviceInterface> device_;
+  std::chrono::milliseconds attempt_timeout_{
+      NEKIT_TCP_CONNECT_ATTEMPT_TIMEOUT},
+      connect_timeout_{NEKIT_TCP_CONNECT_TIMEOUT};
   std::unique_ptr<std::vector<boost::asio::const_buffer>> write_buffer_;
   std::unique_ptr<std::vector<boost::asio::mutable_buffer>> read_buffer_;
   bool read_closed_{false}, write_closed_{false}, reading_{false},
@@ -0,0 +1,93 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "dns_cache.h"
+#include "resolver_interface.h"
+
+namespace nekit {
+namespace utils {
+
+// Answers from `cache` when possible and caches the results of `resolver`
+// otherwise. The cache can be shared by several resolvers on the same
+// `io_context`.
+//
+// Positive entries that are looked up often are refreshed in background when
+// they are about to expire, so hot domains rarely miss the cache.
+class CachingResolver : public ResolverInterface, private LifeTime {
+ public:
+  CachingResolver(std::unique_ptr<ResolverInterface>&& resolver,
+                  std::shared_ptr<DnsCache> cache);
+
+  Cancelable Resolve(std::string domain, AddressPreference preference,
+                     EventHandler handler) override
+      __attribute__((warn_unused_result));
+
+  Cancelable ResolveWithTtl(std::string domain, AddressPreference preference,
+                            TtlEventHandler handler) override
+      __attribute__((warn_unused_result));
+
+  // In-flight prefetches are canceled.
+  void Stop() override;
+  void Reset() override;
+
+  boost::asio::io_context* io() override;
+
+  const std::shared_ptr<DnsCache>& cache() const { return cache_; }
+
+  // Background resolutions allowed per second, zero disables prefetching.
+  void set_prefetch_rate(double rate) {
+    prefetch_rate_ = rate;
+    prefetch_tokens_ = std::max(rate, 1.0);
+  }
+
+  uint64_t prefetches() const { return prefetches_; }
+  // Prefetches skipped because the rate is exceeded.
+  uint64_t prefetches_throttled() const { return prefetches_throttled_; }
+
+ private:
+  static std::chrono::seconds ClampTtl(std::chrono::seconds ttl);
+  // Zero if the error must not be cached.
+  static std::chrono::seconds NegativeTtl(std::error_code ec);
+
+  void MaybePrefetch(const std::string& domain, AddressPreference preference,
+                     const std::string& key, const DnsCache::Entry& entry,
+                     DnsCache::Clock::time_point now);
+  bool AcquirePrefetchToken(DnsCache::Clock::time_point now);
+
+  std::unique_ptr<ResolverInterface> resolver_;
+  std::shared_ptr<DnsCache> cache_;
+
+  double prefetch_rate_{NEKIT_DNS_PREFETCH_RATE};
+  double prefetch_tokens_{std::max<double>(NEKIT_DNS_PREFETCH_RATE, 1)};
+  DnsCache::Clock::time_point prefetch_refilled_at_{DnsCache::Clock::now()};
+  std::unordered_map<std::string, Cancelable> prefetching_;
+  uint64_t prefetches_{0}, prefetches_throttled_{0};
+};
+}  // namespace utils
+}  // namespace nekit
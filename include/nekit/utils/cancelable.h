@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 
 #include <boost/noncopyable.hpp>
@@ -31,6 +32,9 @@ namespace utils {
 class Cancelable {
  public:
   Cancelable();
+  // `action` is run by the first `Cancel`, on the thread calling it. Use it
+  // to release the work the instance stands for right away.
+  explicit Cancelable(std::function<void()> action);
 
   Cancelable(const Cancelable& cancelable);
   Cancelable& operator=(const Cancelable& cancelable);
@@ -48,7 +52,12 @@ class Cancelable {
   bool canceled() const;
 
  private:
-  std::shared_ptr<bool> canceled_;
+  struct State {
+    bool canceled{false};
+    std::function<void()> action;
+  };
+
+  std::shared_ptr<State> state_;
 };
 
 class LifeTime : private boost::noncopyable {
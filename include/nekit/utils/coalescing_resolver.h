@@ -0,0 +1,79 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "resolver_interface.h"
+
+namespace nekit {
+namespace utils {
+
+// Sends only one query to `resolver` for concurrent resolves of the same
+// domain with the same preference, and hands the result to all of them.
+// Canceling one resolve does not cancel the shared query.
+//
+// Put it behind a `CachingResolver` so the cache is filled once per query.
+class CoalescingResolver : public ResolverInterface, private LifeTime {
+ public:
+  explicit CoalescingResolver(std::unique_ptr<ResolverInterface>&& resolver);
+
+  Cancelable Resolve(std::string domain, AddressPreference preference,
+                     EventHandler handler) override
+      __attribute__((warn_unused_result));
+
+  Cancelable ResolveWithTtl(std::string domain, AddressPreference preference,
+                            TtlEventHandler handler) override
+      __attribute__((warn_unused_result));
+
+  // Pending queries are dropped, their handlers will never be called.
+  void Stop() override;
+  void Reset() override;
+
+  boost::asio::io_context* io() override;
+
+  size_t pending_queries() const { return queries_.size(); }
+
+  // The number of resolves that joined a pending query.
+  uint64_t coalesced() const { return coalesced_; }
+
+ private:
+  struct Waiter {
+    TtlEventHandler handler;
+    Cancelable cancelable;
+  };
+
+  struct Query {
+    std::vector<Waiter> waiters;
+    Cancelable cancelable;
+  };
+
+  std::unique_ptr<ResolverInterface> resolver_;
+  std::unordered_map<std::string, std::unique_ptr<Query>> queries_;
+  uint64_t coalesced_{0};
+};
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,119 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "mapped_vector.h"
+
+namespace nekit {
+namespace utils {
+
+// A trie of domain prefixes, or suffixes if `reverse`, that answers whether
+// any of them starts a string, like `DomainTrie`.
+//
+// It is built once from all the added strings, the first time it is matched
+// after an addition. Nodes are laid out breadth first in one array so the
+// children of a node are contiguous and sorted by label, and each node takes 9
+// bytes instead of a table of 78 pointers. Strings extending an added one can
+// never decide a match and are left out.
+//
+// Each string can carry a value and `MatchLowest` returns the lowest value of
+// the strings starting a literal, e.g., the position of the first rule that
+// matches. Then a string extending one with a lower or equal value is left
+// out instead.
+class CompactTrie : private boost::noncopyable {
+ public:
+  static constexpr uint32_t kNoValue = std::numeric_limits<uint32_t>::max();
+
+  explicit CompactTrie(bool reverse = false) : reverse_{reverse} {}
+
+  // Returns `false` if `prefix` is empty or has characters a domain can not
+  // have. The value is 0 if not given.
+  bool AddPrefix(const std::string& prefix, uint32_t value = 0);
+
+  // Builds the trie first if a string is added since the last build, which
+  // is not thread-safe. Once built, several threads can match at the same
+  // time.
+  bool MatchPrefixWith(const std::string& literal);
+
+  // The lowest value of the strings starting `literal`, `kNoValue` if there is
+  // none. Unlike `MatchPrefixWith` the trie must be built.
+  uint32_t MatchLowest(const std::string& literal) const;
+
+  // Does nothing if the trie is built since the last addition.
+  void Build();
+
+  // Empty if the trie is mapped and not changed since.
+  const std::vector<std::string>& entries() const { return entries_; }
+
+  // Builds the trie if needed and appends the nodes as they are, in native
+  // byte order, so `Map` can use them in place. The values are not saved, all
+  // strings of a mapped trie have the value 0.
+  void Save(std::string* out);
+
+  // Replaces the trie with the one saved at `data`, which must be 8 byte
+  // aligned and stay valid while `owner` is alive. The strings are recovered
+  // from the nodes if one is added later. Returns `false` and leaves the trie
+  // unchanged if the data is invalid or saved with a different `reverse`.
+  bool Map(const void* data, size_t size, std::shared_ptr<const void> owner);
+  bool mapped() const { return nodes_.mapped(); }
+
+  // The node count reflects the last build, the memory usage also counts the
+  // strings kept to rebuild the trie.
+  size_t node_count() const { return nodes_.size(); }
+  size_t memory_usage() const;
+
+ private:
+  struct Node {
+    uint32_t first_child;
+    uint16_t child_count;
+    // A byte rather than a bool since a mapped image may hold any value here.
+    uint8_t end;
+  };
+
+  static bool IsValid(char ch) { return ch >= '-' && ch < '-' + 78; }
+
+  // Rebuilds `entries_` of a mapped trie from its nodes.
+  void RecoverEntries();
+
+  bool reverse_;
+  bool built_{true};
+  std::vector<std::string> entries_;
+  // Empty if all the values are 0.
+  std::vector<uint32_t> entry_values_;
+
+  MappedVector<Node> nodes_{std::vector<Node>{Node{0, 0, false}}};
+  // The label of the edge into each node.
+  MappedVector<char> labels_{std::vector<char>{'\0'}};
+  // The value of each node a string ends at, empty if all the values are 0.
+  std::vector<uint32_t> values_;
+};
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,116 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "../config.h"
+
+namespace nekit {
+namespace utils {
+
+class WarmSnapshot;
+
+// A LRU cache of resolved addresses with per-entry expiration. Failures are
+// cached as negative entries. It is not thread-safe, share it on one
+// `io_context` only.
+class DnsCache : private boost::noncopyable {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Addresses = std::shared_ptr<std::vector<boost::asio::ip::address>>;
+
+  struct Entry {
+    // `nullptr` for negative entries. The addresses are shared with every
+    // user of the entry and must not be modified.
+    Addresses addresses;
+    std::error_code error;
+    Clock::time_point expire_at;
+    std::chrono::seconds ttl;
+    // Lookups since the entry is inserted.
+    uint32_t hits;
+  };
+
+  struct Statistics {
+    uint64_t hits;
+    uint64_t negative_hits;
+    uint64_t misses;
+    uint64_t expired;
+    uint64_t evicted;
+    // Misses answered by the snapshot.
+    uint64_t snapshot_hits;
+  };
+
+  explicit DnsCache(size_t capacity = NEKIT_DNS_CACHE_SIZE);
+
+  // Returns `nullptr` if there is no entry or it is expired. The returned
+  // pointer is invalidated by the next modification of the cache.
+  const Entry* Lookup(const std::string& key,
+                      Clock::time_point now = Clock::now());
+
+  void Insert(const std::string& key, Addresses addresses,
+              std::chrono::seconds ttl, Clock::time_point now = Clock::now());
+  void InsertNegative(const std::string& key, std::error_code error,
+                      std::chrono::seconds ttl,
+                      Clock::time_point now = Clock::now());
+
+  void Erase(const std::string& key);
+  void Clear();
+
+  // Entries missing from the cache are looked up in `snapshot`.
+  void set_snapshot(std::shared_ptr<const WarmSnapshot> snapshot) {
+    snapshot_ = snapshot;
+  }
+
+  // Visits the entries from the most recently used one.
+  void Walk(std::function<void(const std::string&, const Entry&)> visitor)
+      const;
+
+  size_t size() const { return entries_.size(); }
+  size_t capacity() const { return capacity_; }
+
+  const Statistics& statistics() const { return statistics_; }
+
+ private:
+  using List = std::list<std::pair<std::string, Entry>>;
+
+  void Put(const std::string& key, Entry entry);
+
+  size_t capacity_;
+  // The most recently used entry is at front.
+  List list_;
+  std::unordered_map<std::string, List::iterator> entries_;
+  std::shared_ptr<const WarmSnapshot> snapshot_;
+  Statistics statistics_{0, 0, 0, 0, 0, 0};
+};
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,74 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+
+namespace nekit {
+namespace utils {
+
+// Just enough of RFC 1035 to send a recursive query for address records and
+// read the answer.
+
+enum class DnsRecordType : uint16_t { A = 1, CNAME = 5, AAAA = 28 };
+
+enum class DnsResponseCode : uint8_t {
+  NoError = 0,
+  FormatError = 1,
+  ServerFailure = 2,
+  NameError = 3,
+  NotImplemented = 4,
+  Refused = 5
+};
+
+struct DnsRecord {
+  boost::asio::ip::address address;
+  uint32_t ttl;
+};
+
+struct DnsResponse {
+  uint16_t id;
+  bool truncated;
+  DnsResponseCode code;
+  // Only the address records of the queried type in the answer section that
+  // are owned by the queried name or, following the CNAME records from it, a
+  // name it is an alias of. Each TTL is capped by the TTLs of the aliases.
+  std::vector<DnsRecord> records;
+};
+
+// Appends a query with recursion desired to `buffer`. Returns `false` if
+// `domain` is not a valid name.
+bool EncodeDnsQuery(uint16_t id, const std::string& domain, DnsRecordType type,
+                    std::vector<uint8_t>* buffer);
+
+// Returns `false` if `data` is malformed, is not a response, or does not
+// answer the question of `domain` and `type`. The ID is not checked.
+bool ParseDnsResponse(const uint8_t* data, size_t size,
+                      const std::string& domain, DnsRecordType type,
+                      DnsResponse* response);
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,157 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+
+#include "bloom_filter.h"
+#include "mapped_vector.h"
+
+namespace nekit {
+namespace utils {
+
+// A set of domains, each matching either only itself or also all its
+// subdomains, and carrying a value.
+//
+// A domain is keyed by the hash of its labels combined from the right, so the
+// keys of all the label suffixes of a host are computed in one pass over it
+// from the end, and each is looked up with one probe into an open addressing
+// table. `example.com` added with `AddSuffix` matches `a.example.com` but not
+// `badexample.com`. Domains are compared ignoring ASCII case.
+//
+// The domains and their values are kept in one pool and a slot only holds 8
+// bytes, so it takes under two thirds of the memory of an
+// `std::unordered_set<std::string>` of the same domains. Only the label
+// suffixes as long as some domain added are looked up.
+class DomainSet {
+ public:
+  static constexpr uint32_t kNoMatch = std::numeric_limits<uint32_t>::max();
+
+  // If a domain is added more than once the lowest value is kept. Empty
+  // domains and those longer than 255 bytes, which are not valid, are ignored.
+  void AddDomain(boost::string_view domain, uint32_t value = 0);
+  void AddSuffix(boost::string_view domain, uint32_t value = 0);
+
+  // Returns the lowest value of the entries matching `host`, or `kNoMatch`.
+  uint32_t Match(boost::string_view host) const;
+  bool Contains(boost::string_view host) const {
+    return Match(host) != kNoMatch;
+  }
+
+  // Calls `visitor(domain, suffix, value)` for every entry, with `domain` as
+  // it is first added.
+  template <typename Visitor>
+  void ForEach(Visitor visitor) const {
+    for (const auto& slot : slots_) {
+      if (slot.offset == kEmpty) {
+        continue;
+      }
+      std::string domain = Name(slot).to_string();
+      uint32_t exact = Value(slot, false), suffix = Value(slot, true);
+      if (exact != kNoMatch) {
+        visitor(domain, false, exact);
+      }
+      if (suffix != kNoMatch) {
+        visitor(domain, true, suffix);
+      }
+    }
+  }
+
+  // Adds a Bloom filter of the domains, so a label suffix that is not in the
+  // set mostly skips probing the table, which is much larger. Domains added
+  // later are added to it.
+  void BuildFilter(double bits_per_key);
+
+  size_t size() const { return size_; }
+  bool empty() const { return !size_; }
+  size_t memory_usage() const {
+    return slots_.memory_usage() + names_.memory_usage() +
+           filter_.memory_usage();
+  }
+
+  // Releases the memory reserved for later additions.
+  void ShrinkToFit() { names_.ShrinkToFit(); }
+
+  // Appends the table and the pool as they are, in native byte order, so
+  // `Map` can use them in place.
+  void Save(std::string* out) const;
+
+  // Replaces the set with the one saved at `data`, which must be 8 byte
+  // aligned and stay valid while `owner` is alive. The slots are checked in
+  // one pass, the domains are not rehashed. The filter is dropped. Returns
+  // `false` and leaves the set unchanged if the data is invalid.
+  bool Map(const void* data, size_t size, std::shared_ptr<const void> owner);
+  bool mapped() const { return slots_.mapped(); }
+
+ private:
+  struct Slot {
+    // The high bits of the hash, the low bits pick the slot.
+    uint32_t tag;
+    // Where the entry is in `names_`, see `kHeaderSize`.
+    uint32_t offset;
+  };
+
+  // An entry in `names_` is the length of the domain in one byte, the value of
+  // matching the domain only and that of matching its subdomains too, then
+  // the domain.
+  static const size_t kHeaderSize = 1 + 2 * sizeof(uint32_t);
+
+  static const uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+  // Calls `visitor(hash, start, depth)` for each label suffix of `domain`
+  // starting at `start` and having `depth` labels, from the last label.
+  template <typename Visitor>
+  static void ForEachSuffix(boost::string_view domain, Visitor visitor);
+  static uint64_t Hash(boost::string_view domain, unsigned* depth);
+  static uint64_t DepthBit(unsigned depth) {
+    return uint64_t(1) << std::min(depth, 63u);
+  }
+
+  void Add(boost::string_view domain, bool suffix, uint32_t value);
+  // Returns the index of the slot of `name`, or of the empty slot it would
+  // take.
+  size_t Probe(uint64_t hash, boost::string_view name) const;
+  boost::string_view Name(const Slot& slot) const {
+    return boost::string_view(names_.data() + slot.offset + kHeaderSize,
+                              static_cast<uint8_t>(names_[slot.offset]));
+  }
+  uint32_t Value(const Slot& slot, bool suffix) const;
+  void Grow();
+
+  MappedVector<Slot> slots_;
+  MappedVector<char> names_;
+  size_t size_{0};
+  // Bit `n` is set if a domain with `n` labels, or more for the last bit, is
+  // added, or added to match its subdomains.
+  uint64_t depths_{0}, suffix_depths_{0};
+  BloomFilter filter_;
+};
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,84 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include <boost/asio.hpp>
+
+#include "resolver_interface.h"
+
+namespace nekit {
+namespace utils {
+
+// Looks up A and AAAA records in parallel and merges them according to the
+// preference. The result is returned once the preferred family answers and
+// the other one answers or `grace` passes. With `Any` the family that answers
+// first is preferred. The addresses of the preferred family come first.
+//
+// `IPv4Only` and `IPv6Only` only look up the one family.
+class DualStackQuery : public std::enable_shared_from_this<DualStackQuery> {
+ public:
+  using TtlEventHandler = ResolverInterface::TtlEventHandler;
+  using AddressPreference = ResolverInterface::AddressPreference;
+  // Starts the lookup of IPv6 addresses if `v6` is `true`, IPv4 otherwise.
+  using Lookup = std::function<Cancelable(bool v6, TtlEventHandler handler)>;
+
+  static Cancelable Start(boost::asio::io_context* io,
+                          AddressPreference preference,
+                          std::chrono::milliseconds grace, Lookup lookup,
+                          TtlEventHandler handler);
+
+  DualStackQuery(boost::asio::io_context* io, AddressPreference preference,
+                 std::chrono::milliseconds grace, Cancelable cancelable,
+                 TtlEventHandler handler);
+
+ private:
+  struct Result {
+    bool done{false};
+    std::shared_ptr<std::vector<boost::asio::ip::address>> addresses;
+    std::chrono::seconds ttl;
+    std::error_code error;
+  };
+
+  void Run(Lookup lookup);
+  void Handle(bool v6, Result result);
+  void Finish();
+
+  AddressPreference preference_;
+  std::chrono::milliseconds grace_;
+  Cancelable cancelable_;
+  TtlEventHandler handler_;
+
+  boost::asio::steady_timer timer_;
+  // Indexed by whether the family is IPv6.
+  std::array<Result, 2> results_;
+  std::array<Cancelable, 2> lookups_;
+  int preferred_{-1};
+  bool finished_{false};
+};
+}  // namespace utils
+}  // namespace nekit
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <boost/asio/ip/address.hpp>
@@ -56,7 +57,7 @@ class Endpoint : LifeTime {
   Type type() const { return type_; }
 
   // Prefer to return the domain name of the host if available.
-  std::string host() const { return domain_; }
+  const std::string& host() const { return domain_; }
 
   // The result only makes sense when `IsAddressAvailable` returns `true`.
   const boost::asio::ip::address& address() const {
@@ -83,12 +84,29 @@ class Endpoint : LifeTime {
 
   std::error_code resolve_error() const { return error_; }
 
+  ResolverInterface* resolver() const { return resolver_; }
   void set_resolver(ResolverInterface* resolver) { resolver_ = resolver; }
 
+  ResolverInterface::AddressPreference address_preference() const {
+    return address_preference_;
+  }
+  void set_address_preference(
+      ResolverInterface::AddressPreference preference) {
+    address_preference_ = preference;
+  }
+
+  // Canceling the returned `Cancelable` drops `handler`. The resolution is
+  // canceled once every caller waiting for it cancels, see `WaitResolved`,
+  // and the domain can be resolved again then.
   Cancelable Resolve(EventHandler handler)
       __attribute__((warn_unused_result));
   Cancelable ForceResolve(EventHandler handler)
       __attribute__((warn_unused_result));
+  // Waits for the resolution in progress, e.g., one started speculatively, or
+  // starts resolving if there is none. Any number of callers can wait for the
+  // same resolution. If the domain is already resolved `handler` is posted.
+  Cancelable WaitResolved(EventHandler handler)
+      __attribute__((warn_unused_result));
 
   std::shared_ptr<const std::vector<boost::asio::ip::address>>
   resolved_addresses() const {
@@ -98,6 +116,10 @@ class Endpoint : LifeTime {
   std::shared_ptr<Endpoint> Dup() const;
 
  private:
+  Cancelable AddWaiter(EventHandler handler);
+  // Cancels the resolution if no one waits for it anymore.
+  void DropCanceledWaiters();
+
   Type type_;
   std::string domain_;
   boost::asio::ip::address address_;
@@ -107,9 +129,13 @@ class Endpoint : LifeTime {
   std::shared_ptr<std::vector<boost::asio::ip::address>> resolved_addresses_;
   std::error_code error_;
   ResolverInterface* resolver_{nullptr};
+  ResolverInterface::AddressPreference address_preference_{
+      ResolverInterface::AddressPreference::Any};
   bool resolved_{false};
   bool resolving_{false};
   Cancelable resolve_cancelable_;
+  // Called when the resolution in progress finishes.
+  std::vector<std::pair<Cancelable, EventHandler>> waiters_;
 };
 }  // namespace utils
 }  // namespace nekit
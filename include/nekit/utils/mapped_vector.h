@@ -0,0 +1,90 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nekit {
+namespace utils {
+
+// An array that either owns its elements or refers to read only memory kept
+// alive by an owner, e.g., a section of a memory mapped file. The mapped
+// memory is copied the first time the array is modified, so a structure built
+// on it can be mapped and still be changed.
+template <typename T>
+class MappedVector {
+ public:
+  MappedVector() = default;
+  MappedVector(std::vector<T> elements) : owned_(std::move(elements)) {}
+
+  void Map(const T* data, size_t size, std::shared_ptr<const void> owner) {
+    owned_ = std::vector<T>();
+    mapped_ = data;
+    mapped_size_ = size;
+    owner_ = std::move(owner);
+  }
+
+  void Assign(std::vector<T> elements) {
+    owned_ = std::move(elements);
+    Unmap();
+  }
+
+  // Copies the mapped elements if there are any.
+  std::vector<T>& Mutable() {
+    if (mapped_) {
+      owned_.assign(mapped_, mapped_ + mapped_size_);
+      Unmap();
+    }
+    return owned_;
+  }
+
+  const T* data() const { return mapped_ ? mapped_ : owned_.data(); }
+  size_t size() const { return mapped_ ? mapped_size_ : owned_.size(); }
+  bool empty() const { return !size(); }
+  bool mapped() const { return mapped_; }
+
+  const T& operator[](size_t index) const { return data()[index]; }
+  const T* begin() const { return data(); }
+  const T* end() const { return data() + size(); }
+
+  // Mapped memory is shared and not counted.
+  size_t memory_usage() const { return owned_.capacity() * sizeof(T); }
+  void ShrinkToFit() { owned_.shrink_to_fit(); }
+
+ private:
+  void Unmap() {
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+    owner_.reset();
+  }
+
+  std::vector<T> owned_;
+  const T* mapped_{nullptr};
+  size_t mapped_size_{0};
+  std::shared_ptr<const void> owner_;
+};
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,145 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "../config.h"
+
+namespace nekit {
+namespace utils {
+
+// Searches a text for any of a list of ECMAScript regular expressions at once.
+//
+// Expressions using only literals, `.`, classes, `\d` `\w` `\s` and their
+// negations, groups, alternation, quantifiers, `^` and `$` are compiled into
+// one NFA. It is turned into a DFA lazily while searching, so a text is
+// scanned once in linear time for all of them. Other expressions, e.g., with
+// backreferences or lookaheads, are matched with `std::regex` one by one.
+//
+// `Search` prepares the set on first use, so several threads can only search
+// it at the same time after `Prepare` is called explicitly. Each thread then
+// builds its own DFA, of at most `max_dfa_states` states, so searching never
+// takes a lock.
+class RegexSet : private boost::noncopyable {
+ public:
+  explicit RegexSet(bool icase = false,
+                    size_t max_dfa_states = NEKIT_REGEX_DFA_STATES);
+
+  // Returns `false` if `expression` is not valid.
+  bool Add(const std::string& expression);
+
+  // Builds what the DFA is made from. It is done by the first `Search` after
+  // an expression is added if it is not called, which is not thread-safe.
+  void Prepare();
+
+  bool Search(const std::string& text);
+
+  size_t compiled_count() const { return compiled_count_; }
+  size_t fallback_count() const { return fallback_.size(); }
+  // Of the DFA of the calling thread.
+  size_t dfa_state_count() const;
+
+ private:
+  using CharSet = std::bitset<256>;
+
+  struct Ast;
+  class Parser;
+
+  struct NfaNode {
+    enum class Type : uint8_t { Set, Epsilon, Begin, End, Accept };
+
+    Type type;
+    // The index in `sets_` of `Set` nodes.
+    uint32_t set;
+    std::vector<uint32_t> outs;
+  };
+
+  struct DfaState {
+    // Sorted `Set`, `End` and `Accept` nodes but those in `restart_`.
+    std::vector<uint32_t> nodes;
+    // Indexed by byte class, -1 if not built yet.
+    std::vector<int32_t> next;
+    bool accept;
+    bool accept_at_end;
+    bool dead;
+  };
+
+  // The states built while searching and the scratch space to build them.
+  struct Dfa {
+    std::vector<DfaState> states;
+    std::map<std::vector<uint32_t>, int32_t> index;
+    int32_t start{-1};
+    size_t flushes{0};
+    std::vector<uint32_t> visited;
+    uint32_t stamp{0};
+  };
+
+  // Identifies a prepared set, it expires once the set is changed or gone.
+  struct Generation {};
+
+  uint32_t Compile(const Ast& ast, uint32_t next);
+  uint32_t NewNode(NfaNode::Type type);
+
+  // The DFA of the calling thread for the current generation.
+  Dfa* ThreadDfa() const;
+  int32_t Start(Dfa* dfa) const;
+  int32_t Transition(Dfa* dfa, int32_t state, uint8_t byte_class) const;
+  std::vector<uint32_t> Closure(Dfa* dfa, std::vector<uint32_t> seeds,
+                                bool at_start, bool at_end) const;
+  int32_t Intern(Dfa* dfa, std::vector<uint32_t> seeds, bool at_start) const;
+  static void Flush(Dfa* dfa);
+
+  bool icase_;
+  size_t max_dfa_states_;
+
+  std::vector<NfaNode> nfa_;
+  std::vector<CharSet> sets_;
+  std::vector<uint32_t> starts_;
+  size_t compiled_count_{0};
+  // Where the NFA of the expression being added starts.
+  size_t expression_start_{0};
+
+  // Built from the NFA before searching, see `Prepare`. Null if not
+  // prepared.
+  std::shared_ptr<const Generation> generation_;
+  std::array<uint8_t, 256> classes_;
+  std::vector<uint8_t> representatives_;
+  size_t class_count_{0};
+  std::vector<uint32_t> restart_;
+  std::vector<bool> in_restart_;
+  std::vector<std::vector<uint32_t>> restart_moves_;
+
+  std::vector<std::regex> fallback_;
+};
+}  // namespace utils
+}  // namespace nekit
@@ -22,8 +22,11 @@
 
 #pragma once
 
+#include <cctype>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <string>
 #include <system_error>
 
 #include <boost/asio.hpp>
@@ -34,12 +37,23 @@
 
 namespace nekit {
 namespace utils {
+// The TTL reported by resolvers that do not know the TTL of the records. Caches
+// may clamp any TTL, including zero, into their own range, so a burst of
+// lookups of a record that should not be cached is still resolved once.
+const std::chrono::seconds kUnknownTtl{-1};
+
 class ResolverInterface : public AsyncIoInterface, private boost::noncopyable {
  public:
   using EventHandler = std::function<void(
       std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
       std::error_code)>;
 
+  // `ttl` is how long the result can be cached, `kUnknownTtl` if it is
+  // unknown.
+  using TtlEventHandler = std::function<void(
+      std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+      std::chrono::seconds ttl, std::error_code)>;
+
   enum class AddressPreference { IPv4Only, IPv6Only, IPv4, IPv6, Any };
 
   virtual ~ResolverInterface() = default;
@@ -49,8 +63,36 @@ class ResolverInterface : public AsyncIoInterface, private boost::noncopyable {
                                     EventHandler handler)
       __attribute__((warn_unused_result)) = 0;
 
+  // Resolvers that know the TTL of the records should override this.
+  virtual Cancelable ResolveWithTtl(std::string domain,
+                                    AddressPreference preference,
+                                    TtlEventHandler handler)
+      __attribute__((warn_unused_result)) {
+    return Resolve(
+        domain, preference,
+        [handler](
+            std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+            std::error_code ec) {
+          handler(addresses, kUnknownTtl, ec);
+        });
+  }
+
   virtual void Stop() = 0;
   virtual void Reset() = 0;
+
+  // Identifies the query of `domain` with `preference`, the domain is case
+  // insensitive.
+  static std::string QueryKey(const std::string& domain,
+                              AddressPreference preference) {
+    std::string key;
+    key.reserve(domain.size() + 2);
+    for (unsigned char c : domain) {
+      key.push_back(static_cast<char>(std::tolower(c)));
+    }
+    key.push_back('/');
+    key.push_back(static_cast<char>('0' + static_cast<int>(preference)));
+    return key;
+  }
 };
 
 }  // namespace utils
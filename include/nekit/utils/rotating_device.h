@@ -0,0 +1,54 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+
+#include "device.h"
+
+namespace nekit {
+namespace utils {
+
+// Picks the source addresses in turn from a fixed list, so the outbound
+// connections spread over all of them instead of exhausting the ephemeral ports
+// of one address. Only addresses of the same family as the target are used.
+//
+// It can be shared by sockets on different threads.
+class RotatingDevice : public DeviceInterface {
+ public:
+  explicit RotatingDevice(
+      const std::vector<boost::asio::ip::address>& addresses);
+
+  // Returns an unspecified address if there is no address of the same family.
+  boost::asio::ip::address FindSourceIpToBind(
+      const boost::asio::ip::address& target) override;
+
+ private:
+  std::vector<boost::asio::ip::address> v4_addresses_, v6_addresses_;
+  std::atomic<size_t> v4_next_{0}, v6_next_{0};
+};
+}  // namespace utils
+}  // namespace nekit
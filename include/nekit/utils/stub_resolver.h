@@ -0,0 +1,108 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "../config.h"
+#include "resolver_interface.h"
+
+namespace nekit {
+namespace utils {
+
+// Resolves by talking to DNS servers directly on the main `io_context`. Queries
+// go over UDP and are retried over TCP if the response is truncated. Each
+// attempt goes to the next server in turn, every server is tried
+// `attempts` times before giving up. A and AAAA records are queried as
+// `DualStackQuery` describes.
+class StubResolver : public ResolverInterface, private LifeTime {
+ public:
+  enum class ErrorCode {
+    NoError = 0,
+    NameError,
+    NoData,
+    ServerFailure,
+    Refused,
+    InvalidName,
+    InvalidResponse,
+    TimedOut
+  };
+
+  // With no `servers` every query fails with `TimedOut`.
+  StubResolver(boost::asio::io_context* io,
+               std::vector<boost::asio::ip::udp::endpoint> servers);
+  ~StubResolver();
+
+  // Must be set before `Resolve`.
+  void set_timeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+  void set_attempts(size_t attempts) { attempts_ = attempts; }
+  void set_dual_stack_grace(std::chrono::milliseconds grace) {
+    dual_stack_grace_ = grace;
+  }
+
+  Cancelable Resolve(std::string domain, AddressPreference preference,
+                     EventHandler handler) override
+      __attribute__((warn_unused_result));
+
+  Cancelable ResolveWithTtl(std::string domain, AddressPreference preference,
+                            TtlEventHandler handler) override
+      __attribute__((warn_unused_result));
+
+  // Pending queries are dropped, their handlers will never be called.
+  void Stop() override;
+  void Reset() override;
+
+  boost::asio::io_context* io() override;
+
+ private:
+  class Query;
+
+  void Fail(std::error_code ec, Cancelable cancelable,
+            TtlEventHandler handler);
+
+  boost::asio::io_context* io_;
+  std::vector<boost::asio::ip::udp::endpoint> servers_;
+  std::chrono::milliseconds timeout_{NEKIT_DNS_TIMEOUT};
+  size_t attempts_{NEKIT_DNS_ATTEMPTS};
+  std::chrono::milliseconds dual_stack_grace_{NEKIT_DNS_DUAL_STACK_GRACE};
+
+  std::mt19937 random_;
+  std::unordered_map<Query*, std::shared_ptr<Query>> queries_;
+  bool stopped_{false};
+};
+
+std::error_code make_error_code(StubResolver::ErrorCode ec);
+}  // namespace utils
+}  // namespace nekit
+
+namespace std {
+template <>
+struct is_error_code_enum<nekit::utils::StubResolver::ErrorCode>
+    : public true_type {};
+}  // namespace std
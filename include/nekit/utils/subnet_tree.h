@@ -0,0 +1,170 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+
+#include "bloom_filter.h"
+#include "mapped_vector.h"
+
+namespace nekit {
+namespace utils {
+
+// A path compressed binary trie (Patricia trie) of IPv4 and IPv6 prefixes,
+// each carrying a value. A lookup walks at most one node per distinct prefix
+// length on the path of the address, so it takes O(prefix length) bit tests
+// regardless of the number of prefixes. Nodes are kept in one vector.
+class SubnetTree {
+ public:
+  SubnetTree();
+
+  // The host bits of `address` are ignored. If the prefix is already added the
+  // lower value is kept.
+  void Insert(const boost::asio::ip::address& address, unsigned prefix,
+              uint32_t value = 0);
+
+  bool Contains(const boost::asio::ip::address& address) const;
+
+  // Returns `false` if no prefix contains `address`.
+  bool LongestMatch(const boost::asio::ip::address& address,
+                    uint32_t* value) const;
+
+  // Calls `visitor(prefix, value)` for every prefix containing `address`, from
+  // the shortest one.
+  template <typename Visitor>
+  void ForEachMatch(const boost::asio::ip::address& address,
+                    Visitor visitor) const {
+    bool v4 = address.is_v4();
+    Key key = MakeKey(address);
+    if (!MayMatch(key, v4)) {
+      return;
+    }
+    uint32_t index = v4 ? kV4Root : kV6Root;
+    while (true) {
+      const Node& node = nodes_[index];
+      if (node.has_value) {
+        visitor(node.prefix, node.value);
+      }
+      if (node.prefix == (v4 ? 32 : 128)) {
+        return;
+      }
+      index = node.children[Bit(key, node.prefix)];
+      if (!index || !Covers(nodes_[index], key)) {
+        return;
+      }
+    }
+  }
+
+  // Calls `visitor(address, prefix, value)` for every prefix added.
+  template <typename Visitor>
+  void ForEach(Visitor visitor) const {
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+      const Node& node = nodes_[i];
+      if (node.has_value) {
+        visitor(MakeAddress(node.key, node.v4), node.prefix, node.value);
+      }
+    }
+  }
+
+  // Adds a Bloom filter of the prefixes, so an address no prefix contains is
+  // mostly rejected by testing the filter once for each distinct prefix
+  // length instead of walking the tree. Prefixes inserted later are added
+  // to it.
+  void BuildFilter(double bits_per_key);
+
+  size_t size() const { return size_; }
+  size_t memory_usage() const {
+    return nodes_.memory_usage() + filter_.memory_usage();
+  }
+
+  // Releases the memory reserved for later insertions.
+  void ShrinkToFit() { nodes_.ShrinkToFit(); }
+
+  // Appends the nodes as they are, in native byte order, so `Map` can use
+  // them in place.
+  void Save(std::string* out) const;
+
+  // Replaces the tree with the one saved at `data`, which must be 8 byte
+  // aligned and stay valid while `owner` is alive. The nodes are checked in
+  // one pass. The filter is dropped. Returns `false` and leaves the tree
+  // unchanged if the data is invalid.
+  bool Map(const void* data, size_t size, std::shared_ptr<const void> owner);
+  bool mapped() const { return nodes_.mapped(); }
+
+ private:
+  // The address as a 128-bit big endian number, IPv4 addresses take the high
+  // 32 bits.
+  struct Key {
+    uint64_t high, low;
+  };
+
+  struct Node {
+    Key key;
+    uint32_t children[2];
+    uint32_t value;
+    uint8_t prefix;
+    // Bytes rather than bools since a mapped image may hold any value here.
+    uint8_t has_value;
+    uint8_t v4;
+  };
+
+  // Index 0 is never a child so it marks a missing child.
+  static const uint32_t kV4Root = 0;
+  static const uint32_t kV6Root = 1;
+
+  void AddToFilter(const Key& key, unsigned prefix, bool v4);
+  bool MayMatch(const Key& key, bool v4) const;
+  static uint64_t FilterHash(const Key& key, unsigned prefix, bool v4);
+
+  static Key MakeKey(const boost::asio::ip::address& address);
+  static boost::asio::ip::address MakeAddress(const Key& key, bool v4);
+  static Key Mask(const Key& key, unsigned prefix);
+  static unsigned CommonPrefix(const Key& lhs, const Key& rhs,
+                               unsigned limit);
+
+  static unsigned Bit(const Key& key, unsigned position) {
+    return position < 64 ? (key.high >> (63 - position)) & 1
+                         : (key.low >> (127 - position)) & 1;
+  }
+
+  static bool Covers(const Node& node, const Key& key) {
+    Key masked = Mask(key, node.prefix);
+    return masked.high == node.key.high && masked.low == node.key.low;
+  }
+
+  uint32_t NewNode(const Key& key, unsigned prefix, bool v4);
+
+  MappedVector<Node> nodes_;
+  size_t size_{0};
+
+  BloomFilter filter_;
+  // The distinct prefix lengths of IPv4 and IPv6 prefixes, for the filter.
+  std::vector<uint8_t> lengths_[2];
+};
+}  // namespace utils
+}  // namespace nekit
@@ -22,40 +22,131 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/asio.hpp>
-#include <boost/thread/thread.hpp>
 
+#include "../config.h"
 #include "resolver_interface.h"
 
 namespace nekit {
 namespace utils {
+// Resolves with `getaddrinfo` on a pool of threads. Lookups wait in a bounded
+// queue ordered by priority, then by arrival. A lookup fails with `TimedOut`
+// if it is not answered before its deadline, whether it is still queued or
+// running. Canceled lookups are dropped from the queue without being run.
+//
+// The pool starts with `min_threads` threads and grows up to `max_threads`
+// when every thread is busy. Threads above the minimum exit after being idle
+// for the idle timeout, `NEKIT_SYSTEM_RESOLVER_IDLE_TIMEOUT` by default.
 class SystemResolver : public ResolverInterface, private LifeTime {
  public:
+  enum class ErrorCode { NoError = 0, QueueFull, TimedOut };
+
+  enum class Priority { High = 0, Normal, Low };
+
+  struct Statistics {
+    size_t queue_depth;
+    size_t max_queue_depth;
+    size_t threads;
+    size_t busy_threads;
+    uint64_t completed;
+    uint64_t rejected;
+    uint64_t timed_out;
+    uint64_t canceled;
+    // Time spent in the queue and in `getaddrinfo` by completed lookups.
+    std::chrono::microseconds total_wait;
+    std::chrono::microseconds max_wait;
+    std::chrono::microseconds total_resolve;
+    std::chrono::microseconds max_resolve;
+  };
+
   SystemResolver(boost::asio::io_context* io, size_t thread_count);
+  SystemResolver(boost::asio::io_context* io, size_t min_threads,
+                 size_t max_threads);
   ~SystemResolver();
 
+  void set_queue_limit(size_t limit);
+  void set_idle_timeout(std::chrono::milliseconds timeout);
+  void set_timeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+
   Cancelable Resolve(std::string domain, AddressPreference preference,
                      EventHandler handler) override
       __attribute__((warn_unused_result));
 
+  Cancelable ResolveWithPriority(std::string domain,
+                                 AddressPreference preference,
+                                 Priority priority, EventHandler handler)
+      __attribute__((warn_unused_result));
+
+  // Queued lookups are dropped, their handlers will never be called.
   void Stop() override;
   void Reset() override;
 
+  Statistics statistics() const;
+
   boost::asio::io_context* io() override;
 
  private:
+  using Clock = std::chrono::steady_clock;
+  using Addresses = std::shared_ptr<std::vector<boost::asio::ip::address>>;
+
+  struct Job;
+
+  Cancelable Lookup(std::string domain, bool v6, Priority priority,
+                    EventHandler handler);
+  void Cancel(const std::shared_ptr<Job>& job);
+
+  // These are called with `mutex_` held.
+  void Spawn();
+  void ReapExited();
+  std::shared_ptr<Job> Pop();
+  bool Remove(const std::shared_ptr<Job>& job);
+
+  void Work();
+  std::error_code Run(const Job& job, Addresses* addresses);
+  void Post(std::shared_ptr<Job> job, Addresses addresses, std::error_code ec);
+  void Finish(const std::shared_ptr<Job>& job, Addresses addresses,
+              std::error_code ec);
+
   std::error_code ConvertBoostError(const boost::system::error_code& ec);
 
   boost::asio::io_context* main_io_;
 
-  size_t thread_count_;
-  boost::thread_group thread_group_;
-  std::unique_ptr<
-      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>
-      work_guard_;
-  std::unique_ptr<boost::asio::io_context> resolve_io_;
+  size_t min_threads_;
+  size_t max_threads_;
+  std::chrono::milliseconds timeout_{NEKIT_SYSTEM_RESOLVER_TIMEOUT};
+  uint64_t next_job_id_{0};
+  // Jobs that are not finished, only accessed on `main_io_`.
+  std::unordered_map<uint64_t, std::shared_ptr<Job>> jobs_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::array<std::deque<std::shared_ptr<Job>>, 3> queues_;
+  size_t queue_limit_{NEKIT_SYSTEM_RESOLVER_QUEUE_SIZE};
+  std::chrono::milliseconds idle_timeout_{NEKIT_SYSTEM_RESOLVER_IDLE_TIMEOUT};
+  std::unordered_map<std::thread::id, std::thread> threads_;
+  std::vector<std::thread::id> exited_;
+  size_t idle_threads_{0};
+  bool stopping_{false};
+  Statistics statistics_{};
 };
+
+std::error_code make_error_code(SystemResolver::ErrorCode ec);
 }  // namespace utils
 }  // namespace nekit
+
+namespace std {
+template <>
+struct is_error_code_enum<nekit::utils::SystemResolver::ErrorCode>
+    : public true_type {};
+}  // namespace std
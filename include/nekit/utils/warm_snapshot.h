@@ -0,0 +1,85 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "dns_cache.h"
+
+namespace nekit {
+namespace utils {
+
+// A binary file holding the positive entries of a `DnsCache` with their
+// absolute expiration time, and rule decisions keyed by host, so a restarted
+// process does not start cold.
+//
+// The file is memory mapped and only the header is checked when it is opened,
+// so the cost does not grow with the size of the snapshot. Each record is
+// checked when it is looked up, records are sorted by key for binary search.
+// The file is written in native byte order and rejected on a host with a
+// different one.
+class WarmSnapshot : private boost::noncopyable {
+ public:
+  using Decisions = std::vector<std::pair<std::string, uint32_t>>;
+
+  ~WarmSnapshot();
+
+  // `decision_tag` identifies the rule set the decisions are made with, e.g.,
+  // a hash of the configuration. The file is replaced atomically.
+  static std::error_code Write(const std::string& path, const DnsCache& cache,
+                               const Decisions& decisions,
+                               uint64_t decision_tag);
+
+  static std::shared_ptr<WarmSnapshot> Open(const std::string& path,
+                                            std::error_code& ec);
+
+  // Returns `false` if there is no valid entry of `key` that has not expired.
+  bool FindAddresses(const std::string& key, DnsCache::Addresses* addresses,
+                     std::chrono::seconds* remaining,
+                     std::chrono::seconds* ttl) const;
+
+  bool FindDecision(const std::string& key, uint32_t* value) const;
+
+  uint64_t decision_tag() const;
+  size_t address_entry_count() const;
+  size_t decision_count() const;
+
+ private:
+  WarmSnapshot(const uint8_t* data, size_t size);
+
+  template <typename Record>
+  const Record* Find(uint64_t offset, uint32_t count,
+                     const std::string& key) const;
+
+  const uint8_t* data_;
+  size_t size_;
+};
+}  // namespace utils
+}  // namespace nekit
@@ -24,6 +24,10 @@
 
 #include "nekit/proxy_manager.h"
 #include "nekit/utils/log.h"
+#include "nekit/utils/warm_snapshot.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Proxy Manager"
 
 namespace nekit {
 void ProxyManager::SetRuleManager(
@@ -33,6 +37,23 @@ void ProxyManager::SetRuleManager(
   rule_manager_ = std::move(rule_manager);
 }
 
+void ProxyManager::PublishRules(
+    std::shared_ptr<const rule::RuleSnapshot> snapshot, uint64_t rule_set_tag) {
+  BOOST_ASSERT(rule_manager_);
+
+  // The tag is only touched on the thread of the manager, like the rules.
+  boost::asio::post(*io_, [this, snapshot, rule_set_tag]() {
+    rule_set_tag_ = rule_set_tag;
+    rule_manager_->Publish(snapshot);
+    NEINFO << "Published " << snapshot->size() << " rules.";
+    // Publishing clears the decision cache, the same rules can use the
+    // decisions again.
+    if (RestoreDecisions()) {
+      NEINFO << "Kept the rule decisions of the warm snapshot.";
+    }
+  });
+}
+
 void ProxyManager::SetResolver(
     std::unique_ptr<utils::ResolverInterface> &&resolver) {
   BOOST_VERIFY(CheckOrSetIo(resolver.get()));
@@ -47,11 +68,21 @@ void ProxyManager::AddListener(
   listeners_.emplace_back(std::move(listener));
 }
 
+void ProxyManager::SetWarmSnapshot(std::shared_ptr<utils::DnsCache> cache,
+                                   const std::string &path,
+                                   uint64_t rule_set_tag) {
+  dns_cache_ = cache;
+  snapshot_path_ = path;
+  rule_set_tag_ = rule_set_tag;
+}
+
 void ProxyManager::Run() {
   BOOST_ASSERT(rule_manager_);
   BOOST_ASSERT(resolver_);
   BOOST_ASSERT(listeners_.size());
 
+  LoadWarmSnapshot();
+
   auto handler =
       [this](std::unique_ptr<data_flow::LocalDataFlowInterface> &&data_flow,
              std::error_code ec) {
@@ -73,6 +104,8 @@ void ProxyManager::Run() {
 void ProxyManager::Stop() {
   resolver_->Stop();
 
+  SaveWarmSnapshot();
+
   for (auto &listener : listeners_) {
     listener->Close();
   }
@@ -91,4 +124,57 @@ bool ProxyManager::CheckOrSetIo(utils::AsyncIoInterface *io_interface) {
   return io_ == io_interface->io();
 }
 
+void ProxyManager::LoadWarmSnapshot() {
+  if (!dns_cache_ || snapshot_path_.empty()) {
+    return;
+  }
+
+  std::error_code ec;
+  auto snapshot = utils::WarmSnapshot::Open(snapshot_path_, ec);
+  if (ec) {
+    NEINFO << "No warm snapshot loaded from " << snapshot_path_ << " due to "
+           << ec << ".";
+    return;
+  }
+
+  NEINFO << "Loaded warm snapshot with " << snapshot->address_entry_count()
+         << " DNS entries.";
+  dns_cache_->set_snapshot(snapshot);
+
+  warm_snapshot_ = snapshot;
+  if (RestoreDecisions()) {
+    NEINFO << "Loaded " << snapshot->decision_count() << " rule decisions.";
+  }
+}
+
+bool ProxyManager::RestoreDecisions() {
+  auto decision_cache = rule_manager_->decision_cache();
+  if (!warm_snapshot_ || !decision_cache || !rule_set_tag_ ||
+      warm_snapshot_->decision_tag() != rule_set_tag_) {
+    return false;
+  }
+
+  decision_cache->set_snapshot(warm_snapshot_);
+  return true;
+}
+
+void ProxyManager::SaveWarmSnapshot() {
+  if (!dns_cache_ || snapshot_path_.empty()) {
+    return;
+  }
+
+  utils::WarmSnapshot::Decisions decisions;
+  auto decision_cache = rule_manager_->decision_cache();
+  if (decision_cache && rule_set_tag_) {
+    decisions = decision_cache->Decisions();
+  }
+
+  auto ec = utils::WarmSnapshot::Write(snapshot_path_, *dns_cache_, decisions,
+                                       rule_set_tag_);
+  if (ec) {
+    NEERROR << "Failed to save warm snapshot to " << snapshot_path_
+            << " due to " << ec << ".";
+  }
+}
+
 }  // namespace nekit
@@ -0,0 +1,95 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/rule/decision_cache.h"
+
+#include <boost/assert.hpp>
+
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Decision Cache"
+
+namespace nekit {
+namespace rule {
+
+DecisionCache::DecisionCache(size_t capacity) : capacity_{capacity} {
+  BOOST_ASSERT(capacity_);
+}
+
+bool DecisionCache::Lookup(const std::string& key, uint32_t* position) {
+  auto iter = entries_.find(key);
+  if (iter != entries_.end()) {
+    list_.splice(list_.begin(), list_, iter->second);
+    *position = iter->second->second;
+    statistics_.hits++;
+    return true;
+  }
+
+  if (snapshot_ && snapshot_->FindDecision(key, position)) {
+    statistics_.hits++;
+    statistics_.snapshot_hits++;
+    Insert(key, *position);
+    return true;
+  }
+
+  statistics_.misses++;
+  return false;
+}
+
+void DecisionCache::Insert(const std::string& key, uint32_t position) {
+  auto iter = entries_.find(key);
+  if (iter != entries_.end()) {
+    iter->second->second = position;
+    list_.splice(list_.begin(), list_, iter->second);
+    return;
+  }
+
+  if (entries_.size() >= capacity_) {
+    entries_.erase(list_.back().first);
+    list_.pop_back();
+  }
+
+  list_.emplace_front(key, position);
+  entries_.emplace(key, list_.begin());
+}
+
+void DecisionCache::Clear() {
+  list_.clear();
+  entries_.clear();
+  if (snapshot_ && snapshot_->decision_count()) {
+    NEINFO << "Dropped " << snapshot_->decision_count()
+           << " rule decisions of the warm snapshot since the rules changed.";
+  }
+  snapshot_.reset();
+}
+
+utils::WarmSnapshot::Decisions DecisionCache::Decisions() const {
+  return utils::WarmSnapshot::Decisions(list_.begin(), list_.end());
+}
+
+double DecisionCache::hit_ratio() const {
+  auto total = statistics_.hits + statistics_.misses;
+  return total ? double(statistics_.hits) / total : 0;
+}
+}  // namespace rule
+}  // namespace nekit
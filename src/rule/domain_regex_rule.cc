@@ -29,13 +29,19 @@ namespace rule {
 DomainRegexRule::DomainRegexRule(RuleHandler handler) : handler_{handler} {}
 
 bool DomainRegexRule::AddRegex(const std::string &expression) {
-  try {
-    regex_list_.emplace_back(expression,
-                             std::regex::ECMAScript | std::regex::nosubs |
-                                 std::regex::icase | std::regex::optimize);
-  } catch (...) {
+  return regex_set_.Add(expression);
+}
+
+bool DomainRegexRule::Load(std::shared_ptr<const RuleSetImage> image,
+                           const std::string &name) {
+  std::vector<std::string> expressions;
+  if (!image->ReadRegexes(name, &expressions)) {
     return false;
   }
+
+  for (const auto &expression : expressions) {
+    regex_set_.Add(expression);
+  }
   return true;
 }
 
@@ -47,13 +53,16 @@ MatchResult DomainRegexRule::Match(std::shared_ptr<utils::Session> session) {
   }
 
   const std::string &domain = session->endpoint()->host();
-  for (const auto &regex : regex_list_) {
-    if (std::regex_search(domain, regex)) {
-      return MatchResult::Match;
-    }
-  }
+  return regex_set_.Search(domain) ? MatchResult::Match
+                                  : MatchResult::NotMatch;
+}
 
-  return MatchResult::NotMatch;
+RuleIndex::Kind DomainRegexRule::AddToIndex(RuleIndex *index,
+                                            uint32_t position) {
+  (void)index;
+  (void)position;
+  regex_set_.Prepare();
+  return RuleIndex::Kind::Dynamic;
 }
 
 std::unique_ptr<data_flow::RemoteDataFlowInterface>
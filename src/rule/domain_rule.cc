@@ -29,18 +29,46 @@ namespace rule {
 DomainRule::DomainRule(RuleHandler handler) : handler_{handler} {}
 
 void DomainRule::AddDomain(const std::string &domain) {
-  domains_.emplace(domain);
+  domains_.AddDomain(domain);
+}
+
+void DomainRule::AddSuffix(const std::string &domain) {
+  domains_.AddSuffix(domain);
+}
+
+bool DomainRule::Load(std::shared_ptr<const RuleSetImage> image,
+                      const std::string &name) {
+  const void *data;
+  size_t size;
+  return image->Find(name, RuleSetImage::Kind::Domains, &data, &size) &&
+         domains_.Map(data, size, std::move(image));
 }
 
 MatchResult DomainRule::Match(std::shared_ptr<utils::Session> session) {
   if (session->endpoint()->type() == utils::Endpoint::Type::Domain &&
-      domains_.find(session->endpoint()->host()) != domains_.end()) {
+      domains_.Contains(session->endpoint()->host())) {
     return MatchResult::Match;
   } else {
     return MatchResult::NotMatch;
   }
 }
 
+RuleIndex::Kind DomainRule::AddToIndex(RuleIndex *index, uint32_t position) {
+  if (domains_.mapped()) {
+    return RuleIndex::Kind::Dynamic;
+  }
+
+  domains_.ForEach(
+      [index, position](const std::string &domain, bool suffix, uint32_t) {
+        if (suffix) {
+          index->AddDomainSuffix(domain, position);
+        } else {
+          index->AddDomain(domain, position);
+        }
+      });
+  return RuleIndex::Kind::Domain;
+}
+
 std::unique_ptr<data_flow::RemoteDataFlowInterface> DomainRule::GetDataFlow(
     std::shared_ptr<utils::Session> session) {
   return handler_(session);
@@ -0,0 +1,83 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/rule/rule_index.h"
+
+#include <algorithm>
+
+namespace nekit {
+namespace rule {
+
+constexpr uint32_t RuleIndex::kNoMatch;
+
+void RuleIndex::AddDomain(const std::string& domain, uint32_t rule) {
+  domains_.AddDomain(domain, rule);
+}
+
+void RuleIndex::AddDomainSuffix(const std::string& domain, uint32_t rule) {
+  domains_.AddSuffix(domain, rule);
+}
+
+void RuleIndex::AddPrefix(const std::string& prefix, uint32_t rule) {
+  prefixes_.AddPrefix(prefix, rule);
+}
+
+void RuleIndex::AddSuffix(const std::string& suffix, uint32_t rule) {
+  suffixes_.AddPrefix(suffix, rule);
+}
+
+void RuleIndex::AddSubnet(const boost::asio::ip::address& address,
+                          unsigned prefix, uint32_t rule) {
+  subnets_.Insert(address, prefix, rule);
+}
+
+void RuleIndex::Build() {
+  prefixes_.Build();
+  suffixes_.Build();
+}
+
+void RuleIndex::BuildFilters(double bits_per_key) {
+  domains_.BuildFilter(bits_per_key);
+  subnets_.BuildFilter(bits_per_key);
+}
+
+uint32_t RuleIndex::MatchDomain(const std::string& domain) const {
+  uint32_t result = domains_.Match(domain);
+  Lower(&result, prefixes_.MatchLowest(domain));
+  Lower(&result, suffixes_.MatchLowest(domain));
+  return result;
+}
+
+uint32_t RuleIndex::MatchAddress(
+    const boost::asio::ip::address& address) const {
+  uint32_t result = kNoMatch;
+  subnets_.ForEachMatch(address, [&result](unsigned, uint32_t rule) {
+    Lower(&result, rule);
+  });
+  return result;
+}
+
+void RuleIndex::Lower(uint32_t* current, uint32_t rule) {
+  *current = std::min(*current, rule);
+}
+}  // namespace rule
+}  // namespace nekit
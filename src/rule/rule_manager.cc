@@ -22,6 +22,11 @@
 
 #include "nekit/rule/rule_manager.h"
 
+#include <algorithm>
+#include <utility>
+
+#include <boost/assert.hpp>
+
 namespace nekit {
 namespace rule {
 
@@ -29,60 +34,304 @@ RuleManager::RuleManager(boost::asio::io_context* io) : io_{io} {}
 
 void RuleManager::AppendRule(std::shared_ptr<RuleInterface> rule) {
   rules_.push_back(rule);
+  Swap(nullptr);
+}
+
+void RuleManager::EnableDecisionCache(size_t capacity) {
+  decision_cache_ = std::make_unique<DecisionCache>(capacity);
+}
+
+void RuleManager::EnablePrefilter(double false_positive_rate) {
+  prefilter_bits_per_key_ = utils::BloomFilter::BitsPerKey(false_positive_rate);
+  snapshot_.reset();
+}
+
+void RuleManager::Compile() {
+  snapshot_ = std::make_shared<RuleSnapshot>(rules_, prefilter_bits_per_key_);
+  counters_.assign(profiling_ ? snapshot_->size() : 0, Counters{});
+}
+
+void RuleManager::EnableProfiling(unsigned sample_interval) {
+  profiling_ = true;
+  sample_interval_ = std::max(sample_interval, 1u);
+  counters_.assign(snapshot_ ? snapshot_->size() : 0, Counters{});
+}
+
+std::vector<RuleProfile> RuleManager::Profile() const {
+  std::vector<RuleProfile> profiles;
+  if (!profiling_ || !snapshot_) {
+    return profiles;
+  }
+
+  for (size_t i = 0; i < snapshot_->size(); i++) {
+    const Counters& counters = counters_[i];
+    profiles.push_back(
+        RuleProfile{snapshot_->rules()[i],
+                    snapshot_->kind(i) != RuleIndex::Kind::Dynamic,
+                    counters.matches, counters.not_matches,
+                    counters.resolve_needed, counters.samples,
+                    counters.sampled_time});
+  }
+  return profiles;
+}
+
+void RuleManager::Publish(std::shared_ptr<const RuleSnapshot> snapshot) {
+  BOOST_ASSERT(snapshot);
+
+  if (io_->get_executor().running_in_this_thread()) {
+    Swap(std::move(snapshot));
+    return;
+  }
+
+  boost::asio::post(*io_, [this, snapshot, lifetime{life_time_cancelable()}]() {
+    if (!lifetime.canceled()) {
+      Swap(snapshot);
+    }
+  });
+}
+
+std::shared_ptr<const RuleSnapshot> RuleManager::snapshot() {
+  if (!snapshot_) {
+    Compile();
+  }
+  return snapshot_;
+}
+
+void RuleManager::Swap(Snapshot snapshot) {
+  if (snapshot) {
+    rules_ = snapshot->rules();
+  }
+  snapshot_ = std::move(snapshot);
+  counters_.assign(profiling_ && snapshot_ ? snapshot_->size() : 0,
+                   Counters{});
+  // Positions of the old rules mean nothing in the new ones.
+  if (decision_cache_) {
+    decision_cache_->Clear();
+  }
 }
 
 utils::Cancelable RuleManager::Match(std::shared_ptr<utils::Session> session,
                                      EventHandler handler) {
-  auto cancelable = utils::Cancelable();
-  boost::asio::post(*io(), [this, session, cancelable,
+  auto wait = std::make_shared<utils::Cancelable>();
+  auto cancelable = utils::Cancelable([wait]() { wait->Cancel(); });
+  if (speculative_resolution_) {
+    const auto& endpoint = session->endpoint();
+    if (endpoint->type() == utils::Endpoint::Type::Domain &&
+        endpoint->resolver() && !endpoint->IsResolved() &&
+        !endpoint->IsResolving()) {
+      // The result is kept by the endpoint for whoever waits for it, unless
+      // the match is canceled before anyone does.
+      *wait = endpoint->Resolve([](std::error_code) {});
+    }
+  }
+
+  boost::asio::post(*io(), [this, session, cancelable, wait,
                             lifetime{life_time_cancelable()}, handler]() {
     if (cancelable.canceled() || lifetime.canceled()) {
       return;
     }
 
-    MatchIterator(rules_.cbegin(), session, cancelable, handler);
+    auto current = snapshot();
+    if (decision_cache_) {
+      uint32_t position;
+      if (decision_cache_->Lookup(DecisionKey(session->endpoint().get()),
+                                  &position) &&
+          (position < current->size() || position == RuleIndex::kNoMatch)) {
+        if (position < current->size()) {
+          // Count it so hot hosts still show up in the profile.
+          if (Counters* counters = CountersOf(current)) {
+            counters[position].matches++;
+          }
+          handler(current->rules()[position], ErrorCode::NoError);
+        } else {
+          handler(nullptr, ErrorCode::NoMatch);
+        }
+        return;
+      }
+    }
+
+    MatchFrom(std::move(current), 0, bool(decision_cache_), session,
+              cancelable, wait, handler);
   });
 
   return cancelable;
 }
 
-void RuleManager::MatchIterator(
-    std::vector<std::shared_ptr<RuleInterface>>::const_iterator iter,
-    std::shared_ptr<utils::Session> session, utils::Cancelable cancelable,
-    EventHandler handler) {
+void RuleManager::MatchFrom(Snapshot snapshot, size_t position, bool cache,
+                            std::shared_ptr<utils::Session> session,
+                            utils::Cancelable cancelable, ResolutionWait wait,
+                            EventHandler handler) {
   if (cancelable.canceled()) {
     return;
   }
 
-  while (iter != rules_.cend()) {
-    switch ((*iter)->Match(session)) {
+  const RuleSnapshot& rules = *snapshot;
+  const RuleIndex& index = rules.index();
+  Counters* counters = CountersOf(snapshot);
+  const auto& endpoint = session->endpoint();
+  size_t domain_match = RuleIndex::kNoMatch;
+  bool is_domain = endpoint->type() == utils::Endpoint::Type::Domain;
+  if (is_domain) {
+    domain_match = index.MatchDomain(endpoint->host());
+  }
+
+  while (position < rules.size()) {
+    // Address rules need the domain resolved, the first one asks for it.
+    size_t address_match = RuleIndex::kNoMatch;
+    bool resolve_needed = false;
+    if (rules.next_address(position) < rules.size()) {
+      if (endpoint->IsAddressAvailable()) {
+        address_match = index.MatchAddress(endpoint->address());
+      } else if (endpoint->IsResolvable()) {
+        address_match = rules.next_address(position);
+        resolve_needed = true;
+      }
+    }
+
+    // Rules before `position` have not matched, so neither do their index
+    // entries.
+    size_t next = rules.next_dynamic(position);
+    if (domain_match >= position) {
+      next = std::min(next, domain_match);
+    }
+    if (address_match >= position) {
+      next = std::min(next, address_match);
+    }
+
+    // The result of address rules before the decision depends on whether the
+    // domain is resolved.
+    if (is_domain && rules.next_address(position) <= next &&
+        rules.next_address(position) < rules.size()) {
+      cache = false;
+    }
+
+    if (next >= rules.size()) {
+      break;
+    }
+
+    if (next == address_match && resolve_needed) {
+      if (counters) {
+        counters[next].resolve_needed++;
+      }
+      ResolveAndMatchFrom(std::move(snapshot), next, session, cancelable,
+                          std::move(wait), handler);
+      return;
+    }
+
+    if (next == domain_match || next == address_match) {
+      if (counters) {
+        counters[next].matches++;
+      }
+      Decide(snapshot, next, cache, session, handler);
+      return;
+    }
+
+    if (is_domain && rules.rules()[next]->DependsOnResolution()) {
+      cache = false;
+    }
+
+    RuleInterface* rule = rules.rules()[next].get();
+    switch (counters ? ProfileMatch(rule, session, &counters[next])
+                     : rule->Match(session)) {
       case MatchResult::Match:
-        handler(*iter, ErrorCode::NoError);
+        Decide(snapshot, next, cache, session, handler);
         return;
       case MatchResult::NotMatch:
-        iter++;
+        position = next + 1;
         break;
-      case MatchResult::ResolveNeeded: {
-        // The lifetime of callback block is already bound to the caller of
-        // `Match` and `this`. There is no need to guard the lifetime of the
-        // callback in another `Cancelable`.
-        (void)session->endpoint()->Resolve(
-            [this, handler, cancelable, lifetime{life_time_cancelable()},
-             session, iter](std::error_code ec) mutable {
-              // Resolve failure should be handled by rules.
-              (void)ec;
-
-              if (cancelable.canceled() || lifetime.canceled()) {
-                return;
-              }
-
-              MatchIterator(iter, session, cancelable, handler);
-            });
+      case MatchResult::ResolveNeeded:
+        ResolveAndMatchFrom(std::move(snapshot), next, session, cancelable,
+                            std::move(wait), handler);
         return;
-      }
     }
   }
-  handler(nullptr, ErrorCode::NoMatch);
+  Decide(snapshot, RuleIndex::kNoMatch, cache, session, handler);
+}
+
+MatchResult RuleManager::ProfileMatch(RuleInterface* rule,
+                                     std::shared_ptr<utils::Session> session,
+                                     Counters* counters) {
+  MatchResult result;
+  uint64_t evaluations =
+      counters->matches + counters->not_matches + counters->resolve_needed;
+  if (evaluations % sample_interval_) {
+    result = rule->Match(session);
+  } else {
+    auto start = std::chrono::steady_clock::now();
+    result = rule->Match(session);
+    counters->sampled_time += std::chrono::steady_clock::now() - start;
+    counters->samples++;
+  }
+
+  switch (result) {
+    case MatchResult::Match:
+      counters->matches++;
+      break;
+    case MatchResult::NotMatch:
+      counters->not_matches++;
+      break;
+    case MatchResult::ResolveNeeded:
+      counters->resolve_needed++;
+      break;
+  }
+  return result;
+}
+
+void RuleManager::Decide(const Snapshot& snapshot, size_t position, bool cache,
+                         std::shared_ptr<utils::Session> session,
+                         EventHandler handler) {
+  if (decision_cache_) {
+    // A decision made with replaced rules is not cached.
+    if (cache && snapshot == snapshot_) {
+      decision_cache_->Insert(DecisionKey(session->endpoint().get()),
+                              uint32_t(position));
+    } else {
+      decision_cache_->RecordUncacheable();
+    }
+  }
+
+  if (position < snapshot->size()) {
+    handler(snapshot->rules()[position], ErrorCode::NoError);
+  } else {
+    handler(nullptr, ErrorCode::NoMatch);
+  }
+}
+
+void RuleManager::ResolveAndMatchFrom(Snapshot snapshot, size_t position,
+                                      std::shared_ptr<utils::Session> session,
+                                      utils::Cancelable cancelable,
+                                      ResolutionWait wait,
+                                      EventHandler handler) {
+  // The lifetime of callback block is already bound to the caller of `Match`
+  // and `this`. There is no need to guard the lifetime of the callback in
+  // another `Cancelable`. The decision depends on the resolution so it is not
+  // cached. The snapshot is kept so the match goes on with the same rules.
+  auto speculative = *wait;
+  *wait = session->endpoint()->WaitResolved(
+      [this, handler, cancelable, wait, lifetime{life_time_cancelable()},
+       session, snapshot, position](std::error_code ec) mutable {
+        // Resolve failure should be handled by rules.
+        (void)ec;
+
+        if (cancelable.canceled() || lifetime.canceled()) {
+          return;
+        }
+
+        MatchFrom(std::move(snapshot), position, false, session, cancelable,
+                  std::move(wait), handler);
+      });
+  // The match waits itself now, it keeps the resolution going.
+  speculative.Cancel();
+}
+
+std::string RuleManager::DecisionKey(utils::Endpoint* endpoint) {
+  // Affix rules look the host up in a `CompactTrie`, which compares bytes
+  // exactly, so neither is the key case folded nor the trailing dot removed.
+  // Addresses are marked so they never collide with domains.
+  if (endpoint->type() == utils::Endpoint::Type::Address) {
+    return "@" + endpoint->address().to_string();
+  }
+  return endpoint->host();
 }
 
 boost::asio::io_context* RuleManager::io() { return io_; }
@@ -0,0 +1,107 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/rule/rule_profile.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace nekit {
+namespace rule {
+
+namespace {
+// The matches per nanosecond of evaluation.
+double Score(const RuleProfile& profile) {
+  if (!profile.matches) {
+    return 0;
+  }
+  if (profile.indexed) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  double hit_rate = double(profile.matches) / double(profile.evaluations());
+  // An evaluation takes at least a nanosecond, even if none is timed.
+  double cost = std::max<double>(profile.mean_time().count(), 1);
+  return hit_rate / cost;
+}
+}  // namespace
+
+std::vector<size_t> SuggestRuleOrder(const std::vector<RuleProfile>& profiles,
+                                     const CanSwap& can_swap) {
+  std::vector<size_t> order;
+  std::vector<double> scores;
+  for (const auto& profile : profiles) {
+    scores.push_back(Score(profile));
+  }
+
+  // An insertion sort, so a rule only moves past the rules it is swapped with
+  // one at a time and equal scores keep their order.
+  for (size_t i = 0; i < profiles.size(); i++) {
+    size_t position = order.size();
+    order.push_back(i);
+    while (position > 0) {
+      size_t before = order[position - 1];
+      if (scores[before] >= scores[i] ||
+          !can_swap(*profiles[before].rule, *profiles[i].rule)) {
+        break;
+      }
+      order[position] = before;
+      order[position - 1] = i;
+      position--;
+    }
+  }
+  return order;
+}
+
+std::string RuleProfileReport(const std::vector<RuleProfile>& profiles,
+                              const CanSwap& can_swap) {
+  auto order = SuggestRuleOrder(profiles, can_swap);
+  std::vector<size_t> suggested(profiles.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    suggested[order[i]] = i;
+  }
+
+  std::ostringstream report;
+  report << std::setw(6) << "rule" << std::setw(10) << "suggested"
+         << std::setw(12) << "matches" << std::setw(12) << "not matches"
+         << std::setw(10) << "resolves" << std::setw(12) << "mean ns"
+         << "\n";
+  for (size_t i = 0; i < profiles.size(); i++) {
+    const auto& profile = profiles[i];
+    report << std::setw(6) << i << std::setw(10) << suggested[i]
+           << std::setw(12) << profile.matches;
+    if (profile.indexed) {
+      report << std::setw(12) << "-" << std::setw(10)
+             << profile.resolve_needed << std::setw(12) << "indexed";
+    } else {
+      report << std::setw(12) << profile.not_matches << std::setw(10)
+             << profile.resolve_needed << std::setw(12)
+             << profile.mean_time().count();
+    }
+    report << "\n";
+  }
+  return report.str();
+}
+}  // namespace rule
+}  // namespace nekit
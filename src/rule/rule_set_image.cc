@@ -0,0 +1,283 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/rule/rule_set_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "nekit/utils/file.h"
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Rule Set Image"
+
+namespace nekit {
+namespace rule {
+
+namespace {
+const char kMagic[8] = {'N', 'E', 'K', 'I', 'T', 'R', 'S', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrder = 0x01020304;
+// Lists start at a multiple of this so their arrays can be used in place.
+const size_t kAlignment = 8;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t list_count;
+  uint32_t reserved;
+  uint64_t list_offset;
+  uint64_t string_offset;
+  uint64_t string_size;
+};
+
+struct ListRecord {
+  uint32_t name_offset;
+  uint32_t name_length;
+  uint32_t kind;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+bool InBounds(uint64_t offset, uint64_t count, uint64_t size,
+              uint64_t total) {
+  return offset <= total && count <= (total - offset) / size;
+}
+
+template <typename Record>
+void Append(std::string* buffer, const Record& record) {
+  buffer->append(reinterpret_cast<const char*>(&record), sizeof(Record));
+}
+
+void Pad(std::string* buffer) {
+  buffer->append((kAlignment - buffer->size() % kAlignment) % kAlignment,
+                 '\0');
+}
+}  // namespace
+
+void RuleSetImage::Builder::AddDomains(const std::string& name,
+                                       const utils::DomainSet& domains) {
+  std::string data;
+  domains.Save(&data);
+  lists_[name] = std::make_pair(Kind::Domains, std::move(data));
+}
+
+void RuleSetImage::Builder::AddTrie(const std::string& name,
+                                    utils::CompactTrie* trie) {
+  std::string data;
+  trie->Save(&data);
+  lists_[name] = std::make_pair(Kind::Trie, std::move(data));
+}
+
+void RuleSetImage::Builder::AddSubnets(const std::string& name,
+                                       const utils::SubnetTree& subnets) {
+  std::string data;
+  subnets.Save(&data);
+  lists_[name] = std::make_pair(Kind::Subnets, std::move(data));
+}
+
+void RuleSetImage::Builder::AddRegexes(
+    const std::string& name, const std::vector<std::string>& expressions) {
+  // The length of each expression followed by the expression.
+  std::string data;
+  for (const auto& expression : expressions) {
+    uint32_t length = uint32_t(expression.size());
+    Append(&data, length);
+    data.append(expression);
+  }
+  lists_[name] = std::make_pair(Kind::Regexes, std::move(data));
+}
+
+std::error_code RuleSetImage::Builder::Write(const std::string& path) const {
+  std::string strings, records, lists;
+  for (const auto& list : lists_) {
+    ListRecord record{};
+    record.name_offset = uint32_t(strings.size());
+    record.name_length = uint32_t(list.first.size());
+    record.kind = uint32_t(list.second.first);
+    // Relative to the first list for now.
+    record.offset = lists.size();
+    record.size = list.second.second.size();
+    Append(&records, record);
+    strings.append(list.first);
+    lists.append(list.second.second);
+    Pad(&lists);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.list_count = uint32_t(lists_.size());
+  header.list_offset = sizeof(Header);
+  header.string_offset = header.list_offset + records.size();
+  header.string_size = strings.size();
+  Pad(&strings);
+  uint64_t data_offset = header.string_offset + strings.size();
+  for (size_t i = 0; i < lists_.size(); i++) {
+    reinterpret_cast<ListRecord*>(&records[i * sizeof(ListRecord)])->offset +=
+        data_offset;
+  }
+
+  std::string data(reinterpret_cast<const char*>(&header), sizeof(Header));
+  data.append(records).append(strings).append(lists);
+  auto ec = utils::ReplaceFile(path, data);
+  if (ec) {
+    return ec;
+  }
+
+  NEDEBUG << "Wrote " << lists_.size() << " rule lists to " << path << ".";
+  return std::error_code();
+}
+
+RuleSetImage::RuleSetImage(const uint8_t* data, size_t size)
+    : data_{data}, size_{size} {}
+
+RuleSetImage::~RuleSetImage() { munmap(const_cast<uint8_t*>(data_), size_); }
+
+std::shared_ptr<const RuleSetImage> RuleSetImage::Open(const std::string& path,
+                                                       std::error_code& ec) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ec = std::error_code(errno, std::generic_category());
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st)) {
+    ec = std::error_code(errno, std::generic_category());
+    close(fd);
+    return nullptr;
+  }
+
+  size_t size = size_t(st.st_size);
+  if (size < sizeof(Header)) {
+    close(fd);
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return nullptr;
+  }
+
+  // The pages of a private mapping that is never written are those of the
+  // page cache, shared by every process mapping the file.
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    ec = std::error_code(errno, std::generic_category());
+    return nullptr;
+  }
+
+  // Constructed before the checks so the mapping is released on failure.
+  std::shared_ptr<const RuleSetImage> image{
+      new RuleSetImage(static_cast<const uint8_t*>(data), size)};
+
+  Header header;
+  std::memcpy(&header, data, sizeof(Header));
+  bool valid =
+      !std::memcmp(header.magic, kMagic, sizeof(kMagic)) &&
+      header.version == kVersion && header.byte_order == kByteOrder &&
+      header.list_offset % alignof(ListRecord) == 0 &&
+      InBounds(header.list_offset, header.list_count, sizeof(ListRecord),
+               size) &&
+      InBounds(header.string_offset, header.string_size, 1, size);
+  const ListRecord* records = reinterpret_cast<const ListRecord*>(
+      static_cast<const uint8_t*>(data) + header.list_offset);
+  for (uint32_t i = 0; valid && i < header.list_count; i++) {
+    valid = uint64_t(records[i].name_offset) + records[i].name_length <=
+                header.string_size &&
+            records[i].offset % kAlignment == 0 &&
+            InBounds(records[i].offset, records[i].size, 1, size);
+  }
+  if (!valid) {
+    NEWARN << "Rule set image " << path << " is invalid, ignored.";
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return nullptr;
+  }
+
+  NEDEBUG << "Opened rule set image " << path << " with " << header.list_count
+          << " lists.";
+  ec = std::error_code();
+  return image;
+}
+
+bool RuleSetImage::Find(const std::string& name, Kind kind, const void** data,
+                        size_t* size) const {
+  const Header* header = reinterpret_cast<const Header*>(data_);
+  const ListRecord* records =
+      reinterpret_cast<const ListRecord*>(data_ + header->list_offset);
+  const char* strings =
+      reinterpret_cast<const char*>(data_ + header->string_offset);
+
+  // There are few lists, a linear scan is enough.
+  for (uint32_t i = 0; i < header->list_count; i++) {
+    const ListRecord& record = records[i];
+    if (record.kind == uint32_t(kind) &&
+        !name.compare(0, std::string::npos, strings + record.name_offset,
+                      record.name_length)) {
+      *data = data_ + record.offset;
+      *size = size_t(record.size);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RuleSetImage::ReadRegexes(const std::string& name,
+                               std::vector<std::string>* expressions) const {
+  const void* data;
+  size_t size;
+  if (!Find(name, Kind::Regexes, &data, &size)) {
+    return false;
+  }
+
+  const char* current = static_cast<const char*>(data);
+  const char* end = current + size;
+  std::vector<std::string> result;
+  while (current != end) {
+    uint32_t length;
+    if (size_t(end - current) < sizeof(length)) {
+      return false;
+    }
+    std::memcpy(&length, current, sizeof(length));
+    current += sizeof(length);
+    if (length > size_t(end - current)) {
+      return false;
+    }
+    result.emplace_back(current, length);
+    current += length;
+  }
+  *expressions = std::move(result);
+  return true;
+}
+
+size_t RuleSetImage::list_count() const {
+  return reinterpret_cast<const Header*>(data_)->list_count;
+}
+}  // namespace rule
+}  // namespace nekit
@@ -0,0 +1,49 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/rule/rule_snapshot.h"
+
+namespace nekit {
+namespace rule {
+
+RuleSnapshot::RuleSnapshot(std::vector<std::shared_ptr<RuleInterface>> rules,
+                           double prefilter_bits_per_key)
+    : rules_{std::move(rules)},
+      next_dynamic_(rules_.size() + 1, rules_.size()),
+      next_address_(rules_.size() + 1, rules_.size()) {
+  for (size_t i = 0; i < rules_.size(); i++) {
+    kinds_.push_back(rules_[i]->AddToIndex(&index_, uint32_t(i)));
+  }
+  index_.Build();
+  if (prefilter_bits_per_key > 0) {
+    index_.BuildFilters(prefilter_bits_per_key);
+  }
+
+  for (size_t i = rules_.size(); i-- > 0;) {
+    next_dynamic_[i] =
+        kinds_[i] == RuleIndex::Kind::Dynamic ? i : next_dynamic_[i + 1];
+    next_address_[i] =
+        kinds_[i] == RuleIndex::Kind::Address ? i : next_address_[i + 1];
+  }
+}
+}  // namespace rule
+}  // namespace nekit
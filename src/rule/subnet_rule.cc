@@ -30,15 +30,24 @@ SubnetRule::SubnetRule(RuleHandler handler) : handler_{handler} {}
 
 void SubnetRule::AddSubnet(const boost::asio::ip::address &address,
                            uint prefix) {
-  subnets_.emplace_back(address, prefix);
+  subnets_.Insert(address, prefix);
+}
+
+bool SubnetRule::Load(std::shared_ptr<const RuleSetImage> image,
+                      const std::string &name) {
+  const void *data;
+  size_t size;
+  return image->Find(name, RuleSetImage::Kind::Subnets, &data, &size) &&
+         subnets_.Map(data, size, std::move(image));
 }
 
 MatchResult SubnetRule::Match(std::shared_ptr<utils::Session> session) {
   BOOST_ASSERT(session->endpoint());
 
   if (session->endpoint()->IsAddressAvailable()) {
-    return LookUp(session->endpoint()->address()) ? MatchResult::Match
-                                                  : MatchResult::NotMatch;
+    return subnets_.Contains(session->endpoint()->address())
+               ? MatchResult::Match
+               : MatchResult::NotMatch;
   } else {
     if (session->endpoint()->IsResolvable()) {
       return MatchResult::ResolveNeeded;
@@ -47,20 +56,23 @@ MatchResult SubnetRule::Match(std::shared_ptr<utils::Session> session) {
   }
 }
 
+RuleIndex::Kind SubnetRule::AddToIndex(RuleIndex *index, uint32_t position) {
+  if (subnets_.mapped()) {
+    return RuleIndex::Kind::Dynamic;
+  }
+
+  subnets_.ForEach([index, position](const boost::asio::ip::address &address,
+                                     unsigned prefix, uint32_t) {
+    index->AddSubnet(address, prefix, position);
+  });
+  return RuleIndex::Kind::Address;
+}
+
 std::unique_ptr<data_flow::RemoteDataFlowInterface> SubnetRule::GetDataFlow(
     std::shared_ptr<utils::Session> session) {
   BOOST_ASSERT(session->endpoint());
   return handler_(session);
 }
 
-bool SubnetRule::LookUp(const boost::asio::ip::address &address) {
-  for (const auto &subnet : subnets_) {
-    if (subnet.Contains(address)) {
-      return true;
-    }
-  }
-  return false;
-}
-
 }  // namespace rule
 }  // namespace nekit
@@ -0,0 +1,296 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/transport/tcp_connection_pool.h"
+
+#include <sys/socket.h>
+#include <cerrno>
+
+#include <boost/assert.hpp>
+
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "TCP Connection Pool"
+
+namespace nekit {
+namespace transport {
+
+TcpConnectionPool::TcpConnectionPool(boost::asio::io_context* io,
+                                     utils::ResolverInterface* resolver,
+                                     size_t size)
+    : io_{io}, resolver_{resolver}, size_{size}, sweep_timer_{*io} {}
+
+TcpConnectionPool::~TcpConnectionPool() { Close(); }
+
+void TcpConnectionPool::set_tcp_options(
+    std::shared_ptr<const TcpOptions> options) {
+  if (options && options->fast_open) {
+    auto copy = std::make_shared<TcpOptions>(*options);
+    copy->fast_open = false;
+    options = copy;
+  }
+  tcp_options_ = options;
+}
+
+void TcpConnectionPool::Add(const std::string& host, uint16_t port) {
+  BOOST_ASSERT(!closed_);
+
+  auto& pool = pools_[Key(host, port)];
+  if (pool) {
+    return;
+  }
+
+  NEDEBUG << "Start pooling connections to " << host << ":" << port << ".";
+
+  pool = std::make_unique<Pool>();
+  pool->host = host;
+  pool->port = port;
+
+  Refill(pool.get());
+  ScheduleSweep();
+}
+
+bool TcpConnectionPool::Take(const utils::Endpoint& endpoint,
+                             boost::asio::ip::tcp::socket* socket) {
+  BOOST_ASSERT(&socket->get_io_context() == io_);
+
+  auto iter = pools_.find(Key(endpoint.host(), endpoint.port()));
+  if (iter == pools_.end()) {
+    return false;
+  }
+
+  Pool* pool = iter->second.get();
+  // The sweep only runs now and then.
+  Expire(pool, std::chrono::steady_clock::now());
+
+  // The newest connection is the least likely to be closed by the upstream or
+  // a middlebox.
+  while (!pool->idle.empty()) {
+    auto connection = pool->idle.back();
+    pool->idle.pop_back();
+    connection->removed = true;
+
+    boost::system::error_code ec;
+    connection->socket.cancel(ec);
+
+    // The readable event may not be delivered yet.
+    if (!IsHealthy(connection->socket)) {
+      statistics_.broken++;
+      connection->socket.close(ec);
+      continue;
+    }
+
+    NEDEBUG << "Take pooled connection to " << pool->host << ":" << pool->port
+            << ".";
+
+    statistics_.hits++;
+    *socket = std::move(connection->socket);
+    Refill(pool);
+    return true;
+  }
+
+  NEDEBUG << "No pooled connection to " << pool->host << ":" << pool->port
+          << " is available.";
+
+  statistics_.misses++;
+  Refill(pool);
+  return false;
+}
+
+void TcpConnectionPool::Close() {
+  if (closed_) {
+    return;
+  }
+
+  closed_ = true;
+  sweep_timer_.cancel();
+
+  for (auto& pair : pools_) {
+    for (auto& connection : pair.second->idle) {
+      connection->removed = true;
+      boost::system::error_code ec;
+      connection->socket.close(ec);
+    }
+    for (auto& connecting : pair.second->connectors) {
+      connecting.cancelable.Cancel();
+    }
+  }
+
+  // Destroying the connectors aborts pending connects.
+  pools_.clear();
+}
+
+size_t TcpConnectionPool::IdleCount(const std::string& host,
+                                    uint16_t port) const {
+  auto iter = pools_.find(Key(host, port));
+  if (iter == pools_.end()) {
+    return 0;
+  }
+  return iter->second->idle.size();
+}
+
+std::string TcpConnectionPool::Key(const std::string& host, uint16_t port) {
+  return host + ":" + std::to_string(port);
+}
+
+bool TcpConnectionPool::IsHealthy(boost::asio::ip::tcp::socket& socket) {
+  char c;
+  auto n = ::recv(socket.native_handle(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+void TcpConnectionPool::Refill(Pool* pool) {
+  if (closed_ || pool->failed) {
+    return;
+  }
+
+  // A connector may fail before `Connect` returns.
+  while (!closed_ && !pool->failed &&
+         pool->idle.size() + pool->connectors.size() < size_) {
+    auto endpoint = std::make_shared<utils::Endpoint>(pool->host, pool->port);
+    endpoint->set_resolver(resolver_);
+
+    pool->connectors.push_back(
+        {std::make_unique<TcpConnector>(endpoint, io_), utils::Cancelable()});
+    auto connector = pool->connectors.back().connector.get();
+    connector->set_tcp_options(tcp_options_);
+
+    auto cancelable = connector->Connect(
+        [this, pool, connector, cancelable{life_time_cancelable()}](
+            boost::asio::ip::tcp::socket&& socket, std::error_code ec) {
+          if (cancelable.canceled()) {
+            return;
+          }
+
+          // We are called by the connector, release it later.
+          for (auto iter = pool->connectors.begin();
+               iter != pool->connectors.end(); iter++) {
+            if (iter->connector.get() == connector) {
+              std::shared_ptr<TcpConnector> done{std::move(iter->connector)};
+              pool->connectors.erase(iter);
+              boost::asio::post(*io_, [done]() {});
+              break;
+            }
+          }
+
+          if (ec) {
+            // Retry in next sweep instead of hammering the upstream.
+            NEWARN << "Failed to connect to " << pool->host << ":"
+                   << pool->port << " for pooling due to " << ec << ".";
+            pool->failed = true;
+            return;
+          }
+
+          auto connection = std::make_shared<Connection>(std::move(socket));
+          pool->idle.push_back(connection);
+          Watch(pool, connection);
+        });
+
+    // The connector may have failed already.
+    for (auto& connecting : pool->connectors) {
+      if (connecting.connector.get() == connector) {
+        connecting.cancelable = cancelable;
+        break;
+      }
+    }
+  }
+}
+
+void TcpConnectionPool::Watch(Pool* pool,
+                              std::shared_ptr<Connection> connection) {
+  connection->socket.async_wait(
+      boost::asio::ip::tcp::socket::wait_read,
+      [this, pool, connection, cancelable{life_time_cancelable()}](
+          const boost::system::error_code& ec) {
+        if (cancelable.canceled() || connection->removed) {
+          return;
+        }
+
+        NEDEBUG << "Pooled connection to " << pool->host << ":" << pool->port
+                << " is closed or readable (" << ec << "), dropping it.";
+
+        statistics_.broken++;
+        Remove(pool, connection);
+        Refill(pool);
+      });
+}
+
+void TcpConnectionPool::Remove(Pool* pool,
+                               std::shared_ptr<Connection> connection) {
+  connection->removed = true;
+  pool->idle.remove(connection);
+
+  boost::system::error_code ec;
+  connection->socket.close(ec);
+}
+
+void TcpConnectionPool::Expire(Pool* pool,
+                               std::chrono::steady_clock::time_point now) {
+  if (!idle_timeout_.count()) {
+    return;
+  }
+
+  // Connections are appended in the order they are established.
+  while (!pool->idle.empty() &&
+         now - pool->idle.front()->since >= idle_timeout_) {
+    statistics_.expired++;
+    Remove(pool, pool->idle.front());
+  }
+}
+
+void TcpConnectionPool::ScheduleSweep() {
+  if (sweeping_ || closed_) {
+    return;
+  }
+
+  sweeping_ = true;
+  sweep_timer_.expires_after(idle_timeout_.count()
+                                 ? idle_timeout_ / 4
+                                 : std::chrono::milliseconds(5000));
+  sweep_timer_.async_wait([this, cancelable{life_time_cancelable()}](
+                              const boost::system::error_code& ec) {
+    if (cancelable.canceled() || ec) {
+      return;
+    }
+
+    sweeping_ = false;
+    Sweep();
+    ScheduleSweep();
+  });
+}
+
+void TcpConnectionPool::Sweep() {
+  auto now = std::chrono::steady_clock::now();
+
+  for (auto& pair : pools_) {
+    Pool* pool = pair.second.get();
+
+    Expire(pool, now);
+
+    pool->failed = false;
+    Refill(pool);
+  }
+}
+
+}  // namespace transport
+}  // namespace nekit
@@ -22,6 +22,11 @@
 
 #include "nekit/transport/tcp_connector.h"
 
+#include <netinet/in.h>
+#include <atomic>
+#include <cerrno>
+
+#include "nekit/transport/error_code.h"
 #include "nekit/transport/tcp_socket.h"
 #include "nekit/utils/boost_error.h"
 #include "nekit/utils/error.h"
@@ -32,26 +37,60 @@
 
 namespace nekit {
 namespace transport {
+namespace {
+struct AtomicStatistics {
+  std::atomic<uint64_t> attempts{0}, connected{0}, attempt_timeouts{0},
+      deadline_timeouts{0}, refused{0}, other_failures{0};
+};
+
+AtomicStatistics statistics;
+}  // namespace
+
 TcpConnector::TcpConnector(
     std::shared_ptr<const std::vector<boost::asio::ip::address>> addresses,
     uint16_t port, boost::asio::io_context* io)
-    : socket_{*io}, addresses_{addresses}, port_{port} {
+    : socket_{*io},
+      addresses_{addresses},
+      port_{port},
+      attempt_timer_{*io},
+      deadline_timer_{*io} {
   assert(!addresses_->empty());
 }
 
 TcpConnector::TcpConnector(const boost::asio::ip::address& address,
                            uint16_t port, boost::asio::io_context* io)
-    : socket_{*io}, address_{address}, port_{port} {}
+    : socket_{*io},
+      address_{address},
+      port_{port},
+      attempt_timer_{*io},
+      deadline_timer_{*io} {}
 
 TcpConnector::TcpConnector(std::shared_ptr<utils::Endpoint> endpoint,
                            boost::asio::io_context* io)
-    : socket_{*io}, endpoint_{endpoint}, port_{endpoint->port()} {}
+    : socket_{*io},
+      endpoint_{endpoint},
+      port_{endpoint->port()},
+      attempt_timer_{*io},
+      deadline_timer_{*io} {}
+
+TcpConnector::~TcpConnector() { resolve_cancelable_.Cancel(); }
 
 utils::Cancelable TcpConnector::Connect(EventHandler handler) {
   assert(!connecting_);
 
   NEDEBUG << "Begin connecting to remote.";
 
+  if (tcp_options_ && tcp_options_->fast_open &&
+      (attempt_timeout_.count() || connect_timeout_.count())) {
+    // The connect would complete without waiting for the handshake.
+    NEWARN << "TCP Fast Open is disabled since connect timeouts are set.";
+    auto options = std::make_shared<TcpOptions>(*tcp_options_);
+    options->fast_open = false;
+    tcp_options_ = options;
+  }
+
+  StartDeadline(handler);
+
   if (endpoint_) {
     if (endpoint_->IsAddressAvailable()) {
       switch (endpoint_->type()) {
@@ -75,25 +114,26 @@ utils::Cancelable TcpConnector::Connect(EventHandler handler) {
         boost::asio::post(
             socket_.get_executor(),
             [this, handler, cancelable{life_time_cancelable()}]() {
-              if (cancelable.canceled()) {
+              if (cancelable.canceled() || finished_) {
                 return;
               }
 
-              handler(std::move(socket_), endpoint_->resolve_error());
+              Finish(handler, endpoint_->resolve_error());
             });
         return life_time_cancelable();
       } else {
-        (void)endpoint_->Resolve(
+        // The domain may already be resolving speculatively.
+        resolve_cancelable_ = endpoint_->WaitResolved(
             [this, handler,
              cancelable{life_time_cancelable()}](std::error_code ec) mutable {
-              if (cancelable.canceled()) {
+              if (cancelable.canceled() || finished_) {
                 return;
               }
 
               if (ec) {
                 NEERROR << "Can not connect since resolve is failed due to "
                         << endpoint_->resolve_error() << ".";
-                handler(std::move(socket_), ec);
+                Finish(handler, ec);
                 return;
               }
 
@@ -117,6 +157,27 @@ void TcpConnector::Bind(std::shared_ptr<utils::DeviceInterface> device) {
   device_ = device;
 }
 
+void TcpConnector::StartDeadline(EventHandler handler) {
+  if (!connect_timeout_.count()) {
+    return;
+  }
+
+  deadline_timer_.expires_after(connect_timeout_);
+  deadline_timer_.async_wait([this, handler,
+                              cancelable{life_time_cancelable()}](
+                                 const boost::system::error_code& ec) {
+    if (cancelable.canceled() || finished_ || ec) {
+      return;
+    }
+
+    NEERROR << "Failed to connect to remote in " << connect_timeout_.count()
+            << " ms.";
+
+    statistics.deadline_timeouts++;
+    Finish(handler, ErrorCode::TimedOut);
+  });
+}
+
 void TcpConnector::DoConnect(EventHandler handler) {
   connecting_ = true;
 
@@ -129,7 +190,7 @@ void TcpConnector::DoConnect(EventHandler handler) {
       (addresses_ && current_ind_ >= addresses_->size())) {
     NEERROR << "Fail to connect to all addresses, the last known error is "
             << last_error_ << ".";
-    handler(std::move(socket_), last_error_);
+    Finish(handler, last_error_);
     return;
   }
 
@@ -144,37 +205,158 @@ void TcpConnector::DoConnect(EventHandler handler) {
     address = &address_;
   }
 
+  boost::asio::ip::address source;
+  if (device_) {
+    source = device_->FindSourceIpToBind(*address);
+  }
+
+  if (tcp_options_ || !source.is_unspecified()) {
+    socket_.open(address->is_v4() ? boost::asio::ip::tcp::v4()
+                                  : boost::asio::ip::tcp::v6(),
+                 ec);
+    if (ec) {
+      NEERROR << "Failed to open socket due to " << ec << ".";
+      last_error_ = std::make_error_code(ec);
+      TryNext(handler);
+      return;
+    }
+  }
+
+  if (tcp_options_) {
+    auto error = tcp_options_->ApplyToConnectingSocket(socket_);
+    if (error) {
+      NEWARN << "Failed to apply TCP options due to " << error << ".";
+    }
+  }
+
+  if (!source.is_unspecified()) {
+#ifdef IP_BIND_ADDRESS_NO_PORT
+    // Defer picking the port to `connect` so the port only needs to be unique
+    // per destination instead of per source address.
+    int one = 1;
+    if (setsockopt(socket_.native_handle(), IPPROTO_IP,
+                   IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one))) {
+      NEDEBUG << "Failed to set IP_BIND_ADDRESS_NO_PORT due to "
+              << std::error_code(errno, std::generic_category()) << ".";
+    }
+#endif
+
+    socket_.bind(boost::asio::ip::tcp::endpoint(source, 0), ec);
+    if (ec) {
+      NEERROR << "Failed to bind socket to " << source << " due to " << ec
+              << ".";
+      last_error_ = std::make_error_code(ec);
+      TryNext(handler);
+      return;
+    }
+
+    NEDEBUG << "Bound socket to " << source << ".";
+  }
+
+  statistics.attempts++;
+
+  attempt_timed_out_ = false;
+  if (attempt_timeout_.count()) {
+    attempt_timer_.expires_after(attempt_timeout_);
+    attempt_timer_.async_wait(
+        [this, attempt{current_ind_}, cancelable{life_time_cancelable()}](
+            const boost::system::error_code& ec) {
+          if (cancelable.canceled() || finished_ || ec ||
+              attempt != current_ind_) {
+            return;
+          }
+
+          // Abort the pending connect, the connect handler will move on to
+          // the next address.
+          attempt_timed_out_ = true;
+          boost::system::error_code error;
+          socket_.cancel(error);
+        });
+  }
+
   socket_.async_connect(
       boost::asio::ip::tcp::endpoint(*address, port_),
       [this, handler, cancelable{life_time_cancelable()}](
           const boost::system::error_code& ec) mutable {
-        if (cancelable.canceled()) {
+        if (cancelable.canceled() || finished_) {
           return;
         }
 
-        if (ec) {
-          NEDEBUG << "Connect failed due to " << ec << ", trying next address.";
+        attempt_timer_.cancel();
 
+        if (ec) {
           if (ec.value() == boost::asio::error::operation_aborted) {
-            return;
+            if (!attempt_timed_out_) {
+              return;
+            }
+
+            NEDEBUG << "Connect timed out, trying next address.";
+            statistics.attempt_timeouts++;
+            last_error_ = ErrorCode::TimedOut;
+          } else {
+            NEDEBUG << "Connect failed due to " << ec
+                    << ", trying next address.";
+            if (ec.value() == boost::asio::error::connection_refused) {
+              statistics.refused++;
+            } else {
+              statistics.other_failures++;
+            }
+            last_error_ = std::make_error_code(ec);
           }
 
-          last_error_ = std::make_error_code(ec);
           current_ind_++;
           DoConnect(handler);
           return;
         }
 
         NEINFO << "Successfully connected to remote.";
-        connecting_ = false;
-        handler(std::move(socket_), utils::NEKitErrorCode::NoError);
+        statistics.connected++;
+        Finish(handler, utils::NEKitErrorCode::NoError);
         return;
       });
 }
 
+void TcpConnector::TryNext(EventHandler handler) {
+  current_ind_++;
+
+  // This may be called from `Connect`, the handler must not be called before
+  // `Connect` returns.
+  boost::asio::post(socket_.get_executor(),
+                    [this, handler, cancelable{life_time_cancelable()}]() {
+                      if (cancelable.canceled() || finished_) {
+                        return;
+                      }
+
+                      DoConnect(handler);
+                    });
+}
+
+void TcpConnector::Finish(EventHandler handler, std::error_code ec) {
+  finished_ = true;
+  connecting_ = false;
+
+  resolve_cancelable_.Cancel();
+  attempt_timer_.cancel();
+  deadline_timer_.cancel();
+
+  if (ec) {
+    // Abort any pending connect operation.
+    boost::system::error_code error;
+    socket_.close(error);
+  }
+
+  handler(std::move(socket_), ec);
+}
+
 boost::asio::io_context* TcpConnector::io() {
   return &socket_.get_io_context();
 }
 
+TcpConnector::Statistics TcpConnector::GetStatistics() {
+  return {statistics.attempts,         statistics.connected,
+          statistics.attempt_timeouts, statistics.deadline_timeouts,
+          statistics.refused,          statistics.other_failures};
+}
+
 }  // namespace transport
 }  // namespace nekit
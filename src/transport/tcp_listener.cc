@@ -22,6 +22,9 @@
 
 #include "nekit/transport/tcp_listener.h"
 
+#include <algorithm>
+
+#include "nekit/config.h"
 #include "nekit/transport/tcp_socket.h"
 #include "nekit/utils/boost_error.h"
 #include "nekit/utils/log.h"
@@ -32,7 +35,7 @@
 namespace nekit {
 namespace transport {
 TcpListener::TcpListener(boost::asio::io_context *io, DataFlowHandler handler)
-    : acceptor_(*io), socket_(*io), handler_{handler} {}
+    : acceptor_(*io), handler_{handler} {}
 
 std::error_code TcpListener::Bind(std::string ip, uint16_t port) {
   return Bind(boost::asio::ip::address::from_string(ip), port);
@@ -57,6 +60,15 @@ std::error_code TcpListener::Bind(boost::asio::ip::address ip, uint16_t port) {
     return sec;
   }
 
+  if (tcp_options_) {
+    sec = tcp_options_->ApplyToAcceptor(acceptor_);
+    if (sec) {
+      NEERROR << "Failed to apply TCP options to listener due to " << sec
+              << ".";
+      return sec;
+    }
+  }
+
   acceptor_.bind(endpoint, ec);
   if (ec) {
     sec = std::make_error_code(ec);
@@ -65,7 +77,7 @@ std::error_code TcpListener::Bind(boost::asio::ip::address ip, uint16_t port) {
     return sec;
   }
 
-  acceptor_.listen(8, ec);
+  acceptor_.listen(backlog_, ec);
   if (ec) {
     sec = std::make_error_code(ec);
     NEERROR << "Failed to set listener to listen state due to " << sec << ".";
@@ -80,32 +92,86 @@ std::error_code TcpListener::Bind(boost::asio::ip::address ip, uint16_t port) {
 void TcpListener::Accept(EventHandler handler) {
   NEDEBUG << "Start accepting new socket.";
 
-  acceptor_.async_accept(
-      socket_, [this, handler](const boost::system::error_code &ec) {
-        if (ec) {
-          if (ec.value() == boost::asio::error::operation_aborted) {
-            return;
-          }
+  // Only affects the synchronous accepts in `Drain`.
+  boost::system::error_code ec;
+  acceptor_.non_blocking(true, ec);
+  if (ec) {
+    NEWARN << "Failed to set listener to non-blocking mode due to " << ec
+           << ", will not drain pending connections.";
+  }
+
+  for (size_t i = 0; i < std::max<size_t>(concurrent_accepts_, 1); i++) {
+    DoAccept(handler);
+  }
+}
+
+void TcpListener::DoAccept(EventHandler handler) {
+  acceptor_.async_accept([this, handler](const boost::system::error_code &ec,
+                                         boost::asio::ip::tcp::socket socket) {
+    if (ec) {
+      if (ec.value() == boost::asio::error::operation_aborted) {
+        return;
+      }
+
+      std::error_code error = std::make_error_code(ec);
+      NEERROR << "Failed to accept new socket due to " << error << ".";
+
+      handler(nullptr, error);
+      return;
+    }
+
+    HandleAccepted(std::move(socket), handler);
 
-          std::error_code error = std::make_error_code(ec);
-          NEERROR << "Failed to accept new socket due to " << error << ".";
+    Drain(handler);
 
-          handler(nullptr, error);
-          return;
-        }
+    if (acceptor_.is_open()) {
+      DoAccept(handler);
+    }
+  });
+}
 
-        NEINFO << "Accepted new TCP socket.";
+void TcpListener::Drain(EventHandler handler) {
+  if (!acceptor_.non_blocking()) {
+    return;
+  }
+
+  // Take the connections that are already queued without a trip through the
+  // event loop for each of them. This stops on `EAGAIN`.
+  for (size_t i = 0; i < NEKIT_TCP_LISTENER_MAX_DRAIN && acceptor_.is_open();
+       i++) {
+    boost::asio::ip::tcp::socket socket{*io()};
+    boost::system::error_code ec;
+    acceptor_.accept(socket, ec);
+    if (ec) {
+      if (ec != boost::asio::error::would_block &&
+          ec != boost::asio::error::try_again) {
+        NEWARN << "Failed to drain pending connection due to " << ec << ".";
+      }
+      return;
+    }
 
-        // Can't use `make_unique` since the constructor is a private friend.
-        TcpSocket *socket = new TcpSocket(
-            std::move(socket_),
-            std::make_shared<utils::Session>(&socket_.get_io_context()));
+    HandleAccepted(std::move(socket), handler);
+  }
+}
+
+void TcpListener::HandleAccepted(boost::asio::ip::tcp::socket &&socket,
+                                 EventHandler handler) {
+  NEINFO << "Accepted new TCP socket.";
+
+  if (tcp_options_) {
+    auto error = tcp_options_->ApplyToAcceptedSocket(socket);
+    if (error) {
+      NEWARN << "Failed to apply TCP options to accepted socket due to "
+             << error << ".";
+    }
+  }
 
-        handler(handler_(std::unique_ptr<TcpSocket>(socket)),
-                TcpListener::ErrorCode::NoError);
+  // Can't use `make_unique` since the constructor is a private friend.
+  TcpSocket *tcp_socket =
+      new TcpSocket(std::move(socket), std::make_shared<utils::Session>(io()));
 
-        Accept(handler);
-      });
+  handler(handler_(std::unique_ptr<TcpSocket>(tcp_socket)),
+          TcpListener::ErrorCode::NoError);
 }
 
 void TcpListener::Close() { acceptor_.close(); }
@@ -0,0 +1,196 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/transport/tcp_options.h"
+
+#include "nekit/utils/boost_error.h"
+#include "nekit/utils/error.h"
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "TCP Options"
+
+#if defined(__APPLE__) && !defined(TCP_KEEPIDLE)
+#define TCP_KEEPIDLE TCP_KEEPALIVE
+#endif
+
+namespace nekit {
+namespace transport {
+
+namespace {
+template <typename Socket>
+std::error_code SetIntOption(Socket& socket, int level, int name, int value) {
+  if (setsockopt(socket.native_handle(), level, name,
+                 reinterpret_cast<const char*>(&value), sizeof(value))) {
+    return std::error_code(errno, std::generic_category());
+  }
+  return utils::NEKitErrorCode::NoError;
+}
+
+// Options are applied independently so one rejected option does not skip the
+// others, only the first error is reported.
+void KeepFirstError(std::error_code* first_error, std::error_code error) {
+  if (error && !*first_error) {
+    *first_error = error;
+  }
+}
+
+std::error_code Result(std::error_code first_error) {
+  if (first_error) {
+    return first_error;
+  }
+  return utils::NEKitErrorCode::NoError;
+}
+
+template <typename Socket>
+void ApplyBufferSize(const TcpOptions& options, Socket& socket,
+                     std::error_code* first_error) {
+  boost::system::error_code ec;
+
+  if (options.receive_buffer_size) {
+    socket.set_option(boost::asio::socket_base::receive_buffer_size(
+                          options.receive_buffer_size),
+                      ec);
+    KeepFirstError(first_error, std::make_error_code(ec));
+  }
+
+  if (options.send_buffer_size) {
+    socket.set_option(
+        boost::asio::socket_base::send_buffer_size(options.send_buffer_size),
+        ec);
+    KeepFirstError(first_error, std::make_error_code(ec));
+  }
+}
+
+void ApplyCommon(const TcpOptions& options,
+                 boost::asio::ip::tcp::socket& socket,
+                 std::error_code* first_error) {
+  boost::system::error_code ec;
+
+  if (options.no_delay) {
+    socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+    KeepFirstError(first_error, std::make_error_code(ec));
+  }
+
+  if (options.not_sent_low_water_mark) {
+#ifdef TCP_NOTSENT_LOWAT
+    KeepFirstError(first_error,
+                   SetIntOption(socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                                options.not_sent_low_water_mark));
+#else
+    NEDEBUG << "TCP_NOTSENT_LOWAT is not supported, ignored.";
+#endif
+  }
+
+  if (options.keep_alive) {
+    socket.set_option(boost::asio::socket_base::keep_alive(true), ec);
+    KeepFirstError(first_error, std::make_error_code(ec));
+
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+    if (options.keep_alive_idle) {
+      KeepFirstError(first_error,
+                     SetIntOption(socket, IPPROTO_TCP, TCP_KEEPIDLE,
+                                  options.keep_alive_idle));
+    }
+
+    if (options.keep_alive_interval) {
+      KeepFirstError(first_error,
+                     SetIntOption(socket, IPPROTO_TCP, TCP_KEEPINTVL,
+                                  options.keep_alive_interval));
+    }
+
+    if (options.keep_alive_count) {
+      KeepFirstError(first_error,
+                     SetIntOption(socket, IPPROTO_TCP, TCP_KEEPCNT,
+                                  options.keep_alive_count));
+    }
+#else
+    NEDEBUG << "Keepalive timings are not supported, ignored.";
+#endif
+  }
+
+  if (options.user_timeout) {
+#ifdef TCP_USER_TIMEOUT
+    KeepFirstError(first_error,
+                   SetIntOption(socket, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                                static_cast<int>(options.user_timeout)));
+#else
+    NEDEBUG << "TCP_USER_TIMEOUT is not supported, ignored.";
+#endif
+  }
+}
+}  // namespace
+
+std::error_code TcpOptions::ApplyToAcceptor(
+    boost::asio::ip::tcp::acceptor& acceptor) const {
+  std::error_code first_error;
+  ApplyBufferSize(*this, acceptor, &first_error);
+
+  if (fast_open) {
+#ifdef TCP_FASTOPEN
+#ifdef __APPLE__
+    // Darwin only accepts a boolean flag here.
+    KeepFirstError(&first_error,
+                   SetIntOption(acceptor, IPPROTO_TCP, TCP_FASTOPEN, 1));
+#else
+    KeepFirstError(&first_error,
+                   SetIntOption(acceptor, IPPROTO_TCP, TCP_FASTOPEN,
+                                fast_open_queue_length));
+#endif
+#else
+    NEDEBUG << "TCP Fast Open is not supported on listener, ignored.";
+#endif
+  }
+
+  return Result(first_error);
+}
+
+std::error_code TcpOptions::ApplyToAcceptedSocket(
+    boost::asio::ip::tcp::socket& socket) const {
+  std::error_code first_error;
+  // Buffer sizes are inherited from the acceptor.
+  ApplyCommon(*this, socket, &first_error);
+  return Result(first_error);
+}
+
+std::error_code TcpOptions::ApplyToConnectingSocket(
+    boost::asio::ip::tcp::socket& socket) const {
+  std::error_code first_error;
+  ApplyBufferSize(*this, socket, &first_error);
+  ApplyCommon(*this, socket, &first_error);
+
+  if (fast_open) {
+#ifdef TCP_FASTOPEN_CONNECT
+    // With this option `connect` returns immediately without sending the SYN
+    // if a cookie is cached, the data of the first write is carried in it.
+    KeepFirstError(&first_error, SetIntOption(socket, IPPROTO_TCP,
+                                              TCP_FASTOPEN_CONNECT, 1));
+#else
+    NEDEBUG << "TCP Fast Open is not supported on connecting socket, ignored.";
+#endif
+  }
+
+  return Result(first_error);
+}
+
+}  // namespace transport
+}  // namespace nekit
@@ -46,10 +46,12 @@ TcpSocket::TcpSocket(boost::asio::ip::tcp::socket &&socket,
   BOOST_ASSERT(&socket_.get_io_context() == session->io());
 }
 
-TcpSocket::TcpSocket(std::shared_ptr<utils::Session> session)
+TcpSocket::TcpSocket(std::shared_ptr<utils::Session> session,
+                     std::shared_ptr<const TcpOptions> options)
     : socket_{*session->io()},
       session_{session},
       connect_to_{session->current_endpoint()},
+      tcp_options_{options},
       write_buffer_{
           std::make_unique<std::vector<boost::asio::const_buffer>>(0)},
       read_buffer_{
@@ -84,8 +86,11 @@ utils::Cancelable TcpSocket::Read(std::unique_ptr<utils::Buffer> &&buffer,
 
   reading_ = true;
 
+  // The wrapper is moved into the handler below, take the reference first
+  // since the evaluation order of the arguments is unspecified.
+  auto &read_buffer = *read_buffer_;
   socket_.async_read_some(
-      *read_buffer_,
+      read_buffer,
       [this, buffer{std::move(buffer)}, buffer_wrapper{std::move(read_buffer_)},
        handler,
        cancelable{read_cancelable_}](const boost::system::error_code &ec,
@@ -372,7 +377,30 @@ utils::Cancelable TcpSocket::Connect(EventHandler handler) {
 
   BOOST_ASSERT(connect_to_);
 
+  if (connection_pool_ && connection_pool_->Take(*connect_to_, &socket_)) {
+    state_ = data_flow::State::Establishing;
+
+    connect_cancelable_ = utils::Cancelable();
+    boost::asio::post(*io(), [this, handler,
+                              cancelable{connect_cancelable_}]() {
+      if (cancelable.canceled()) {
+        return;
+      }
+
+      state_ = data_flow::State::Established;
+      handler(ErrorCode::NoError);
+    });
+
+    return connect_cancelable_;
+  }
+
   connector_ = std::make_unique<TcpConnector>(connect_to_, io());
+  connector_->set_tcp_options(tcp_options_);
+  connector_->set_attempt_timeout(attempt_timeout_);
+  connector_->set_connect_timeout(connect_timeout_);
+  if (device_) {
+    connector_->Bind(device_);
+  }
 
   state_ = data_flow::State::Establishing;
 
@@ -0,0 +1,104 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/bloom_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nekit {
+namespace utils {
+
+const size_t BloomFilter::kBlockWords;
+
+namespace {
+// The finalizer of MurmurHash3, spreads the bits of weak hashes.
+uint64_t Mix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+}  // namespace
+
+BloomFilter::BloomFilter(size_t keys, double bits_per_key) {
+  bits_per_key = std::max(bits_per_key, 1.0);
+  size_t bits = static_cast<size_t>(std::max<double>(keys, 1) * bits_per_key);
+  blocks_ = (bits + kBlockWords * 64 - 1) / (kBlockWords * 64);
+  words_.assign(blocks_ * kBlockWords, 0);
+  // ln 2 hashes per bit per key is optimal.
+  hashes_ = static_cast<unsigned>(
+      std::min(std::max(std::round(bits_per_key * 0.69), 1.0), 16.0));
+}
+
+double BloomFilter::BitsPerKey(double false_positive_rate) {
+  false_positive_rate = std::min(std::max(false_positive_rate, 1e-6), 0.5);
+  // Blocking costs a few more bits than -log2(p) / ln 2.
+  return -std::log2(false_positive_rate) * 1.44 * 1.1;
+}
+
+void BloomFilter::Insert(uint64_t hash) {
+  if (empty()) {
+    return;
+  }
+
+  hash = Mix(hash);
+  uint64_t* block = &words_[Block(hash)];
+  for (unsigned i = 0; i < hashes_; i++) {
+    unsigned bit = NextBit(&hash);
+    block[bit / 64] |= uint64_t(1) << (bit % 64);
+  }
+}
+
+bool BloomFilter::MayContain(uint64_t hash) const {
+  if (empty()) {
+    return true;
+  }
+
+  hash = Mix(hash);
+  const uint64_t* block = &words_[Block(hash)];
+  for (unsigned i = 0; i < hashes_; i++) {
+    unsigned bit = NextBit(&hash);
+    if (!(block[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+unsigned BloomFilter::NextBit(uint64_t* state) {
+  // Each bit comes from the high bits of a step of a linear congruential
+  // generator, deriving them from two hashes leaves too few distinct
+  // patterns in a block.
+  *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return static_cast<unsigned>(*state >> 55);
+}
+
+size_t BloomFilter::Block(uint64_t hash) const {
+  // Maps the high bits to [0, blocks_) without a division.
+  uint64_t high = hash >> 32;
+  return static_cast<size_t>((high * blocks_) >> 32) * kBlockWords;
+}
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,233 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/caching_resolver.h"
+
+#include <algorithm>
+
+#include "nekit/utils/boost_error.h"
+#include "nekit/utils/error.h"
+#include "nekit/utils/log.h"
+#include "nekit/utils/stub_resolver.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Caching resolver"
+
+namespace nekit {
+namespace utils {
+
+CachingResolver::CachingResolver(std::unique_ptr<ResolverInterface>&& resolver,
+                                 std::shared_ptr<DnsCache> cache)
+    : resolver_{std::move(resolver)}, cache_{cache} {}
+
+Cancelable CachingResolver::Resolve(std::string domain,
+                                    AddressPreference preference,
+                                    EventHandler handler) {
+  return ResolveWithTtl(
+      domain, preference,
+      [handler](
+          std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+          std::chrono::seconds ttl, std::error_code ec) {
+        (void)ttl;
+        handler(addresses, ec);
+      });
+}
+
+Cancelable CachingResolver::ResolveWithTtl(std::string domain,
+                                           AddressPreference preference,
+                                           TtlEventHandler handler) {
+  auto key = QueryKey(domain, preference);
+  auto now = DnsCache::Clock::now();
+
+  auto entry = cache_->Lookup(key, now);
+  if (entry) {
+    NETRACE << "Found " << domain << " in cache.";
+
+    auto addresses = entry->addresses;
+    std::error_code error = entry->addresses ? NEKitErrorCode::NoError
+                                             : entry->error;
+    // Zero would tell the caller not to cache the answer.
+    auto ttl = std::max(std::chrono::duration_cast<std::chrono::seconds>(
+                            entry->expire_at - now),
+                        std::chrono::seconds(1));
+
+    MaybePrefetch(domain, preference, key, *entry, now);
+
+    Cancelable cancelable{};
+    boost::asio::post(*io(), [handler, addresses, ttl, error, cancelable,
+                              life_time{life_time_cancelable()}]() {
+      if (cancelable.canceled() || life_time.canceled()) {
+        return;
+      }
+
+      handler(addresses, ttl, error);
+    });
+    return cancelable;
+  }
+
+  return resolver_->ResolveWithTtl(
+      domain, preference,
+      [this, key, handler, life_time{life_time_cancelable()}](
+          std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+          std::chrono::seconds ttl, std::error_code ec) {
+        if (life_time.canceled()) {
+          return;
+        }
+
+        if (ec) {
+          ttl = NegativeTtl(ec);
+          if (ttl.count()) {
+            cache_->InsertNegative(key, ec, ttl);
+          }
+          handler(nullptr, ttl, ec);
+          return;
+        }
+
+        ttl = ClampTtl(ttl);
+        cache_->Insert(key, addresses, ttl);
+        handler(addresses, ttl, ec);
+      });
+}
+
+void CachingResolver::MaybePrefetch(const std::string& domain,
+                                    AddressPreference preference,
+                                    const std::string& key,
+                                    const DnsCache::Entry& entry,
+                                    DnsCache::Clock::time_point now) {
+  if (!entry.addresses || entry.hits < NEKIT_DNS_PREFETCH_MIN_HITS ||
+      entry.expire_at - now >
+          std::max<DnsCache::Clock::duration>(entry.ttl / 10,
+                                              std::chrono::seconds(1)) ||
+      prefetching_.count(key)) {
+    return;
+  }
+
+  if (!AcquirePrefetchToken(now)) {
+    prefetches_throttled_++;
+    return;
+  }
+
+  NEDEBUG << "Prefetching " << domain << " before it expires.";
+
+  prefetches_++;
+  prefetching_.emplace(key, Cancelable());
+
+  auto cancelable = resolver_->ResolveWithTtl(
+      domain, preference,
+      [this, key, life_time{life_time_cancelable()}](
+          std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+          std::chrono::seconds ttl, std::error_code ec) {
+        if (life_time.canceled()) {
+          return;
+        }
+
+        // Dropped by `Stop`.
+        if (!prefetching_.erase(key)) {
+          return;
+        }
+
+        // Keep the current entry until it expires.
+        if (ec) {
+          NEDEBUG << "Prefetch failed due to " << ec << ".";
+          return;
+        }
+
+        cache_->Insert(key, addresses, ClampTtl(ttl));
+      });
+
+  // The prefetch may have finished already.
+  auto iter = prefetching_.find(key);
+  if (iter != prefetching_.end()) {
+    iter->second = cancelable;
+  }
+}
+
+bool CachingResolver::AcquirePrefetchToken(DnsCache::Clock::time_point now) {
+  if (prefetch_rate_ <= 0) {
+    return false;
+  }
+
+  // A token bucket holding one second of budget, but at least one token so
+  // rates below one per second can still prefetch.
+  std::chrono::duration<double> elapsed = now - prefetch_refilled_at_;
+  prefetch_refilled_at_ = now;
+  prefetch_tokens_ =
+      std::min(std::max(prefetch_rate_, 1.0),
+               prefetch_tokens_ + elapsed.count() * prefetch_rate_);
+
+  if (prefetch_tokens_ < 1) {
+    return false;
+  }
+
+  prefetch_tokens_--;
+  return true;
+}
+
+void CachingResolver::Stop() {
+  for (auto& pair : prefetching_) {
+    pair.second.Cancel();
+  }
+  prefetching_.clear();
+
+  resolver_->Stop();
+}
+
+void CachingResolver::Reset() { resolver_->Reset(); }
+
+boost::asio::io_context* CachingResolver::io() { return resolver_->io(); }
+
+std::chrono::seconds CachingResolver::ClampTtl(std::chrono::seconds ttl) {
+  if (ttl == kUnknownTtl) {
+    return std::chrono::seconds(NEKIT_DNS_CACHE_DEFAULT_TTL);
+  }
+
+  return std::min(std::max(ttl, std::chrono::seconds(NEKIT_DNS_CACHE_MIN_TTL)),
+                  std::chrono::seconds(NEKIT_DNS_CACHE_MAX_TTL));
+}
+
+std::chrono::seconds CachingResolver::NegativeTtl(std::error_code ec) {
+  // The name does not exist or has no address of the queried family.
+  if (ec == StubResolver::ErrorCode::NameError ||
+      ec == StubResolver::ErrorCode::NoData ||
+      ec == std::make_error_code(boost::system::error_code(
+                boost::asio::error::host_not_found)) ||
+      ec == std::make_error_code(
+                boost::system::error_code(boost::asio::error::no_data))) {
+    return std::chrono::seconds(NEKIT_DNS_CACHE_NEGATIVE_TTL);
+  }
+
+  // The server failed to answer, which is usually temporary.
+  if (ec == StubResolver::ErrorCode::ServerFailure ||
+      ec == StubResolver::ErrorCode::Refused ||
+      ec == std::make_error_code(boost::system::error_code(
+                boost::asio::error::host_not_found_try_again)) ||
+      ec == std::make_error_code(
+                boost::system::error_code(boost::asio::error::no_recovery))) {
+    return std::chrono::seconds(NEKIT_DNS_CACHE_FAILURE_TTL);
+  }
+
+  // Timeouts, cancellation and resolver-local errors such as a full queue say
+  // nothing about the name.
+  return std::chrono::seconds(0);
+}
+}  // namespace utils
+}  // namespace nekit
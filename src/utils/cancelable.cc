@@ -26,19 +26,24 @@
 
 namespace nekit {
 namespace utils {
-Cancelable::Cancelable() : canceled_{std::make_shared<bool>(false)} {}
+Cancelable::Cancelable() : state_{std::make_shared<State>()} {}
+
+Cancelable::Cancelable(std::function<void()> action)
+    : state_{std::make_shared<State>()} {
+  state_->action = std::move(action);
+}
 
 Cancelable::Cancelable(const Cancelable& cancelable) {
-  canceled_ = cancelable.canceled_;
+  state_ = cancelable.state_;
 }
 
 Cancelable& Cancelable::operator=(const nekit::utils::Cancelable& cancelable) {
-  canceled_ = cancelable.canceled_;
+  state_ = cancelable.state_;
   return *this;
 }
 
 Cancelable::Cancelable(Cancelable&& cancelable) {
-  cancelable.canceled_.swap(canceled_);
+  cancelable.state_.swap(state_);
 }
 
 Cancelable& Cancelable::operator=(Cancelable&& cancelable) {
@@ -46,15 +51,27 @@ Cancelable& Cancelable::operator=(Cancelable&& cancelable) {
     return *this;
   }
 
-  cancelable.canceled_.swap(canceled_);
+  cancelable.state_.swap(state_);
   return *this;
 }
 
-void Cancelable::Cancel() { *canceled_ = true; }
+void Cancelable::Cancel() {
+  if (state_->canceled) {
+    return;
+  }
+
+  state_->canceled = true;
+  // The action may drop the last reference to this instance.
+  auto action = std::move(state_->action);
+  state_->action = nullptr;
+  if (action) {
+    action();
+  }
+}
 
-void Cancelable::Reset() { *canceled_ = false; }
+void Cancelable::Reset() { state_->canceled = false; }
 
-bool Cancelable::canceled() const { return *canceled_; }
+bool Cancelable::canceled() const { return state_->canceled; }
 
 }  // namespace utils
 }  // namespace nekit
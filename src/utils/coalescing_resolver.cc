@@ -0,0 +1,115 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/coalescing_resolver.h"
+
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Coalescing resolver"
+
+namespace nekit {
+namespace utils {
+
+CoalescingResolver::CoalescingResolver(
+    std::unique_ptr<ResolverInterface>&& resolver)
+    : resolver_{std::move(resolver)} {}
+
+Cancelable CoalescingResolver::Resolve(std::string domain,
+                                       AddressPreference preference,
+                                       EventHandler handler) {
+  return ResolveWithTtl(
+      domain, preference,
+      [handler](
+          std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+          std::chrono::seconds ttl, std::error_code ec) {
+        (void)ttl;
+        handler(addresses, ec);
+      });
+}
+
+Cancelable CoalescingResolver::ResolveWithTtl(std::string domain,
+                                              AddressPreference preference,
+                                              TtlEventHandler handler) {
+  auto key = QueryKey(domain, preference);
+  Cancelable cancelable{};
+
+  auto& query = queries_[key];
+  if (query) {
+    NETRACE << "Joined pending query of " << domain << ".";
+    coalesced_++;
+    query->waiters.push_back({handler, cancelable});
+    return cancelable;
+  }
+
+  query = std::make_unique<Query>();
+  query->waiters.push_back({handler, cancelable});
+  auto raw_query = query.get();
+
+  auto query_cancelable = resolver_->ResolveWithTtl(
+      domain, preference,
+      [this, key, life_time{life_time_cancelable()}](
+          std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+          std::chrono::seconds ttl, std::error_code ec) {
+        if (life_time.canceled()) {
+          return;
+        }
+
+        auto iter = queries_.find(key);
+        if (iter == queries_.end()) {
+          return;
+        }
+
+        // Waiters may start new resolves of the same domain.
+        auto query = std::move(iter->second);
+        queries_.erase(iter);
+
+        for (auto& waiter : query->waiters) {
+          if (!waiter.cancelable.canceled()) {
+            waiter.handler(addresses, ttl, ec);
+          }
+        }
+      });
+
+  // `resolver_` may have finished the query already.
+  auto iter = queries_.find(key);
+  if (iter != queries_.end() && iter->second.get() == raw_query) {
+    iter->second->cancelable = query_cancelable;
+  }
+
+  return cancelable;
+}
+
+void CoalescingResolver::Stop() {
+  for (auto& pair : queries_) {
+    pair.second->cancelable.Cancel();
+  }
+  queries_.clear();
+
+  resolver_->Stop();
+}
+
+void CoalescingResolver::Reset() { resolver_->Reset(); }
+
+boost::asio::io_context* CoalescingResolver::io() { return resolver_->io(); }
+}  // namespace utils
+}  // namespace nekit
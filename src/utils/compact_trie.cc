@@ -0,0 +1,301 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/compact_trie.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <utility>
+
+#include <boost/assert.hpp>
+
+namespace nekit {
+namespace utils {
+
+namespace {
+// Precedes the nodes and the labels in a saved trie.
+struct SavedHeader {
+  uint32_t reverse;
+  uint32_t node_count;
+};
+}  // namespace
+
+constexpr uint32_t CompactTrie::kNoValue;
+
+bool CompactTrie::AddPrefix(const std::string& prefix, uint32_t value) {
+  if (prefix.empty() || !std::all_of(prefix.begin(), prefix.end(), IsValid)) {
+    return false;
+  }
+
+  if (mapped() && entries_.empty()) {
+    RecoverEntries();
+  }
+
+  entries_.push_back(prefix);
+  if (value || !entry_values_.empty()) {
+    entry_values_.resize(entries_.size(), 0);
+    entry_values_.back() = value;
+  }
+  built_ = false;
+  return true;
+}
+
+bool CompactTrie::MatchPrefixWith(const std::string& literal) {
+  if (!built_) {
+    Build();
+  }
+
+  const size_t size = literal.size();
+  uint32_t node = 0;
+  for (size_t i = 0; i < size; i++) {
+    char ch = literal[reverse_ ? size - 1 - i : i];
+    const Node& current = nodes_[node];
+    // The labels of the children are contiguous bytes.
+    const void* child = std::memchr(labels_.data() + current.first_child, ch,
+                                    current.child_count);
+    if (!child) {
+      return false;
+    }
+
+    node = static_cast<uint32_t>(static_cast<const char*>(child) -
+                                 labels_.data());
+    if (nodes_[node].end) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t CompactTrie::MatchLowest(const std::string& literal) const {
+  BOOST_ASSERT(built_);
+
+  const size_t size = literal.size();
+  uint32_t node = 0, result = kNoValue;
+  for (size_t i = 0; i < size; i++) {
+    char ch = literal[reverse_ ? size - 1 - i : i];
+    const Node& current = nodes_[node];
+    const void* child = std::memchr(labels_.data() + current.first_child, ch,
+                                    current.child_count);
+    if (!child) {
+      break;
+    }
+
+    node = static_cast<uint32_t>(static_cast<const char*>(child) -
+                                 labels_.data());
+    if (nodes_[node].end) {
+      // Values only get lower along a path.
+      result = values_.empty() ? 0 : values_[node];
+    }
+  }
+  return result;
+}
+
+void CompactTrie::Build() {
+  if (built_) {
+    return;
+  }
+
+  // Each key with its value.
+  std::vector<std::pair<std::string, uint32_t>> keys;
+  keys.reserve(entries_.size());
+  for (size_t i = 0; i < entries_.size(); i++) {
+    const auto& entry = entries_[i];
+    keys.emplace_back(
+        reverse_ ? std::string(entry.rbegin(), entry.rend()) : entry,
+        entry_values_.empty() ? 0 : entry_values_[i]);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // A key sorts right before those it is a prefix of. `prefixes` are the
+  // positions of the kept keys that are prefixes of the current one, each
+  // with a lower value than the one before.
+  std::vector<std::pair<std::string, uint32_t>> kept;
+  std::vector<size_t> prefixes;
+  for (auto& key : keys) {
+    while (!prefixes.empty() &&
+           key.first.compare(0, kept[prefixes.back()].first.size(),
+                             kept[prefixes.back()].first)) {
+      prefixes.pop_back();
+    }
+    if (prefixes.empty() || key.second < kept[prefixes.back()].second) {
+      prefixes.push_back(kept.size());
+      kept.push_back(std::move(key));
+    }
+  }
+
+  std::vector<Node> nodes(1, Node{0, 0, false});
+  std::vector<char> labels(1, '\0');
+  std::vector<uint32_t> values;
+  if (!entry_values_.empty()) {
+    values.push_back(kNoValue);
+  }
+
+  // Each node covers the keys in [begin, end) sharing its first `depth`
+  // characters.
+  struct Range {
+    uint32_t node;
+    size_t begin, end, depth;
+  };
+  std::deque<Range> queue;
+  if (!kept.empty()) {
+    queue.push_back(Range{0, 0, kept.size(), 0});
+  }
+  while (!queue.empty()) {
+    Range range = queue.front();
+    queue.pop_front();
+
+    nodes[range.node].first_child = static_cast<uint32_t>(nodes.size());
+    size_t begin = range.begin;
+    while (begin < range.end) {
+      char label = kept[begin].first[range.depth];
+      size_t end = begin + 1;
+      while (end < range.end && kept[end].first[range.depth] == label) {
+        end++;
+      }
+
+      // A key ending here sorts first in its range, the others extend it
+      // with a lower value.
+      bool end_here = kept[begin].first.size() == range.depth + 1;
+      nodes.push_back(Node{0, 0, end_here});
+      labels.push_back(label);
+      if (!values.empty()) {
+        values.push_back(end_here ? kept[begin].second : kNoValue);
+      }
+      if (begin + end_here < end) {
+        queue.push_back(Range{static_cast<uint32_t>(nodes.size() - 1),
+                              begin + end_here, end, range.depth + 1});
+      }
+      nodes[range.node].child_count++;
+      begin = end;
+    }
+  }
+
+  nodes.shrink_to_fit();
+  labels.shrink_to_fit();
+  values.shrink_to_fit();
+  nodes_.Assign(std::move(nodes));
+  labels_.Assign(std::move(labels));
+  values_ = std::move(values);
+  built_ = true;
+}
+
+void CompactTrie::Save(std::string* out) {
+  if (!built_) {
+    Build();
+  }
+
+  SavedHeader header{reverse_, static_cast<uint32_t>(nodes_.size())};
+  out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const auto& node : nodes_) {
+    // Written field by field so the padding is zero.
+    Node saved;
+    std::memset(&saved, 0, sizeof(saved));
+    saved.first_child = node.first_child;
+    saved.child_count = node.child_count;
+    saved.end = node.end;
+    out->append(reinterpret_cast<const char*>(&saved), sizeof(saved));
+  }
+  out->append(labels_.data(), labels_.size());
+}
+
+bool CompactTrie::Map(const void* data, size_t size,
+                      std::shared_ptr<const void> owner) {
+  if (size < sizeof(SavedHeader) ||
+      reinterpret_cast<uintptr_t>(data) % alignof(Node)) {
+    return false;
+  }
+
+  SavedHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  size_t count = header.node_count;
+  if (header.reverse != reverse_ || !count ||
+      count > (size - sizeof(SavedHeader)) / (sizeof(Node) + 1) ||
+      size != sizeof(SavedHeader) + count * (sizeof(Node) + 1)) {
+    return false;
+  }
+
+  const Node* nodes = reinterpret_cast<const Node*>(
+      static_cast<const char*>(data) + sizeof(SavedHeader));
+  for (size_t i = 0; i < count; i++) {
+    if (nodes[i].end > 1) {
+      return false;
+    }
+    // Children come after their parent, so the nodes form a tree.
+    if (nodes[i].child_count &&
+        (nodes[i].first_child <= i ||
+         nodes[i].first_child + size_t(nodes[i].child_count) > count)) {
+      return false;
+    }
+  }
+
+  nodes_.Map(nodes, count, owner);
+  labels_.Map(reinterpret_cast<const char*>(nodes + count), count,
+              std::move(owner));
+  entries_.clear();
+  entry_values_.clear();
+  values_.clear();
+  built_ = true;
+  return true;
+}
+
+void CompactTrie::RecoverEntries() {
+  // Depth first with the path to the current node.
+  std::string key;
+  std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    const Node& node = nodes_[top.first];
+    if (top.second == node.child_count) {
+      stack.pop_back();
+      if (!key.empty()) {
+        key.pop_back();
+      }
+      continue;
+    }
+
+    uint32_t child = node.first_child + top.second++;
+    key.push_back(labels_[child]);
+    if (nodes_[child].end) {
+      entries_.push_back(reverse_ ? std::string(key.rbegin(), key.rend())
+                                  : key);
+    }
+    if (nodes_[child].child_count) {
+      stack.emplace_back(child, 0);
+    } else {
+      key.pop_back();
+    }
+  }
+}
+
+size_t CompactTrie::memory_usage() const {
+  size_t usage = nodes_.memory_usage() + labels_.memory_usage() +
+                 values_.capacity() * sizeof(uint32_t) +
+                 entries_.capacity() * sizeof(std::string) +
+                 entry_values_.capacity() * sizeof(uint32_t);
+  for (const auto& entry : entries_) {
+    usage += entry.capacity();
+  }
+  return usage;
+}
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,125 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/dns_cache.h"
+
+#include <boost/assert.hpp>
+
+#include "nekit/utils/warm_snapshot.h"
+
+namespace nekit {
+namespace utils {
+
+DnsCache::DnsCache(size_t capacity) : capacity_{capacity} {
+  BOOST_ASSERT(capacity_);
+}
+
+const DnsCache::Entry* DnsCache::Lookup(const std::string& key,
+                                        Clock::time_point now) {
+  auto iter = entries_.find(key);
+  if (iter == entries_.end()) {
+    Addresses addresses;
+    std::chrono::seconds remaining, ttl;
+    if (snapshot_ &&
+        snapshot_->FindAddresses(key, &addresses, &remaining, &ttl)) {
+      statistics_.snapshot_hits++;
+      Put(key, Entry{addresses, std::error_code(), now + remaining, ttl, 0});
+      iter = entries_.find(key);
+    } else {
+      statistics_.misses++;
+      return nullptr;
+    }
+  }
+
+  if (iter->second->second.expire_at <= now) {
+    statistics_.expired++;
+    statistics_.misses++;
+    list_.erase(iter->second);
+    entries_.erase(iter);
+    return nullptr;
+  }
+
+  list_.splice(list_.begin(), list_, iter->second);
+
+  Entry& entry = list_.front().second;
+  entry.hits++;
+  if (entry.addresses) {
+    statistics_.hits++;
+  } else {
+    statistics_.negative_hits++;
+  }
+  return &entry;
+}
+
+void DnsCache::Insert(const std::string& key, Addresses addresses,
+                      std::chrono::seconds ttl, Clock::time_point now) {
+  BOOST_ASSERT(addresses);
+  Put(key, Entry{addresses, std::error_code(), now + ttl, ttl, 0});
+}
+
+void DnsCache::InsertNegative(const std::string& key, std::error_code error,
+                              std::chrono::seconds ttl,
+                              Clock::time_point now) {
+  Put(key, Entry{nullptr, error, now + ttl, ttl, 0});
+}
+
+void DnsCache::Erase(const std::string& key) {
+  auto iter = entries_.find(key);
+  if (iter == entries_.end()) {
+    return;
+  }
+
+  list_.erase(iter->second);
+  entries_.erase(iter);
+}
+
+void DnsCache::Clear() {
+  list_.clear();
+  entries_.clear();
+}
+
+void DnsCache::Walk(
+    std::function<void(const std::string&, const Entry&)> visitor) const {
+  for (const auto& pair : list_) {
+    visitor(pair.first, pair.second);
+  }
+}
+
+void DnsCache::Put(const std::string& key, Entry entry) {
+  auto iter = entries_.find(key);
+  if (iter != entries_.end()) {
+    iter->second->second = std::move(entry);
+    list_.splice(list_.begin(), list_, iter->second);
+    return;
+  }
+
+  if (entries_.size() >= capacity_) {
+    statistics_.evicted++;
+    entries_.erase(list_.back().first);
+    list_.pop_back();
+  }
+
+  list_.emplace_front(key, std::move(entry));
+  entries_.emplace(key, list_.begin());
+}
+}  // namespace utils
+}  // namespace nekit
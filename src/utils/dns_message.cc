@@ -0,0 +1,338 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/dns_message.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+namespace nekit {
+namespace utils {
+
+namespace {
+const size_t kHeaderSize = 12;
+const size_t kMaxNameLength = 255;
+const size_t kMaxLabelLength = 63;
+// Bounds the number of compression pointers followed in one name.
+const int kMaxPointers = 16;
+
+const uint16_t kClassIn = 1;
+const uint16_t kFlagResponse = 0x8000;
+const uint16_t kFlagTruncated = 0x0200;
+const uint16_t kFlagRecursionDesired = 0x0100;
+
+uint16_t ReadUint16(const uint8_t* data) {
+  return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+uint32_t ReadUint32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) << 24 |
+         static_cast<uint32_t>(data[1]) << 16 |
+         static_cast<uint32_t>(data[2]) << 8 | data[3];
+}
+
+void WriteUint16(uint16_t value, std::vector<uint8_t>* buffer) {
+  buffer->push_back(static_cast<uint8_t>(value >> 8));
+  buffer->push_back(static_cast<uint8_t>(value));
+}
+
+// Moves `offset` past the name starting there.
+bool SkipName(const uint8_t* data, size_t size, size_t* offset) {
+  while (*offset < size) {
+    uint8_t length = data[*offset];
+    if ((length & 0xC0) == 0xC0) {
+      if (*offset + 2 > size) {
+        return false;
+      }
+      *offset += 2;
+      return true;
+    }
+    if (length & 0xC0) {
+      return false;
+    }
+
+    *offset += 1 + length;
+    if (!length) {
+      return *offset <= size;
+    }
+  }
+  return false;
+}
+
+// Compares the name at `offset` with `domain` case insensitively, following
+// compression pointers.
+bool MatchName(const uint8_t* data, size_t size, size_t offset,
+               const std::string& domain) {
+  size_t position = 0;
+  int pointers = 0;
+
+  while (offset < size) {
+    uint8_t length = data[offset];
+    if ((length & 0xC0) == 0xC0) {
+      if (offset + 2 > size || ++pointers > kMaxPointers) {
+        return false;
+      }
+      offset = ReadUint16(data + offset) & 0x3FFF;
+      continue;
+    }
+    if (length & 0xC0) {
+      return false;
+    }
+
+    if (!length) {
+      return position >= domain.size();
+    }
+
+    if (offset + 1 + length > size) {
+      return false;
+    }
+
+    if (position) {
+      if (position >= domain.size() || domain[position] != '.') {
+        return false;
+      }
+      position++;
+    }
+
+    if (position + length > domain.size()) {
+      return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+      if (std::tolower(data[offset + 1 + i]) !=
+          std::tolower(static_cast<unsigned char>(domain[position + i]))) {
+        return false;
+      }
+    }
+
+    position += length;
+    offset += 1 + length;
+  }
+  return false;
+}
+
+// Reads the name at `offset` in lower case without the trailing dot,
+// following compression pointers.
+bool ReadName(const uint8_t* data, size_t size, size_t offset,
+              std::string* name) {
+  name->clear();
+  int pointers = 0;
+
+  while (offset < size) {
+    uint8_t length = data[offset];
+    if ((length & 0xC0) == 0xC0) {
+      if (offset + 2 > size || ++pointers > kMaxPointers) {
+        return false;
+      }
+      offset = ReadUint16(data + offset) & 0x3FFF;
+      continue;
+    }
+    if (length & 0xC0) {
+      return false;
+    }
+
+    if (!length) {
+      return true;
+    }
+
+    if (offset + 1 + length > size ||
+        name->size() + 1 + length > kMaxNameLength) {
+      return false;
+    }
+
+    if (!name->empty()) {
+      name->push_back('.');
+    }
+    for (size_t i = 0; i < length; i++) {
+      name->push_back(static_cast<char>(std::tolower(data[offset + 1 + i])));
+    }
+    offset += 1 + length;
+  }
+  return false;
+}
+
+struct Answer {
+  std::string owner;
+  uint16_t type;
+  uint32_t ttl;
+  size_t offset;
+  uint16_t length;
+};
+}  // namespace
+
+bool EncodeDnsQuery(uint16_t id, const std::string& domain, DnsRecordType type,
+                    std::vector<uint8_t>* buffer) {
+  size_t length = domain.size();
+  if (length && domain.back() == '.') {
+    length--;
+  }
+  if (!length || length + 2 > kMaxNameLength) {
+    return false;
+  }
+
+  buffer->reserve(buffer->size() + kHeaderSize + length + 6);
+
+  WriteUint16(id, buffer);
+  WriteUint16(kFlagRecursionDesired, buffer);
+  // One question, no other records.
+  WriteUint16(1, buffer);
+  WriteUint16(0, buffer);
+  WriteUint16(0, buffer);
+  WriteUint16(0, buffer);
+
+  size_t start = 0;
+  while (start <= length) {
+    size_t end = domain.find('.', start);
+    if (end == std::string::npos || end > length) {
+      end = length;
+    }
+
+    size_t label = end - start;
+    if (!label || label > kMaxLabelLength) {
+      return false;
+    }
+
+    buffer->push_back(static_cast<uint8_t>(label));
+    buffer->insert(buffer->end(), domain.begin() + start, domain.begin() + end);
+    start = end + 1;
+  }
+  buffer->push_back(0);
+
+  WriteUint16(static_cast<uint16_t>(type), buffer);
+  WriteUint16(kClassIn, buffer);
+  return true;
+}
+
+bool ParseDnsResponse(const uint8_t* data, size_t size,
+                      const std::string& domain, DnsRecordType type,
+                      DnsResponse* response) {
+  if (size < kHeaderSize) {
+    return false;
+  }
+
+  uint16_t flags = ReadUint16(data + 2);
+  if (!(flags & kFlagResponse) || ReadUint16(data + 4) != 1) {
+    return false;
+  }
+
+  response->id = ReadUint16(data);
+  response->truncated = flags & kFlagTruncated;
+  response->code = static_cast<DnsResponseCode>(flags & 0x000F);
+  response->records.clear();
+
+  std::string name = domain;
+  if (!name.empty() && name.back() == '.') {
+    name.pop_back();
+  }
+
+  size_t offset = kHeaderSize;
+  if (!MatchName(data, size, offset, name) || !SkipName(data, size, &offset) ||
+      offset + 4 > size) {
+    return false;
+  }
+  if (ReadUint16(data + offset) != static_cast<uint16_t>(type) ||
+      ReadUint16(data + offset + 2) != kClassIn) {
+    return false;
+  }
+  offset += 4;
+
+  // A truncated response may end anywhere, the answers are not used anyway.
+  if (response->truncated) {
+    return true;
+  }
+
+  uint16_t count = ReadUint16(data + 6);
+  std::vector<Answer> answers;
+  answers.reserve(count);
+  for (uint16_t i = 0; i < count; i++) {
+    Answer answer;
+    if (!ReadName(data, size, offset, &answer.owner) ||
+        !SkipName(data, size, &offset) || offset + 10 > size) {
+      return false;
+    }
+
+    answer.type = ReadUint16(data + offset);
+    uint16_t record_class = ReadUint16(data + offset + 2);
+    answer.ttl = ReadUint32(data + offset + 4);
+    answer.length = ReadUint16(data + offset + 8);
+    offset += 10;
+    answer.offset = offset;
+
+    if (offset + answer.length > size) {
+      return false;
+    }
+    offset += answer.length;
+
+    if (record_class == kClassIn) {
+      answers.push_back(std::move(answer));
+    }
+  }
+
+  // Only records of the queried name, or of the names it is an alias of, are
+  // answers to the question. Each step of the chain removes one alias, so the
+  // chain is never longer than the number of records.
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  uint32_t chain_ttl = std::numeric_limits<uint32_t>::max();
+  std::string target;
+  for (size_t step = 0; step <= answers.size(); step++) {
+    for (const auto& answer : answers) {
+      if (answer.owner != name || answer.type != static_cast<uint16_t>(type)) {
+        continue;
+      }
+
+      uint32_t ttl = std::min(answer.ttl, chain_ttl);
+      if (type == DnsRecordType::A && answer.length == 4) {
+        boost::asio::ip::address_v4::bytes_type bytes;
+        std::copy(data + answer.offset, data + answer.offset + 4,
+                  bytes.begin());
+        response->records.push_back({boost::asio::ip::address_v4(bytes), ttl});
+      } else if (type == DnsRecordType::AAAA && answer.length == 16) {
+        boost::asio::ip::address_v6::bytes_type bytes;
+        std::copy(data + answer.offset, data + answer.offset + 16,
+                  bytes.begin());
+        response->records.push_back({boost::asio::ip::address_v6(bytes), ttl});
+      }
+    }
+
+    if (!response->records.empty()) {
+      break;
+    }
+
+    auto alias = std::find_if(
+        answers.begin(), answers.end(), [&name](const Answer& answer) {
+          return answer.owner == name &&
+                 answer.type == static_cast<uint16_t>(DnsRecordType::CNAME);
+        });
+    if (alias == answers.end() ||
+        !ReadName(data, size, alias->offset, &target)) {
+      break;
+    }
+    chain_ttl = std::min(chain_ttl, alias->ttl);
+    name = target;
+  }
+
+  return true;
+}
+}  // namespace utils
+}  // namespace nekit
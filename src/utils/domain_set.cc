@@ -0,0 +1,281 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/domain_set.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nekit {
+namespace utils {
+
+constexpr uint32_t DomainSet::kNoMatch;
+const uint32_t DomainSet::kEmpty;
+const size_t DomainSet::kHeaderSize;
+
+namespace {
+const uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+const uint64_t kFnvPrime = 0x100000001b3ULL;
+
+uint8_t Fold(char ch) {
+  return ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : static_cast<uint8_t>(ch);
+}
+
+bool EqualsIgnoringCase(boost::string_view lhs, boost::string_view rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); i++) {
+    if (Fold(lhs[i]) != Fold(rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t Combine(uint64_t suffix, uint64_t label) {
+  // Keeps `a.b` and `b.a` apart.
+  uint64_t hash = suffix ^ (label + 0x9e3779b97f4a7c15ULL + (suffix << 6) +
+                            (suffix >> 2));
+  return hash * kFnvPrime;
+}
+
+// Precedes the slots and the pool in a saved set.
+struct SavedHeader {
+  uint64_t size;
+  uint64_t depths;
+  uint64_t suffix_depths;
+  uint64_t slot_count;
+  uint64_t names_size;
+};
+}  // namespace
+
+template <typename Visitor>
+void DomainSet::ForEachSuffix(boost::string_view domain, Visitor visitor) {
+  uint64_t hash = kFnvOffset;
+  size_t end = domain.size();
+  for (unsigned depth = 1;; depth++) {
+    size_t start = end;
+    uint64_t label = kFnvOffset;
+    while (start > 0 && domain[start - 1] != '.') {
+      start--;
+    }
+    for (size_t i = start; i < end; i++) {
+      label = (label ^ Fold(domain[i])) * kFnvPrime;
+    }
+    hash = Combine(hash, label);
+    visitor(hash, start, depth);
+    if (start == 0) {
+      return;
+    }
+    // Skip the dot.
+    end = start - 1;
+  }
+}
+
+void DomainSet::AddDomain(boost::string_view domain, uint32_t value) {
+  Add(domain, false, value);
+}
+
+void DomainSet::AddSuffix(boost::string_view domain, uint32_t value) {
+  Add(domain, true, value);
+}
+
+uint32_t DomainSet::Match(boost::string_view host) const {
+  uint32_t result = kNoMatch;
+  if (!size_ || host.empty()) {
+    return result;
+  }
+
+  ForEachSuffix(host, [this, host, &result](uint64_t hash, size_t start,
+                                            unsigned depth) {
+    if (!((start ? suffix_depths_ : depths_) & DepthBit(depth)) ||
+        !filter_.MayContain(hash)) {
+      return;
+    }
+    const Slot& slot = slots_[Probe(hash, host.substr(start))];
+    if (slot.offset != kEmpty) {
+      result = std::min(result, Value(slot, true));
+      if (!start) {
+        result = std::min(result, Value(slot, false));
+      }
+    }
+  });
+  return result;
+}
+
+void DomainSet::BuildFilter(double bits_per_key) {
+  filter_ = BloomFilter(size_, bits_per_key);
+  for (const auto& slot : slots_) {
+    if (slot.offset != kEmpty) {
+      unsigned depth;
+      filter_.Insert(Hash(Name(slot), &depth));
+    }
+  }
+}
+
+uint64_t DomainSet::Hash(boost::string_view domain, unsigned* depth) {
+  uint64_t hash = 0;
+  ForEachSuffix(domain, [&hash, depth](uint64_t suffix_hash, size_t,
+                                       unsigned suffix_depth) {
+    hash = suffix_hash;
+    *depth = suffix_depth;
+  });
+  return hash;
+}
+
+uint32_t DomainSet::Value(const Slot& slot, bool suffix) const {
+  uint32_t value;
+  std::memcpy(&value,
+              names_.data() + slot.offset + 1 + suffix * sizeof(uint32_t),
+              sizeof(value));
+  return value;
+}
+
+void DomainSet::Add(boost::string_view domain, bool suffix, uint32_t value) {
+  if (domain.empty() || domain.size() > 255) {
+    return;
+  }
+
+  // Misses probe until an empty slot, keep them short.
+  if ((size_ + 1) * 2 > slots_.size()) {
+    Grow();
+  }
+
+  unsigned depth;
+  uint64_t hash = Hash(domain, &depth);
+  depths_ |= DepthBit(depth);
+  if (suffix) {
+    suffix_depths_ |= DepthBit(depth);
+  }
+
+  auto& slots = slots_.Mutable();
+  auto& names = names_.Mutable();
+  Slot& slot = slots[Probe(hash, domain)];
+  if (slot.offset == kEmpty) {
+    slot = Slot{static_cast<uint32_t>(hash >> 32),
+                static_cast<uint32_t>(names.size())};
+    names.push_back(static_cast<char>(domain.size()));
+    // Both values start as `kNoMatch`.
+    names.insert(names.end(), 2 * sizeof(uint32_t), '\xff');
+    names.insert(names.end(), domain.begin(), domain.end());
+    size_++;
+    if (!filter_.empty()) {
+      filter_.Insert(hash);
+    }
+  }
+
+  if (value < Value(slot, suffix)) {
+    std::memcpy(&names[slot.offset + 1 + suffix * sizeof(uint32_t)], &value,
+                sizeof(value));
+  }
+}
+
+size_t DomainSet::Probe(uint64_t hash, boost::string_view name) const {
+  const size_t mask = slots_.size() - 1;
+  const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Slot& slot = slots_[i];
+    if (slot.offset == kEmpty ||
+        (slot.tag == tag && EqualsIgnoringCase(Name(slot), name))) {
+      return i;
+    }
+  }
+}
+
+void DomainSet::Grow() {
+  std::vector<Slot> slots(std::max<size_t>(slots_.size() * 2, 16),
+                          Slot{0, kEmpty});
+  const size_t mask = slots.size() - 1;
+  for (const auto& slot : slots_) {
+    if (slot.offset == kEmpty) {
+      continue;
+    }
+    // The low bits of the hash are not kept, so hash the domain again.
+    unsigned depth;
+    uint64_t hash = Hash(Name(slot), &depth);
+    size_t i = hash & mask;
+    while (slots[i].offset != kEmpty) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+  slots_.Assign(std::move(slots));
+}
+
+void DomainSet::Save(std::string* out) const {
+  SavedHeader header{size_, depths_, suffix_depths_, slots_.size(),
+                     names_.size()};
+  out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  out->append(reinterpret_cast<const char*>(slots_.data()),
+              slots_.size() * sizeof(Slot));
+  out->append(names_.data(), names_.size());
+}
+
+bool DomainSet::Map(const void* data, size_t size,
+                    std::shared_ptr<const void> owner) {
+  if (size < sizeof(SavedHeader) ||
+      reinterpret_cast<uintptr_t>(data) % alignof(SavedHeader)) {
+    return false;
+  }
+
+  SavedHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  size_t available = size - sizeof(SavedHeader);
+  if (header.slot_count & (header.slot_count - 1) ||
+      header.slot_count > available / sizeof(Slot) ||
+      header.names_size != available - header.slot_count * sizeof(Slot) ||
+      header.names_size > kEmpty || header.size * 2 > header.slot_count) {
+    return false;
+  }
+
+  const Slot* slots = reinterpret_cast<const Slot*>(
+      static_cast<const char*>(data) + sizeof(SavedHeader));
+  const char* names = reinterpret_cast<const char*>(slots + header.slot_count);
+  // An empty slot must remain to end the probes of a miss.
+  size_t used = 0;
+  for (size_t i = 0; i < header.slot_count; i++) {
+    if (slots[i].offset == kEmpty) {
+      continue;
+    }
+    if (slots[i].offset + kHeaderSize > header.names_size ||
+        slots[i].offset + kHeaderSize +
+                static_cast<uint8_t>(names[slots[i].offset]) >
+            header.names_size) {
+      return false;
+    }
+    used++;
+  }
+  if (used != header.size) {
+    return false;
+  }
+
+  slots_.Map(slots, header.slot_count, owner);
+  names_.Map(names, header.names_size, std::move(owner));
+  size_ = header.size;
+  depths_ = header.depths;
+  suffix_depths_ = header.suffix_depths;
+  filter_ = BloomFilter();
+  return true;
+}
+}  // namespace utils
+}  // namespace nekit
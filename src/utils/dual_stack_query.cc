@@ -0,0 +1,179 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/dual_stack_query.h"
+
+#include <algorithm>
+
+#include "nekit/utils/error.h"
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Dual stack query"
+
+namespace nekit {
+namespace utils {
+
+Cancelable DualStackQuery::Start(boost::asio::io_context* io,
+                                 AddressPreference preference,
+                                 std::chrono::milliseconds grace, Lookup lookup,
+                                 TtlEventHandler handler) {
+  switch (preference) {
+    case AddressPreference::IPv4Only:
+      return lookup(false, handler);
+    case AddressPreference::IPv6Only:
+      return lookup(true, handler);
+    default:
+      break;
+  }
+
+  Cancelable cancelable{};
+  std::make_shared<DualStackQuery>(io, preference, grace, cancelable, handler)
+      ->Run(lookup);
+  return cancelable;
+}
+
+DualStackQuery::DualStackQuery(boost::asio::io_context* io,
+                               AddressPreference preference,
+                               std::chrono::milliseconds grace,
+                               Cancelable cancelable, TtlEventHandler handler)
+    : preference_{preference},
+      grace_{grace},
+      cancelable_{cancelable},
+      handler_{handler},
+      timer_{*io} {
+  switch (preference_) {
+    case AddressPreference::IPv4:
+      preferred_ = 0;
+      break;
+    case AddressPreference::IPv6:
+      preferred_ = 1;
+      break;
+    default:
+      break;
+  }
+}
+
+void DualStackQuery::Run(Lookup lookup) {
+  for (int v6 = 0; v6 < 2; v6++) {
+    lookups_[v6] =
+        lookup(v6, [self{shared_from_this()}, v6](
+                       std::shared_ptr<std::vector<boost::asio::ip::address>>
+                           addresses,
+                       std::chrono::seconds ttl, std::error_code ec) {
+          self->Handle(v6, {true, addresses, ttl, ec});
+        });
+  }
+}
+
+void DualStackQuery::Handle(bool v6, Result result) {
+  if (finished_) {
+    return;
+  }
+
+  if (cancelable_.canceled()) {
+    finished_ = true;
+    timer_.cancel();
+    lookups_[!v6].Cancel();
+    return;
+  }
+
+  results_[v6] = result;
+
+  if (results_[!v6].done) {
+    return Finish();
+  }
+
+  if (result.error) {
+    // Wait for the other family.
+    return;
+  }
+
+  if (preferred_ < 0) {
+    preferred_ = v6;
+  }
+
+  if (preferred_ != v6) {
+    return;
+  }
+
+  timer_.expires_after(grace_);
+  timer_.async_wait(
+      [self{shared_from_this()}](const boost::system::error_code& ec) {
+        if (ec || self->finished_) {
+          return;
+        }
+
+        if (self->cancelable_.canceled()) {
+          self->finished_ = true;
+          self->lookups_[0].Cancel();
+          self->lookups_[1].Cancel();
+          return;
+        }
+
+        NEDEBUG << "The other address family did not answer in time.";
+        self->Finish();
+      });
+}
+
+void DualStackQuery::Finish() {
+  finished_ = true;
+  timer_.cancel();
+
+  int first = std::max(preferred_, 0);
+  int second = !first;
+
+  std::shared_ptr<std::vector<boost::asio::ip::address>> addresses;
+  std::chrono::seconds ttl{kUnknownTtl};
+
+  for (int v6 : {first, second}) {
+    const auto& result = results_[v6];
+    if (!result.done) {
+      lookups_[v6].Cancel();
+      continue;
+    }
+    if (result.error || !result.addresses) {
+      continue;
+    }
+
+    if (!addresses) {
+      addresses = std::make_shared<std::vector<boost::asio::ip::address>>();
+      ttl = result.ttl;
+    } else if (result.ttl != kUnknownTtl &&
+               (ttl == kUnknownTtl || result.ttl < ttl)) {
+      ttl = result.ttl;
+    }
+    addresses->insert(addresses->end(), result.addresses->begin(),
+                      result.addresses->end());
+  }
+
+  if (addresses) {
+    return handler_(addresses, ttl, NEKitErrorCode::NoError);
+  }
+
+  // Report the error of the preferred family.
+  const auto& result =
+      results_[first].done ? results_[first] : results_[second];
+  handler_(nullptr, result.ttl, result.error);
+}
+}  // namespace utils
+}  // namespace nekit
@@ -22,6 +22,9 @@
 
 #include "nekit/utils/endpoint.h"
 
+#include <algorithm>
+
+#include <boost/asio/post.hpp>
 #include <boost/assert.hpp>
 
 #include "nekit/utils/error.h"
@@ -64,34 +67,91 @@ Cancelable Endpoint::ForceResolve(EventHandler handler) {
   NETRACE << "Start resolving domain " << domain_ << ".";
 
   resolving_ = true;
+  // Added first in case the resolver calls back at once.
+  auto cancelable = AddWaiter(handler);
 
   resolve_cancelable_ = resolver_->Resolve(
-      domain_, ResolverInterface::AddressPreference::Any,
-      [this, handler, cancelable{life_time_cancelable()}](
+      domain_, address_preference_,
+      [this, lifetime{life_time_cancelable()}](
           std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
           std::error_code ec) {
-        if (cancelable.canceled()) {
+        // Not resolving if all the waiters canceled.
+        if (lifetime.canceled() || !resolving_) {
           return;
         }
 
         resolving_ = false;
         resolved_ = true;
+        error_ = ec;
 
         if (ec) {
           NEERROR << "Failed to resolve " << domain_ << " due to " << ec << ".";
-          error_ = ec;
           resolved_addresses_ = nullptr;
-          handler(ec);
-          return;
+        } else {
+          NEINFO << "Successfully resolved domain " << domain_ << ".";
+          resolved_addresses_ = addresses;
         }
 
-        NEINFO << "Successfully resolved domain " << domain_ << ".";
+        // Any handler may release the endpoint.
+        auto waiters = std::move(waiters_);
+        waiters_.clear();
+        for (auto& waiter : waiters) {
+          if (!waiter.first.canceled()) {
+            waiter.second(ec);
+          }
+        }
+      });
+
+  return cancelable;
+}
+
+Cancelable Endpoint::WaitResolved(EventHandler handler) {
+  BOOST_ASSERT(resolver_);
+
+  if (!resolving_ && !resolved_) {
+    return ForceResolve(handler);
+  }
+
+  if (resolving_) {
+    NETRACE << "Wait for the resolution of domain " << domain_ << ".";
+    return AddWaiter(handler);
+  }
+
+  Cancelable cancelable;
+  boost::asio::post(*resolver_->io(), [this, handler, cancelable,
+                                       lifetime{life_time_cancelable()}]() {
+    if (cancelable.canceled() || lifetime.canceled()) {
+      return;
+    }
+    handler(error_);
+  });
+  return cancelable;
+}
 
-        resolved_addresses_ = addresses;
-        handler(ec);
+Cancelable Endpoint::AddWaiter(EventHandler handler) {
+  Cancelable cancelable(
+      [this, lifetime{life_time_cancelable()}]() {
+        if (!lifetime.canceled()) {
+          DropCanceledWaiters();
+        }
       });
+  waiters_.emplace_back(cancelable, handler);
+  return cancelable;
+}
+
+void Endpoint::DropCanceledWaiters() {
+  if (!resolving_ ||
+      std::any_of(waiters_.begin(), waiters_.end(),
+                  [](const std::pair<Cancelable, EventHandler>& waiter) {
+                    return !waiter.first.canceled();
+                  })) {
+    return;
+  }
 
-  return resolve_cancelable_;
+  NETRACE << "Cancel resolving domain " << domain_ << ".";
+  resolving_ = false;
+  waiters_.clear();
+  resolve_cancelable_.Cancel();
 }
 
 std::shared_ptr<Endpoint> Endpoint::Dup() const {
@@ -104,6 +164,7 @@ std::shared_ptr<Endpoint> Endpoint::Dup() const {
   }
 
   endpoint_->set_ip_protocol(ip_protocol_);
+  endpoint_->set_address_preference(address_preference_);
 
   return endpoint_;
 }
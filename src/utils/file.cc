@@ -0,0 +1,95 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+
+namespace nekit {
+namespace utils {
+namespace {
+std::error_code LastError() {
+  return std::error_code(errno, std::generic_category());
+}
+}  // namespace
+
+std::error_code ReplaceFile(const std::string& path, const std::string& data) {
+  std::string temp_path = path + ".tmp";
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    return LastError();
+  }
+
+  size_t written = 0;
+  while (written < data.size()) {
+    auto n = write(fd, data.data() + written, data.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      auto ec = LastError();
+      close(fd);
+      std::remove(temp_path.c_str());
+      return ec;
+    }
+    written += size_t(n);
+  }
+
+  if (fsync(fd)) {
+    auto ec = LastError();
+    close(fd);
+    std::remove(temp_path.c_str());
+    return ec;
+  }
+
+  if (close(fd)) {
+    auto ec = LastError();
+    std::remove(temp_path.c_str());
+    return ec;
+  }
+
+  if (std::rename(temp_path.c_str(), path.c_str())) {
+    auto ec = LastError();
+    std::remove(temp_path.c_str());
+    return ec;
+  }
+
+  // Persist the rename as well. Failing here does not lose the file, it only
+  // means the old one may come back after a crash.
+  auto slash = path.rfind('/');
+  std::string directory =
+      slash == std::string::npos ? "." : path.substr(0, slash + 1);
+  int directory_fd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+  if (directory_fd >= 0) {
+    fsync(directory_fd);
+    close(directory_fd);
+  }
+
+  return std::error_code();
+}
+}  // namespace utils
+}  // namespace nekit
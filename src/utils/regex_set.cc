@@ -0,0 +1,678 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/regex_set.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+namespace nekit {
+namespace utils {
+
+namespace {
+// Bounds the NFA a single expression may expand to, e.g., with `a{1000}`.
+const size_t kMaxNodesPerExpression = 1 << 14;
+
+// Thrown by the parser when the expression is valid but not supported.
+struct Unsupported {};
+}  // namespace
+
+struct RegexSet::Ast {
+  enum class Type { Empty, Set, Begin, End, Concat, Alternate, Repeat };
+
+  Type type{Type::Empty};
+  CharSet set;
+  std::vector<Ast> children;
+  // `max` is -1 if unbounded.
+  int min{0}, max{0};
+};
+
+// Recursive descent parser for the supported subset of ECMAScript.
+class RegexSet::Parser {
+ public:
+  Parser(const std::string& expression, bool icase)
+      : expression_{expression}, icase_{icase} {}
+
+  Ast Parse() {
+    Ast ast = ParseAlternate();
+    if (!AtEnd()) {
+      throw Unsupported();
+    }
+    return ast;
+  }
+
+ private:
+  Ast ParseAlternate() {
+    Ast ast = ParseConcat();
+    if (Peek() != '|') {
+      return ast;
+    }
+
+    Ast alternate;
+    alternate.type = Ast::Type::Alternate;
+    alternate.children.push_back(std::move(ast));
+    while (Consume('|')) {
+      alternate.children.push_back(ParseConcat());
+    }
+    return alternate;
+  }
+
+  Ast ParseConcat() {
+    Ast concat;
+    concat.type = Ast::Type::Concat;
+    while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+      concat.children.push_back(ParseRepeat());
+    }
+    return concat;
+  }
+
+  Ast ParseRepeat() {
+    Ast ast = ParseAtom();
+    while (!AtEnd()) {
+      int min, max;
+      char c = Peek();
+      if (c == '*') {
+        min = 0, max = -1;
+      } else if (c == '+') {
+        min = 1, max = -1;
+      } else if (c == '?') {
+        min = 0, max = 1;
+      } else if (c == '{') {
+        ParseBounds(&min, &max);
+      } else {
+        break;
+      }
+      ++position_;
+      // Laziness does not change whether there is a match.
+      Consume('?');
+
+      Ast repeat;
+      repeat.type = Ast::Type::Repeat;
+      repeat.min = min;
+      repeat.max = max;
+      repeat.children.push_back(std::move(ast));
+      ast = std::move(repeat);
+    }
+    return ast;
+  }
+
+  // Leaves `position_` at the closing brace.
+  void ParseBounds(int* min, int* max) {
+    ++position_;
+    *min = ParseNumber();
+    if (Consume(',')) {
+      *max = Peek() == '}' ? -1 : ParseNumber();
+    } else {
+      *max = *min;
+    }
+    if (Peek() != '}' || (*max != -1 && *max < *min)) {
+      throw Unsupported();
+    }
+  }
+
+  int ParseNumber() {
+    int number = 0;
+    size_t start = position_;
+    while (!AtEnd() && std::isdigit(static_cast<uint8_t>(Peek()))) {
+      number = number * 10 + (Peek() - '0');
+      if (number > 1000) {
+        throw Unsupported();
+      }
+      ++position_;
+    }
+    if (position_ == start) {
+      throw Unsupported();
+    }
+    return number;
+  }
+
+  Ast ParseAtom() {
+    Ast ast;
+    ast.type = Ast::Type::Set;
+
+    char c = Next();
+    switch (c) {
+      case '(':
+        if (Consume('?') && !Consume(':')) {
+          throw Unsupported();
+        }
+        ast = ParseAlternate();
+        if (!Consume(')')) {
+          throw Unsupported();
+        }
+        return ast;
+      case '[':
+        ast.set = ParseClass();
+        break;
+      case '.':
+        ast.set.set();
+        ast.set.reset('\n');
+        ast.set.reset('\r');
+        break;
+      case '\\':
+        ast.set = ParseEscape();
+        break;
+      case '^':
+        ast.type = Ast::Type::Begin;
+        return ast;
+      case '$':
+        ast.type = Ast::Type::End;
+        return ast;
+      case '*':
+      case '+':
+      case '?':
+      case '{':
+      case '}':
+      case ')':
+      case ']':
+        throw Unsupported();
+      default:
+        ast.set.set(static_cast<uint8_t>(c));
+    }
+
+    if (icase_) {
+      Fold(&ast.set);
+    }
+    return ast;
+  }
+
+  CharSet ParseClass() {
+    CharSet set;
+    bool negate = Consume('^');
+    bool first = true;
+    while (true) {
+      char c = Next();
+      if (c == ']' && !first) {
+        break;
+      }
+      first = false;
+
+      CharSet low;
+      if (c == '\\') {
+        low = ParseEscape();
+      } else if (c == '[' || c == ']') {
+        throw Unsupported();
+      } else {
+        low.set(static_cast<uint8_t>(c));
+      }
+
+      if (Peek() == '-' && Peek(1) != ']' && low.count() == 1) {
+        ++position_;
+        char high = Next();
+        if (high == '\\' || high == '[') {
+          throw Unsupported();
+        }
+        int from = 0;
+        while (!low.test(from)) {
+          ++from;
+        }
+        if (from > static_cast<uint8_t>(high)) {
+          throw Unsupported();
+        }
+        for (int i = from; i <= static_cast<uint8_t>(high); ++i) {
+          low.set(i);
+        }
+      }
+      set |= low;
+    }
+
+    // Case folding applies before negation.
+    if (icase_) {
+      Fold(&set);
+    }
+    return negate ? ~set : set;
+  }
+
+  CharSet ParseEscape() {
+    CharSet set;
+    char c = Next();
+    switch (c) {
+      case 'd':
+      case 'D':
+        for (int i = '0'; i <= '9'; ++i) {
+          set.set(i);
+        }
+        break;
+      case 'w':
+      case 'W':
+        for (int i = 0; i < 128; ++i) {
+          if (std::isalnum(i) || i == '_') {
+            set.set(i);
+          }
+        }
+        break;
+      case 's':
+      case 'S':
+        for (char s : std::string(" \t\n\v\f\r")) {
+          set.set(static_cast<uint8_t>(s));
+        }
+        break;
+      case 't':
+        set.set('\t');
+        return set;
+      case 'n':
+        set.set('\n');
+        return set;
+      case 'r':
+        set.set('\r');
+        return set;
+      default:
+        // Backreferences, word boundaries, hex and unicode escapes and the
+        // like.
+        if (std::isalnum(static_cast<uint8_t>(c))) {
+          throw Unsupported();
+        }
+        set.set(static_cast<uint8_t>(c));
+        return set;
+    }
+    return std::isupper(static_cast<uint8_t>(c)) ? ~set : set;
+  }
+
+  static void Fold(CharSet* set) {
+    for (int i = 'a'; i <= 'z'; ++i) {
+      int upper = std::toupper(i);
+      if (set->test(i) || set->test(upper)) {
+        set->set(i);
+        set->set(upper);
+      }
+    }
+  }
+
+  bool AtEnd() const { return position_ >= expression_.size(); }
+
+  char Peek(size_t offset = 0) const {
+    return position_ + offset < expression_.size()
+               ? expression_[position_ + offset]
+               : '\0';
+  }
+
+  char Next() {
+    if (AtEnd()) {
+      throw Unsupported();
+    }
+    return expression_[position_++];
+  }
+
+  bool Consume(char c) {
+    if (!AtEnd() && expression_[position_] == c) {
+      ++position_;
+      return true;
+    }
+    return false;
+  }
+
+  const std::string& expression_;
+  bool icase_;
+  size_t position_{0};
+};
+
+RegexSet::RegexSet(bool icase, size_t max_dfa_states)
+    : icase_{icase}, max_dfa_states_{std::max<size_t>(max_dfa_states, 2)} {}
+
+bool RegexSet::Add(const std::string& expression) {
+  // Let `std::regex` decide what is valid so both paths agree on it.
+  auto flags = std::regex::ECMAScript | std::regex::nosubs |
+               std::regex::optimize;
+  if (icase_) {
+    flags |= std::regex::icase;
+  }
+  std::regex regex;
+  try {
+    regex.assign(expression, flags);
+  } catch (...) {
+    return false;
+  }
+
+  const size_t set_count = sets_.size();
+  expression_start_ = nfa_.size();
+  try {
+    Ast ast = Parser(expression, icase_).Parse();
+    starts_.push_back(Compile(ast, NewNode(NfaNode::Type::Accept)));
+  } catch (const Unsupported&) {
+    nfa_.resize(expression_start_);
+    sets_.resize(set_count);
+    fallback_.push_back(std::move(regex));
+    return true;
+  }
+
+  ++compiled_count_;
+  generation_.reset();
+  return true;
+}
+
+bool RegexSet::Search(const std::string& text) {
+  if (compiled_count_) {
+    if (!generation_) {
+      Prepare();
+    }
+
+    Dfa* dfa = ThreadDfa();
+    int32_t state = Start(dfa);
+    for (uint8_t ch : text) {
+      const DfaState& current = dfa->states[state];
+      if (current.accept) {
+        return true;
+      }
+      if (current.dead) {
+        break;
+      }
+      int32_t next = current.next[classes_[ch]];
+      state = next >= 0 ? next : Transition(dfa, state, classes_[ch]);
+    }
+    if (dfa->states[state].accept || dfa->states[state].accept_at_end) {
+      return true;
+    }
+  }
+
+  for (const auto& regex : fallback_) {
+    if (std::regex_search(text, regex)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t RegexSet::Compile(const Ast& ast, uint32_t next) {
+  switch (ast.type) {
+    case Ast::Type::Empty:
+      return next;
+    case Ast::Type::Set: {
+      uint32_t node = NewNode(NfaNode::Type::Set);
+      nfa_[node].set = sets_.size();
+      nfa_[node].outs.push_back(next);
+      sets_.push_back(ast.set);
+      return node;
+    }
+    case Ast::Type::Begin:
+    case Ast::Type::End: {
+      uint32_t node = NewNode(ast.type == Ast::Type::Begin
+                                  ? NfaNode::Type::Begin
+                                  : NfaNode::Type::End);
+      nfa_[node].outs.push_back(next);
+      return node;
+    }
+    case Ast::Type::Concat:
+      for (auto it = ast.children.rbegin(); it != ast.children.rend(); ++it) {
+        next = Compile(*it, next);
+      }
+      return next;
+    case Ast::Type::Alternate: {
+      std::vector<uint32_t> outs;
+      for (const auto& child : ast.children) {
+        outs.push_back(Compile(child, next));
+      }
+      uint32_t node = NewNode(NfaNode::Type::Epsilon);
+      nfa_[node].outs = std::move(outs);
+      return node;
+    }
+    case Ast::Type::Repeat: {
+      const Ast& child = ast.children.front();
+      uint32_t current = next;
+      if (ast.max < 0) {
+        current = NewNode(NfaNode::Type::Epsilon);
+        uint32_t body = Compile(child, current);
+        nfa_[current].outs = {body, next};
+      } else {
+        for (int i = ast.min; i < ast.max; ++i) {
+          uint32_t body = Compile(child, current);
+          uint32_t node = NewNode(NfaNode::Type::Epsilon);
+          nfa_[node].outs = {body, next};
+          current = node;
+        }
+      }
+      for (int i = 0; i < ast.min; ++i) {
+        current = Compile(child, current);
+      }
+      return current;
+    }
+  }
+  return next;
+}
+
+uint32_t RegexSet::NewNode(NfaNode::Type type) {
+  if (nfa_.size() - expression_start_ >= kMaxNodesPerExpression) {
+    throw Unsupported();
+  }
+  nfa_.emplace_back();
+  nfa_.back().type = type;
+  return nfa_.size() - 1;
+}
+
+void RegexSet::Prepare() {
+  if (generation_) {
+    return;
+  }
+
+  // Bytes no expression tells apart share a class, and a column in the
+  // transition tables.
+  std::array<uint16_t, 256> classes{};
+  uint16_t class_count = 1;
+  std::vector<int32_t> split;
+  for (const auto& set : sets_) {
+    split.assign(class_count * 2, -1);
+    uint16_t count = 0;
+    for (int ch = 0; ch < 256; ++ch) {
+      int32_t& next = split[classes[ch] * 2 + set.test(ch)];
+      if (next < 0) {
+        next = count++;
+      }
+      classes[ch] = next;
+    }
+    class_count = count;
+  }
+  class_count_ = class_count;
+  representatives_.resize(class_count_);
+  for (int ch = 255; ch >= 0; --ch) {
+    classes_[ch] = static_cast<uint8_t>(classes[ch]);
+    representatives_[classes_[ch]] = static_cast<uint8_t>(ch);
+  }
+
+  Dfa scratch;
+  scratch.visited.assign(nfa_.size(), 0);
+
+  // Any position may start a match, so every state has these nodes. They are
+  // left out of the states to keep them small.
+  restart_ = Closure(&scratch, starts_, false, false);
+  in_restart_.assign(nfa_.size(), false);
+  for (uint32_t node : restart_) {
+    in_restart_[node] = true;
+  }
+
+  restart_moves_.assign(class_count_, {});
+  for (size_t byte_class = 0; byte_class < class_count_; ++byte_class) {
+    uint8_t ch = representatives_[byte_class];
+    std::vector<uint32_t> seeds;
+    for (uint32_t node : restart_) {
+      const NfaNode& nfa_node = nfa_[node];
+      if (nfa_node.type == NfaNode::Type::Set && sets_[nfa_node.set].test(ch)) {
+        seeds.push_back(nfa_node.outs.front());
+      }
+    }
+    restart_moves_[byte_class] =
+        Closure(&scratch, std::move(seeds), false, false);
+  }
+
+  // The DFAs built before are of the old expressions.
+  generation_ = std::make_shared<Generation>();
+}
+
+size_t RegexSet::dfa_state_count() const {
+  return generation_ ? ThreadDfa()->states.size() : 0;
+}
+
+RegexSet::Dfa* RegexSet::ThreadDfa() const {
+  // By generation, an entry whose generation expired is never found again
+  // and is dropped when another one is added.
+  using Entry =
+      std::pair<std::weak_ptr<const Generation>, std::unique_ptr<Dfa>>;
+  thread_local std::unordered_map<const Generation*, Entry> dfas;
+
+  auto iter = dfas.find(generation_.get());
+  if (iter != dfas.end() && !iter->second.first.expired()) {
+    return iter->second.second.get();
+  }
+
+  for (auto it = dfas.begin(); it != dfas.end();) {
+    it = it->second.first.expired() ? dfas.erase(it) : std::next(it);
+  }
+  auto dfa = std::make_unique<Dfa>();
+  dfa->visited.assign(nfa_.size(), 0);
+  Dfa* result = dfa.get();
+  dfas[generation_.get()] = Entry(generation_, std::move(dfa));
+  return result;
+}
+
+int32_t RegexSet::Start(Dfa* dfa) const {
+  if (dfa->start < 0) {
+    dfa->start = Intern(dfa, Closure(dfa, starts_, true, false), true);
+  }
+  return dfa->start;
+}
+
+int32_t RegexSet::Transition(Dfa* dfa, int32_t state,
+                             uint8_t byte_class) const {
+  std::vector<uint32_t> seeds;
+  for (uint32_t node : dfa->states[state].nodes) {
+    const NfaNode& nfa_node = nfa_[node];
+    if (nfa_node.type == NfaNode::Type::Set &&
+        sets_[nfa_node.set].test(representatives_[byte_class])) {
+      seeds.push_back(nfa_node.outs.front());
+    }
+  }
+  std::vector<uint32_t> nodes = Closure(dfa, std::move(seeds), false, false);
+  const auto& moves = restart_moves_[byte_class];
+  nodes.insert(nodes.end(), moves.begin(), moves.end());
+  std::sort(nodes.begin(), nodes.end());
+  nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+  size_t flushes = dfa->flushes;
+  int32_t next = Intern(dfa, std::move(nodes), false);
+  // `state` is gone if the cache was flushed to make room.
+  if (flushes == dfa->flushes) {
+    dfa->states[state].next[byte_class] = next;
+  }
+  return next;
+}
+
+std::vector<uint32_t> RegexSet::Closure(Dfa* dfa, std::vector<uint32_t> seeds,
+                                        bool at_start, bool at_end) const {
+  auto& visited = dfa->visited;
+  if (++dfa->stamp == 0) {
+    std::fill(visited.begin(), visited.end(), 0);
+    dfa->stamp = 1;
+  }
+
+  std::vector<uint32_t> nodes, stack = std::move(seeds);
+  while (!stack.empty()) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+    if (visited[node] == dfa->stamp) {
+      continue;
+    }
+    visited[node] = dfa->stamp;
+
+    const NfaNode& nfa_node = nfa_[node];
+    switch (nfa_node.type) {
+      case NfaNode::Type::Epsilon:
+        stack.insert(stack.end(), nfa_node.outs.begin(), nfa_node.outs.end());
+        break;
+      case NfaNode::Type::Begin:
+        if (at_start) {
+          stack.push_back(nfa_node.outs.front());
+        }
+        break;
+      case NfaNode::Type::End:
+        // Kept to be checked when the text ends.
+        if (at_end) {
+          stack.push_back(nfa_node.outs.front());
+        } else {
+          nodes.push_back(node);
+        }
+        break;
+      default:
+        nodes.push_back(node);
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+int32_t RegexSet::Intern(Dfa* dfa, std::vector<uint32_t> nodes,
+                         bool at_start) const {
+  // The restart nodes are in every state.
+  DfaState state;
+  for (uint32_t node : nodes) {
+    if (!in_restart_[node]) {
+      state.nodes.push_back(node);
+    }
+  }
+  // The start state differs from one with the same nodes in that `^` may
+  // follow a `$` when the text is empty.
+  std::vector<uint32_t> key = state.nodes;
+  if (at_start) {
+    key.push_back(UINT32_MAX);
+  }
+  auto it = dfa->index.find(key);
+  if (it != dfa->index.end()) {
+    return it->second;
+  }
+
+  if (dfa->states.size() >= max_dfa_states_) {
+    Flush(dfa);
+  }
+
+  state.next.assign(class_count_, -1);
+  state.accept = state.accept_at_end = false;
+  std::vector<uint32_t> ends;
+  const std::vector<uint32_t>* lists[] = {&nodes, &restart_};
+  for (const auto* list : lists) {
+    for (uint32_t node : *list) {
+      if (nfa_[node].type == NfaNode::Type::Accept) {
+        state.accept = true;
+      } else if (nfa_[node].type == NfaNode::Type::End) {
+        ends.push_back(node);
+      }
+    }
+  }
+  for (uint32_t node : Closure(dfa, std::move(ends), at_start, true)) {
+    state.accept_at_end |= nfa_[node].type == NfaNode::Type::Accept;
+  }
+  // Nothing can match from here on if all expressions are anchored at the
+  // start.
+  state.dead = state.nodes.empty() && restart_.empty();
+
+  dfa->states.push_back(std::move(state));
+  dfa->index.emplace(std::move(key), dfa->states.size() - 1);
+  return dfa->states.size() - 1;
+}
+
+void RegexSet::Flush(Dfa* dfa) {
+  ++dfa->flushes;
+  dfa->states.clear();
+  dfa->index.clear();
+  dfa->start = -1;
+}
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,52 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/rotating_device.h"
+
+namespace nekit {
+namespace utils {
+
+RotatingDevice::RotatingDevice(
+    const std::vector<boost::asio::ip::address>& addresses) {
+  for (const auto& address : addresses) {
+    if (address.is_v4()) {
+      v4_addresses_.push_back(address);
+    } else {
+      v6_addresses_.push_back(address);
+    }
+  }
+}
+
+boost::asio::ip::address RotatingDevice::FindSourceIpToBind(
+    const boost::asio::ip::address& target) {
+  auto& addresses = target.is_v4() ? v4_addresses_ : v6_addresses_;
+  auto& next = target.is_v4() ? v4_next_ : v6_next_;
+
+  if (addresses.empty()) {
+    return boost::asio::ip::address();
+  }
+
+  return addresses[next.fetch_add(1, std::memory_order_relaxed) %
+                   addresses.size()];
+}
+}  // namespace utils
+}  // namespace nekit
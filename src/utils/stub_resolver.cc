@@ -0,0 +1,460 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/stub_resolver.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include <boost/assert.hpp>
+
+#include "nekit/utils/boost_error.h"
+#include "nekit/utils/dns_message.h"
+#include "nekit/utils/dual_stack_query.h"
+#include "nekit/utils/error.h"
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Stub resolver"
+
+namespace nekit {
+namespace utils {
+
+namespace {
+// Without EDNS the UDP response is at most 512 bytes, but be tolerant.
+const size_t kUdpBufferSize = 4096;
+}  // namespace
+
+class StubResolver::Query : public std::enable_shared_from_this<Query> {
+ public:
+  Query(StubResolver* resolver, std::string domain, DnsRecordType type,
+        Cancelable cancelable, TtlEventHandler handler)
+      : resolver_{resolver},
+        domain_{domain},
+        type_{type},
+        cancelable_{cancelable},
+        handler_{handler},
+        udp_socket_{*resolver->io_},
+        tcp_socket_{*resolver->io_},
+        timer_{*resolver->io_},
+        buffer_(kUdpBufferSize) {}
+
+  void Start() { Send(); }
+
+  void Stop() {
+    stopped_ = true;
+    Close();
+  }
+
+ private:
+  const boost::asio::ip::udp::endpoint& server() const {
+    return resolver_->servers_[attempt_ % resolver_->servers_.size()];
+  }
+
+  // Returns `true` if the handler of the caller should do nothing.
+  bool Abandoned(size_t attempt) {
+    if (stopped_ || finished_) {
+      return true;
+    }
+
+    if (cancelable_.canceled()) {
+      Finish(nullptr, std::chrono::seconds(0), NEKitErrorCode::Canceled);
+      return true;
+    }
+
+    return attempt != attempt_;
+  }
+
+  void Send() {
+    if (attempt_ >= resolver_->servers_.size() * resolver_->attempts_) {
+      NEERROR << "Failed to resolve " << domain_ << " due to " << last_error_
+              << ".";
+      return Defer(
+          [this]() { Finish(nullptr, std::chrono::seconds(0), last_error_); });
+    }
+
+    id_ = static_cast<uint16_t>(resolver_->random_());
+    query_.clear();
+    bool encoded = EncodeDnsQuery(id_, domain_, type_, &query_);
+    BOOST_ASSERT(encoded);
+    (void)encoded;
+
+    NEDEBUG << "Sending query of " << domain_ << " to " << server() << ".";
+
+    boost::system::error_code ec;
+    udp_socket_.open(server().protocol(), ec);
+    if (!ec) {
+      // Only accept responses from the server.
+      udp_socket_.connect(server(), ec);
+    }
+    if (ec) {
+      return Defer(
+          [this, error{std::make_error_code(ec)}]() { Retry(error); });
+    }
+
+    StartTimer();
+
+    udp_socket_.async_send(
+        boost::asio::buffer(query_),
+        [this, self{shared_from_this()}, attempt{attempt_}](
+            const boost::system::error_code& ec, size_t) {
+          if (Abandoned(attempt)) {
+            return;
+          }
+
+          if (ec) {
+            Retry(std::make_error_code(ec));
+          }
+        });
+
+    Receive();
+  }
+
+  void Receive() {
+    udp_socket_.async_receive(
+        boost::asio::buffer(buffer_.data(), kUdpBufferSize),
+        [this, self{shared_from_this()}, attempt{attempt_}](
+            const boost::system::error_code& ec, size_t size) {
+          if (Abandoned(attempt)) {
+            return;
+          }
+
+          // An ICMP port unreachable is reported as connection refused.
+          if (ec) {
+            return Retry(std::make_error_code(ec));
+          }
+
+          Handle(size, false);
+        });
+  }
+
+  void SendTcp() {
+    NEDEBUG << "Response of " << domain_ << " is truncated, retry over TCP.";
+
+    boost::system::error_code ec;
+    udp_socket_.close(ec);
+
+    StartTimer();
+
+    tcp_socket_.async_connect(
+        boost::asio::ip::tcp::endpoint(server().address(), server().port()),
+        [this, self{shared_from_this()},
+         attempt{attempt_}](const boost::system::error_code& ec) {
+          if (Abandoned(attempt)) {
+            return;
+          }
+
+          if (ec) {
+            return Retry(std::make_error_code(ec));
+          }
+
+          length_[0] = static_cast<uint8_t>(query_.size() >> 8);
+          length_[1] = static_cast<uint8_t>(query_.size());
+          std::array<boost::asio::const_buffer, 2> buffers{
+              {boost::asio::buffer(length_), boost::asio::buffer(query_)}};
+
+          boost::asio::async_write(
+              tcp_socket_, buffers,
+              [this, self, attempt](const boost::system::error_code& ec,
+                                    size_t) {
+                if (Abandoned(attempt)) {
+                  return;
+                }
+
+                if (ec) {
+                  return Retry(std::make_error_code(ec));
+                }
+
+                ReadTcp();
+              });
+        });
+  }
+
+  void ReadTcp() {
+    boost::asio::async_read(
+        tcp_socket_, boost::asio::buffer(length_),
+        [this, self{shared_from_this()}, attempt{attempt_}](
+            const boost::system::error_code& ec, size_t) {
+          if (Abandoned(attempt)) {
+            return;
+          }
+
+          if (ec) {
+            return Retry(std::make_error_code(ec));
+          }
+
+          size_t size = length_[0] << 8 | length_[1];
+          if (size > buffer_.size()) {
+            buffer_.resize(size);
+          }
+
+          boost::asio::async_read(
+              tcp_socket_, boost::asio::buffer(buffer_.data(), size),
+              [this, self, attempt](const boost::system::error_code& ec,
+                                    size_t size) {
+                if (Abandoned(attempt)) {
+                  return;
+                }
+
+                if (ec) {
+                  return Retry(std::make_error_code(ec));
+                }
+
+                Handle(size, true);
+              });
+        });
+  }
+
+  void Handle(size_t size, bool tcp) {
+    if (!ParseDnsResponse(buffer_.data(), size, domain_, type_, &response_) ||
+        response_.id != id_) {
+      if (tcp) {
+        return Retry(ErrorCode::InvalidResponse);
+      }
+
+      // Could be a late response of a previous query, keep waiting.
+      NEDEBUG << "Ignored unexpected response for " << domain_ << ".";
+      return Receive();
+    }
+
+    if (response_.truncated) {
+      if (tcp) {
+        return Retry(ErrorCode::InvalidResponse);
+      }
+      return SendTcp();
+    }
+
+    switch (response_.code) {
+      case DnsResponseCode::NoError:
+        break;
+      case DnsResponseCode::NameError:
+        NEDEBUG << "Domain " << domain_ << " does not exist.";
+        return Finish(nullptr, std::chrono::seconds(0), ErrorCode::NameError);
+      case DnsResponseCode::Refused:
+        return Retry(ErrorCode::Refused);
+      default:
+        return Retry(ErrorCode::ServerFailure);
+    }
+
+    if (response_.records.empty()) {
+      return Finish(nullptr, std::chrono::seconds(0), ErrorCode::NoData);
+    }
+
+    auto addresses = std::make_shared<std::vector<boost::asio::ip::address>>();
+    addresses->reserve(response_.records.size());
+    uint32_t ttl = std::numeric_limits<uint32_t>::max();
+    for (const auto& record : response_.records) {
+      addresses->push_back(record.address);
+      ttl = std::min(ttl, record.ttl);
+    }
+
+    NEINFO << "Successfully resolved domain " << domain_ << ".";
+
+    Finish(addresses, std::chrono::seconds(ttl), NEKitErrorCode::NoError);
+  }
+
+  void StartTimer() {
+    timer_.expires_after(resolver_->timeout_);
+    timer_.async_wait([this, self{shared_from_this()}, attempt{attempt_}](
+                          const boost::system::error_code& ec) {
+      if (ec || Abandoned(attempt)) {
+        return;
+      }
+
+      NEDEBUG << "Query of " << domain_ << " to " << server() << " timed out.";
+      Retry(ErrorCode::TimedOut);
+    });
+  }
+
+  // `Send` may be called from `Start`, a failure that happens before anything
+  // is sent must not call the handler before `ResolveWithTtl` returns.
+  template <typename Function>
+  void Defer(Function function) {
+    boost::asio::post(*resolver_->io_, [this, self{shared_from_this()},
+                                        attempt{attempt_}, function]() {
+      if (Abandoned(attempt)) {
+        return;
+      }
+
+      function();
+    });
+  }
+
+  void Retry(std::error_code ec) {
+    last_error_ = ec;
+    attempt_++;
+    Close();
+    Send();
+  }
+
+  void Close() {
+    boost::system::error_code ec;
+    udp_socket_.close(ec);
+    tcp_socket_.close(ec);
+    timer_.cancel();
+  }
+
+  void Finish(std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+              std::chrono::seconds ttl, std::error_code ec) {
+    finished_ = true;
+    Close();
+
+    // Keep alive until the handler returns.
+    auto self = shared_from_this();
+    resolver_->queries_.erase(this);
+
+    if (!cancelable_.canceled()) {
+      handler_(addresses, ttl, ec);
+    }
+  }
+
+  StubResolver* resolver_;
+  std::string domain_;
+  DnsRecordType type_;
+  Cancelable cancelable_;
+  TtlEventHandler handler_;
+
+  boost::asio::ip::udp::socket udp_socket_;
+  boost::asio::ip::tcp::socket tcp_socket_;
+  boost::asio::steady_timer timer_;
+
+  uint16_t id_{0};
+  size_t attempt_{0};
+  std::error_code last_error_{ErrorCode::TimedOut};
+  std::vector<uint8_t> query_, buffer_;
+  std::array<uint8_t, 2> length_;
+  DnsResponse response_;
+  bool stopped_{false}, finished_{false};
+};
+
+StubResolver::StubResolver(boost::asio::io_context* io,
+                           std::vector<boost::asio::ip::udp::endpoint> servers)
+    : io_{io}, servers_{servers}, random_{std::random_device{}()} {}
+
+StubResolver::~StubResolver() { Stop(); }
+
+Cancelable StubResolver::Resolve(std::string domain,
+                                 AddressPreference preference,
+                                 EventHandler handler) {
+  return ResolveWithTtl(
+      domain, preference,
+      [handler](
+          std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+          std::chrono::seconds ttl, std::error_code ec) {
+        (void)ttl;
+        handler(addresses, ec);
+      });
+}
+
+Cancelable StubResolver::ResolveWithTtl(std::string domain,
+                                        AddressPreference preference,
+                                        TtlEventHandler handler) {
+  NETRACE << "Start resolving " << domain << ".";
+
+  Cancelable cancelable{};
+
+  if (stopped_) {
+    Fail(NEKitErrorCode::Canceled, cancelable, handler);
+    return cancelable;
+  }
+
+  std::vector<uint8_t> buffer;
+  if (!EncodeDnsQuery(0, domain, DnsRecordType::A, &buffer)) {
+    NEERROR << "Can not resolve invalid domain " << domain << ".";
+    Fail(ErrorCode::InvalidName, cancelable, handler);
+    return cancelable;
+  }
+
+  return DualStackQuery::Start(
+      io_, preference, dual_stack_grace_,
+      [this, domain](bool v6, TtlEventHandler handler) {
+        Cancelable cancelable{};
+        auto query = std::make_shared<Query>(
+            this, domain, v6 ? DnsRecordType::AAAA : DnsRecordType::A,
+            cancelable, handler);
+        queries_.emplace(query.get(), query);
+        query->Start();
+        return cancelable;
+      },
+      handler);
+}
+
+void StubResolver::Stop() {
+  stopped_ = true;
+
+  for (auto& pair : queries_) {
+    pair.second->Stop();
+  }
+  queries_.clear();
+}
+
+void StubResolver::Reset() { stopped_ = false; }
+
+boost::asio::io_context* StubResolver::io() { return io_; }
+
+void StubResolver::Fail(std::error_code ec, Cancelable cancelable,
+                        TtlEventHandler handler) {
+  boost::asio::post(*io_, [ec, cancelable, handler,
+                           life_time{life_time_cancelable()}]() {
+    if (cancelable.canceled() || life_time.canceled()) {
+      return;
+    }
+
+    handler(nullptr, std::chrono::seconds(0), ec);
+  });
+}
+
+namespace {
+struct StubResolverErrorCategory : std::error_category {
+  const char* name() const noexcept override { return "Stub resolver"; }
+
+  std::string message(int ev) const override {
+    switch (static_cast<StubResolver::ErrorCode>(ev)) {
+      case StubResolver::ErrorCode::NoError:
+        return "no error";
+      case StubResolver::ErrorCode::NameError:
+        return "domain does not exist";
+      case StubResolver::ErrorCode::NoData:
+        return "no address record";
+      case StubResolver::ErrorCode::ServerFailure:
+        return "server failure";
+      case StubResolver::ErrorCode::Refused:
+        return "query refused";
+      case StubResolver::ErrorCode::InvalidName:
+        return "invalid domain";
+      case StubResolver::ErrorCode::InvalidResponse:
+        return "invalid response";
+      case StubResolver::ErrorCode::TimedOut:
+        return "timeout";
+    }
+  }
+};
+
+const StubResolverErrorCategory stubResolverErrorCategory{};
+}  // namespace
+
+std::error_code make_error_code(StubResolver::ErrorCode ec) {
+  return {static_cast<int>(ec), stubResolverErrorCategory};
+}
+}  // namespace utils
+}  // namespace nekit
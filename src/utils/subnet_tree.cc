@@ -0,0 +1,296 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/subnet_tree.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/assert.hpp>
+
+namespace nekit {
+namespace utils {
+
+namespace {
+// Precedes the nodes in a saved tree.
+struct SavedHeader {
+  uint64_t size;
+  uint64_t node_count;
+};
+}  // namespace
+
+SubnetTree::SubnetTree() {
+  NewNode({0, 0}, 0, true);
+  NewNode({0, 0}, 0, false);
+}
+
+void SubnetTree::Insert(const boost::asio::ip::address& address,
+                        unsigned prefix, uint32_t value) {
+  bool v4 = address.is_v4();
+  BOOST_ASSERT(prefix <= (v4 ? 32u : 128u));
+
+  Key key = Mask(MakeKey(address), prefix);
+  auto& nodes = nodes_.Mutable();
+  uint32_t index = v4 ? kV4Root : kV6Root;
+  while (true) {
+    if (nodes[index].prefix == prefix) {
+      Node& node = nodes[index];
+      if (!node.has_value) {
+        node.has_value = true;
+        node.value = value;
+        size_++;
+        AddToFilter(key, prefix, v4);
+      } else {
+        node.value = std::min(node.value, value);
+      }
+      return;
+    }
+
+    unsigned bit = Bit(key, nodes[index].prefix);
+    uint32_t child = nodes[index].children[bit];
+    if (!child) {
+      // `NewNode` may reallocate `nodes`.
+      uint32_t leaf = NewNode(key, prefix, v4);
+      nodes[index].children[bit] = leaf;
+      nodes[leaf].has_value = true;
+      nodes[leaf].value = value;
+      size_++;
+      AddToFilter(key, prefix, v4);
+      return;
+    }
+
+    unsigned common =
+        CommonPrefix(key, nodes[child].key,
+                     std::min<unsigned>(prefix, nodes[child].prefix));
+    if (common == nodes[child].prefix) {
+      index = child;
+      continue;
+    }
+
+    // Split the edge to `child` at the first differing bit.
+    uint32_t branch = NewNode(Mask(key, common), common, v4);
+    nodes[branch].children[Bit(nodes[child].key, common)] = child;
+    nodes[index].children[bit] = branch;
+    index = branch;
+  }
+}
+
+bool SubnetTree::Contains(const boost::asio::ip::address& address) const {
+  bool found = false;
+  ForEachMatch(address, [&found](unsigned, uint32_t) { found = true; });
+  return found;
+}
+
+bool SubnetTree::LongestMatch(const boost::asio::ip::address& address,
+                              uint32_t* value) const {
+  bool found = false;
+  ForEachMatch(address, [&found, value](unsigned, uint32_t match) {
+    found = true;
+    *value = match;
+  });
+  return found;
+}
+
+void SubnetTree::BuildFilter(double bits_per_key) {
+  filter_ = BloomFilter(size_, bits_per_key);
+  lengths_[0].clear();
+  lengths_[1].clear();
+  for (const auto& node : nodes_) {
+    if (node.has_value) {
+      AddToFilter(node.key, node.prefix, node.v4);
+    }
+  }
+}
+
+void SubnetTree::AddToFilter(const Key& key, unsigned prefix, bool v4) {
+  if (filter_.empty()) {
+    return;
+  }
+
+  filter_.Insert(FilterHash(key, prefix, v4));
+  auto& lengths = lengths_[!v4];
+  auto iter = std::lower_bound(lengths.begin(), lengths.end(), prefix);
+  if (iter == lengths.end() || *iter != prefix) {
+    lengths.insert(iter, static_cast<uint8_t>(prefix));
+  }
+}
+
+bool SubnetTree::MayMatch(const Key& key, bool v4) const {
+  if (filter_.empty()) {
+    return true;
+  }
+
+  for (unsigned prefix : lengths_[!v4]) {
+    if (filter_.MayContain(FilterHash(Mask(key, prefix), prefix, v4))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t SubnetTree::FilterHash(const Key& key, unsigned prefix, bool v4) {
+  uint64_t hash = key.high * 0x9e3779b97f4a7c15ULL;
+  hash ^= (key.low + prefix + (v4 ? 0x100 : 0)) * 0xc2b2ae3d27d4eb4fULL;
+  return hash ^ (hash >> 29);
+}
+
+SubnetTree::Key SubnetTree::MakeKey(const boost::asio::ip::address& address) {
+  Key key{0, 0};
+  if (address.is_v4()) {
+    key.high = uint64_t(address.to_v4().to_ulong()) << 32;
+  } else {
+    auto bytes = address.to_v6().to_bytes();
+    for (size_t i = 0; i < 8; i++) {
+      key.high = key.high << 8 | bytes[i];
+      key.low = key.low << 8 | bytes[i + 8];
+    }
+  }
+  return key;
+}
+
+boost::asio::ip::address SubnetTree::MakeAddress(const Key& key, bool v4) {
+  if (v4) {
+    return boost::asio::ip::address_v4(uint32_t(key.high >> 32));
+  }
+
+  boost::asio::ip::address_v6::bytes_type bytes;
+  for (size_t i = 0; i < 8; i++) {
+    bytes[i] = uint8_t(key.high >> (56 - 8 * i));
+    bytes[i + 8] = uint8_t(key.low >> (56 - 8 * i));
+  }
+  return boost::asio::ip::address_v6(bytes);
+}
+
+SubnetTree::Key SubnetTree::Mask(const Key& key, unsigned prefix) {
+  if (prefix == 0) {
+    return {0, 0};
+  }
+  if (prefix < 64) {
+    return {key.high & ~(~uint64_t(0) >> prefix), 0};
+  }
+  if (prefix == 64) {
+    return {key.high, 0};
+  }
+  if (prefix < 128) {
+    return {key.high, key.low & ~(~uint64_t(0) >> (prefix - 64))};
+  }
+  return key;
+}
+
+unsigned SubnetTree::CommonPrefix(const Key& lhs, const Key& rhs,
+                                  unsigned limit) {
+  unsigned common;
+  uint64_t diff = lhs.high ^ rhs.high;
+  if (diff) {
+    common = __builtin_clzll(diff);
+  } else {
+    diff = lhs.low ^ rhs.low;
+    common = diff ? 64 + __builtin_clzll(diff) : 128;
+  }
+  return std::min(common, limit);
+}
+
+uint32_t SubnetTree::NewNode(const Key& key, unsigned prefix, bool v4) {
+  Node node;
+  node.key = key;
+  node.children[0] = node.children[1] = 0;
+  node.value = 0;
+  node.prefix = uint8_t(prefix);
+  node.has_value = false;
+  node.v4 = v4;
+  auto& nodes = nodes_.Mutable();
+  nodes.push_back(node);
+  return uint32_t(nodes.size() - 1);
+}
+
+void SubnetTree::Save(std::string* out) const {
+  SavedHeader header{size_, nodes_.size()};
+  out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const auto& node : nodes_) {
+    // Written field by field so the padding is zero.
+    Node saved;
+    std::memset(&saved, 0, sizeof(saved));
+    saved.key = node.key;
+    saved.children[0] = node.children[0];
+    saved.children[1] = node.children[1];
+    saved.value = node.value;
+    saved.prefix = node.prefix;
+    saved.has_value = node.has_value;
+    saved.v4 = node.v4;
+    out->append(reinterpret_cast<const char*>(&saved), sizeof(saved));
+  }
+}
+
+bool SubnetTree::Map(const void* data, size_t size,
+                     std::shared_ptr<const void> owner) {
+  if (size < sizeof(SavedHeader) ||
+      reinterpret_cast<uintptr_t>(data) % alignof(Node)) {
+    return false;
+  }
+
+  SavedHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  size_t count = size_t(header.node_count);
+  if (count < 2 || count > (size - sizeof(SavedHeader)) / sizeof(Node) ||
+      size != sizeof(SavedHeader) + count * sizeof(Node)) {
+    return false;
+  }
+
+  const Node* nodes = reinterpret_cast<const Node*>(
+      static_cast<const char*>(data) + sizeof(SavedHeader));
+  for (size_t i = 0; i < count; i++) {
+    if (nodes[i].has_value > 1 || nodes[i].v4 > 1) {
+      return false;
+    }
+  }
+  if (nodes[kV4Root].prefix || !nodes[kV4Root].v4 || nodes[kV6Root].prefix ||
+      nodes[kV6Root].v4) {
+    return false;
+  }
+  size_t values = 0;
+  for (size_t i = 0; i < count; i++) {
+    const Node& node = nodes[i];
+    if (node.prefix > (node.v4 ? 32 : 128)) {
+      return false;
+    }
+    // A child is longer than its parent, so a walk always ends.
+    for (uint32_t child : node.children) {
+      if (child && (child >= count || nodes[child].v4 != node.v4 ||
+                    nodes[child].prefix <= node.prefix)) {
+        return false;
+      }
+    }
+    values += node.has_value;
+  }
+  if (values != header.size) {
+    return false;
+  }
+
+  nodes_.Map(nodes, count, std::move(owner));
+  size_ = values;
+  filter_ = BloomFilter();
+  lengths_[0].clear();
+  lengths_[1].clear();
+  return true;
+}
+}  // namespace utils
+}  // namespace nekit
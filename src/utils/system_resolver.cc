@@ -22,7 +22,10 @@
 
 #include "nekit/utils/system_resolver.h"
 
+#include <algorithm>
+
 #include "nekit/utils/boost_error.h"
+#include "nekit/utils/dual_stack_query.h"
 #include "nekit/utils/error.h"
 #include "nekit/utils/log.h"
 
@@ -32,103 +35,365 @@
 namespace nekit {
 namespace utils {
 
+struct SystemResolver::Job {
+  uint64_t id;
+  std::string domain;
+  bool v6;
+  Priority priority;
+  Clock::time_point enqueued_at;
+  Clock::time_point deadline;
+
+  // Only accessed on `main_io_`. Canceling `cancelable` removes the job from
+  // the queue, so worker threads never see canceled jobs.
+  Cancelable cancelable;
+  EventHandler handler;
+  std::unique_ptr<boost::asio::steady_timer> timer;
+};
+
+namespace {
+std::chrono::microseconds Elapsed(std::chrono::steady_clock::time_point from,
+                                  std::chrono::steady_clock::time_point to) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+}
+}  // namespace
+
 SystemResolver::SystemResolver(boost::asio::io_context* io, size_t thread_count)
-    : main_io_{io}, thread_count_{thread_count} {
+    : SystemResolver(io, thread_count, thread_count) {}
+
+SystemResolver::SystemResolver(boost::asio::io_context* io, size_t min_threads,
+                               size_t max_threads)
+    : main_io_{io},
+      min_threads_{min_threads},
+      max_threads_{std::max<size_t>(max_threads, 1)} {
+  BOOST_ASSERT(min_threads_ <= max_threads_);
   Reset();
 }
 
+SystemResolver::~SystemResolver() { Stop(); }
+
+void SystemResolver::set_queue_limit(size_t limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_limit_ = limit;
+}
+
+void SystemResolver::set_idle_timeout(std::chrono::milliseconds timeout) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_timeout_ = timeout;
+}
+
 Cancelable SystemResolver::Resolve(std::string domain,
                                    AddressPreference preference,
                                    EventHandler handler) {
-  // Preference is ignored. Let the OS do the choice as of now.
-  (void)preference;
+  return ResolveWithPriority(domain, preference, Priority::Normal, handler);
+}
 
+Cancelable SystemResolver::ResolveWithPriority(std::string domain,
+                                               AddressPreference preference,
+                                               Priority priority,
+                                               EventHandler handler) {
   NETRACE << "Start resolving " << domain << ".";
 
-  Cancelable cancelable{};
-
-  boost::asio::post(
-      *resolve_io_.get(), [this, domain, handler, cancelable,
-                           lifetime{life_time_cancelable()}]() mutable {
-        // Note it should be guaranteed that one io_context should never be
-        // released before all the instances implementing `AsyncIoInterface`
-        // which will return that io_context are released. This resolver will
-        // never be released before `main_io_` is released. In the destructor
-        // this thread is guaranteed to exit before resolver is finished, so
-        // there is no need to worry any thread issues here. Resolver and
-        // `main_io_` will exist when this thread is running.
-
-        if (cancelable.canceled() || lifetime.canceled()) {
+  // Canceling `query` drops the queued lookups of both families.
+  auto lookups = std::make_shared<std::vector<Cancelable>>();
+  Cancelable query{[lookups]() {
+    for (auto& lookup : *lookups) {
+      lookup.Cancel();
+    }
+  }};
+  (void)DualStackQuery::Start(
+      main_io_, preference,
+      std::chrono::milliseconds(NEKIT_DNS_DUAL_STACK_GRACE),
+      [this, domain, priority, lookups](bool v6, TtlEventHandler handler) {
+        lookups->push_back(Lookup(
+            domain, v6, priority,
+            [handler](Addresses addresses, std::error_code ec) {
+              handler(addresses, kUnknownTtl, ec);
+            }));
+        return lookups->back();
+      },
+      [handler, query](Addresses addresses, std::chrono::seconds ttl,
+                       std::error_code ec) {
+        (void)ttl;
+        if (query.canceled()) {
           return;
         }
+        handler(addresses, ec);
+      });
+  return query;
+}
 
-        auto resolver = boost::asio::ip::tcp::resolver(*resolve_io_.get());
+Cancelable SystemResolver::Lookup(std::string domain, bool v6,
+                                  Priority priority, EventHandler handler) {
+  auto job = std::make_shared<Job>();
+  job->id = next_job_id_++;
+  job->domain = domain;
+  job->v6 = v6;
+  job->priority = priority;
+  job->enqueued_at = Clock::now();
+  job->deadline = job->enqueued_at + timeout_;
+  job->cancelable = Cancelable{[this, weak_job{std::weak_ptr<Job>(job)},
+                                lifetime{life_time_cancelable()}]() {
+    auto job = weak_job.lock();
+    if (job && !lifetime.canceled()) {
+      Cancel(job);
+    }
+  }};
+  job->handler = handler;
+  job->timer = std::make_unique<boost::asio::steady_timer>(*main_io_);
+  jobs_.emplace(job->id, job);
+
+  job->timer->expires_at(job->deadline);
+  job->timer->async_wait([this, job, lifetime{life_time_cancelable()}](
+                             const boost::system::error_code& ec) {
+    if (ec || lifetime.canceled() || !jobs_.count(job->id)) {
+      return;
+    }
 
-        NEDEBUG << "Trying to resolve " << domain << ".";
+    bool queued;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued = Remove(job);
+      statistics_.timed_out++;
+    }
+    NEDEBUG << "Resolving " << job->domain << " timed out"
+            << (queued ? " in queue." : ".");
+    Finish(job, nullptr, ErrorCode::TimedOut);
+  });
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t depth = 0;
+    for (const auto& queue : queues_) {
+      depth += queue.size();
+    }
+    if (depth >= queue_limit_) {
+      statistics_.rejected++;
+      NEWARN << "Too many pending lookups, failed to resolve " << domain
+             << ".";
+      Post(job, nullptr, ErrorCode::QueueFull);
+      return job->cancelable;
+    }
 
-        boost::system::error_code ec;
-        auto result = resolver.resolve(domain, "", ec);
+    queues_[static_cast<size_t>(priority)].push_back(job);
+    statistics_.max_queue_depth =
+        std::max(statistics_.max_queue_depth, depth + 1);
 
-        if (ec) {
-          auto error = ConvertBoostError(ec);
-          NEERROR << "Failed to resolve " << domain << " due to " << error
-                  << ".";
+    if (!idle_threads_ && threads_.size() - exited_.size() < max_threads_ &&
+        !stopping_) {
+      Spawn();
+    }
+  }
+  condition_.notify_one();
 
-          boost::asio::post(*main_io_, [handler, error, cancelable,
-                                        life_time{life_time_cancelable()}]() {
-            if (cancelable.canceled() || life_time.canceled()) {
-              return;
-            }
+  return job->cancelable;
+}
 
-            handler(nullptr, error);
-          });
-          return;
-        }
+void SystemResolver::Spawn() {
+  ReapExited();
+
+  NEDEBUG << "Starting resolver thread " << threads_.size() + 1 << ".";
+  // Counted as idle until it picks its first job, so a burst of lookups does
+  // not start more threads than needed.
+  idle_threads_++;
+  std::thread thread([this]() { Work(); });
+  auto id = thread.get_id();
+  threads_.emplace(id, std::move(thread));
+}
 
-        auto addresses =
-            std::make_shared<std::vector<boost::asio::ip::address>>();
+void SystemResolver::ReapExited() {
+  for (auto id : exited_) {
+    auto iter = threads_.find(id);
+    iter->second.join();
+    threads_.erase(iter);
+  }
+  exited_.clear();
+}
 
-        for (auto iter = result.begin(); iter != result.end(); iter++) {
-          addresses->emplace_back(iter->endpoint().address());
+std::shared_ptr<SystemResolver::Job> SystemResolver::Pop() {
+  for (auto& queue : queues_) {
+    if (!queue.empty()) {
+      auto job = queue.front();
+      queue.pop_front();
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+bool SystemResolver::Remove(const std::shared_ptr<Job>& job) {
+  auto& queue = queues_[static_cast<size_t>(job->priority)];
+  auto iter = std::find(queue.begin(), queue.end(), job);
+  if (iter == queue.end()) {
+    return false;
+  }
+  queue.erase(iter);
+  return true;
+}
+
+void SystemResolver::Cancel(const std::shared_ptr<Job>& job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Remove(job)) {
+      statistics_.canceled++;
+    }
+  }
+
+  // A running lookup is left to finish, its result is dropped.
+  Finish(job, nullptr, NEKitErrorCode::Canceled);
+}
+
+void SystemResolver::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!stopping_) {
+    auto job = Pop();
+    if (!job) {
+      if (condition_.wait_for(lock, idle_timeout_) !=
+          std::cv_status::timeout) {
+        continue;
+      }
+
+      // A lookup queued while this thread was waiting for the lock counted on
+      // it being idle and did not start another thread.
+      job = Pop();
+      if (!job) {
+        if (threads_.size() - exited_.size() > min_threads_) {
+          break;
         }
+        continue;
+      }
+    }
 
-        NEINFO << "Successfully resolved domain " << domain << ".";
+    idle_threads_--;
+    auto now = Clock::now();
+    if (now >= job->deadline) {
+      // The timer on `main_io_` reports the timeout.
+      idle_threads_++;
+      continue;
+    }
 
-        boost::asio::post(*main_io_, [handler, addresses, cancelable,
-                                      life_time{life_time_cancelable()}]() {
-          if (cancelable.canceled() || life_time.canceled()) {
-            return;
-          }
+    auto wait = Elapsed(job->enqueued_at, now);
+    statistics_.total_wait += wait;
+    statistics_.max_wait = std::max(statistics_.max_wait, wait);
+
+    lock.unlock();
+    Addresses addresses;
+    std::error_code ec = Run(*job, &addresses);
+    lock.lock();
+
+    auto resolve = Elapsed(now, Clock::now());
+    statistics_.completed++;
+    statistics_.total_resolve += resolve;
+    statistics_.max_resolve = std::max(statistics_.max_resolve, resolve);
+    idle_threads_++;
+    Post(job, addresses, ec);
+  }
 
-          handler(addresses, NEKitErrorCode::NoError);
-        });
-      });
+  idle_threads_--;
+  exited_.push_back(std::this_thread::get_id());
+}
+
+std::error_code SystemResolver::Run(const Job& job, Addresses* addresses) {
+  boost::asio::io_context io;
+  boost::asio::ip::tcp::resolver resolver(io);
+
+  NEDEBUG << "Trying to resolve " << (job.v6 ? "AAAA" : "A")
+          << " records of " << job.domain << ".";
+
+  boost::system::error_code ec;
+  auto result = resolver.resolve(
+      job.v6 ? boost::asio::ip::tcp::v6() : boost::asio::ip::tcp::v4(),
+      job.domain, "", ec);
+
+  if (ec) {
+    auto error = ConvertBoostError(ec);
+    NEERROR << "Failed to resolve " << job.domain << " due to " << error
+            << ".";
+    return error;
+  }
+
+  *addresses = std::make_shared<std::vector<boost::asio::ip::address>>();
+  for (auto iter = result.begin(); iter != result.end(); iter++) {
+    (*addresses)->emplace_back(iter->endpoint().address());
+  }
+
+  NEINFO << "Successfully resolved domain " << job.domain << ".";
+  return NEKitErrorCode::NoError;
+}
+
+void SystemResolver::Post(std::shared_ptr<Job> job, Addresses addresses,
+                          std::error_code ec) {
+  // Note it should be guaranteed that one io_context should never be released
+  // before all the instances implementing `AsyncIoInterface` which will return
+  // that io_context are released. The resolver threads are joined before the
+  // resolver is released, so `main_io_` exists when this is called.
+  boost::asio::post(*main_io_, [this, job, addresses, ec,
+                                lifetime{life_time_cancelable()}]() {
+    if (lifetime.canceled()) {
+      return;
+    }
+    Finish(job, addresses, ec);
+  });
+}
+
+void SystemResolver::Finish(const std::shared_ptr<Job>& job,
+                            Addresses addresses, std::error_code ec) {
+  if (!jobs_.erase(job->id)) {
+    return;
+  }
 
-  return cancelable;
+  job->timer->cancel();
+  if (job->cancelable.canceled()) {
+    return;
+  }
+  job->handler(addresses, ec);
 }
 
 void SystemResolver::Stop() {
-  work_guard_.reset();
-  thread_group_.join_all();
-  resolve_io_.reset();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    for (auto& queue : queues_) {
+      queue.clear();
+    }
+  }
+  condition_.notify_all();
+
+  for (auto& pair : threads_) {
+    pair.second.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  threads_.clear();
+  exited_.clear();
+
+  for (auto& pair : jobs_) {
+    pair.second->timer->cancel();
+  }
+  jobs_.clear();
 }
 
 void SystemResolver::Reset() {
   NEDEBUG << "Resetting system resolver";
 
-  resolve_io_ = std::make_unique<boost::asio::io_context>();
-
-  work_guard_ = std::make_unique<
-      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(
-      boost::asio::make_work_guard(*resolve_io_));
-
-  for (size_t i = 0; i < thread_count_; i++) {
-    thread_group_.create_thread(
-        boost::bind(&boost::asio::io_context::run, resolve_io_.get()));
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = false;
+  while (threads_.size() < min_threads_) {
+    Spawn();
   }
 }
 
-SystemResolver::~SystemResolver() { thread_group_.join_all(); }
+SystemResolver::Statistics SystemResolver::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Statistics statistics = statistics_;
+  statistics.queue_depth = 0;
+  for (const auto& queue : queues_) {
+    statistics.queue_depth += queue.size();
+  }
+  statistics.threads = threads_.size() - exited_.size();
+  statistics.busy_threads = statistics.threads - idle_threads_;
+  return statistics;
+}
 
 std::error_code SystemResolver::ConvertBoostError(
     const boost::system::error_code& ec) {
@@ -142,5 +407,28 @@ std::error_code SystemResolver::ConvertBoostError(
 }
 
 boost::asio::io_context* SystemResolver::io() { return main_io_; }
+
+namespace {
+struct SystemResolverErrorCategory : std::error_category {
+  const char* name() const noexcept override { return "System resolver"; }
+
+  std::string message(int ev) const override {
+    switch (static_cast<SystemResolver::ErrorCode>(ev)) {
+      case SystemResolver::ErrorCode::NoError:
+        return "no error";
+      case SystemResolver::ErrorCode::QueueFull:
+        return "too many pending lookups";
+      case SystemResolver::ErrorCode::TimedOut:
+        return "timed out";
+    }
+  }
+};
+
+const SystemResolverErrorCategory systemResolverErrorCategory{};
+}  // namespace
+
+std::error_code make_error_code(SystemResolver::ErrorCode ec) {
+  return {static_cast<int>(ec), systemResolverErrorCategory};
+}
 }  // namespace utils
 }  // namespace nekit
@@ -0,0 +1,396 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "nekit/utils/warm_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <boost/assert.hpp>
+
+#include "nekit/utils/file.h"
+#include "nekit/utils/log.h"
+
+#undef NECHANNEL
+#define NECHANNEL "Warm Snapshot"
+
+namespace nekit {
+namespace utils {
+
+namespace {
+const char kMagic[8] = {'N', 'E', 'K', 'I', 'T', 'W', 'S', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrder = 0x01020304;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  int64_t created_at;
+  uint64_t decision_tag;
+  uint32_t dns_count;
+  uint32_t decision_count;
+  uint32_t address_count;
+  uint32_t reserved;
+  uint64_t dns_offset;
+  uint64_t decision_offset;
+  uint64_t address_offset;
+  uint64_t string_offset;
+  uint64_t string_size;
+};
+
+struct DnsRecord {
+  uint32_t key_offset;
+  uint32_t key_length;
+  // Seconds since the epoch.
+  int64_t expire_at;
+  uint32_t ttl;
+  uint32_t address_index;
+  uint32_t address_count;
+  uint32_t reserved;
+};
+
+struct DecisionRecord {
+  uint32_t key_offset;
+  uint32_t key_length;
+  uint32_t value;
+  uint32_t reserved;
+};
+
+struct AddressRecord {
+  uint8_t family;
+  uint8_t reserved[3];
+  uint8_t bytes[16];
+};
+
+const uint8_t kFamilyV4 = 4;
+const uint8_t kFamilyV6 = 6;
+
+int64_t WallNow() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+bool InBounds(uint64_t offset, uint64_t count, uint64_t size,
+              uint64_t total) {
+  return offset <= total && count <= (total - offset) / size;
+}
+
+template <typename Record>
+void Append(std::string* buffer, const Record& record) {
+  buffer->append(reinterpret_cast<const char*>(&record), sizeof(Record));
+}
+
+class StringTable {
+ public:
+  uint32_t Add(const std::string& value) {
+    uint32_t offset = uint32_t(data_.size());
+    data_.append(value);
+    return offset;
+  }
+
+  const std::string& data() const { return data_; }
+
+ private:
+  std::string data_;
+};
+}  // namespace
+
+WarmSnapshot::WarmSnapshot(const uint8_t* data, size_t size)
+    : data_{data}, size_{size} {}
+
+WarmSnapshot::~WarmSnapshot() {
+  munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+std::error_code WarmSnapshot::Write(const std::string& path,
+                                    const DnsCache& cache,
+                                    const Decisions& decisions,
+                                    uint64_t decision_tag) {
+  auto clock_now = DnsCache::Clock::now();
+  int64_t wall_now = WallNow();
+
+  std::vector<std::pair<const std::string*, const DnsCache::Entry*>> entries;
+  cache.Walk([&](const std::string& key, const DnsCache::Entry& entry) {
+    if (entry.addresses && !entry.addresses->empty() &&
+        entry.expire_at > clock_now) {
+      entries.emplace_back(&key, &entry);
+    }
+  });
+  std::sort(entries.begin(), entries.end(),
+            [](const decltype(entries)::value_type& lhs,
+               const decltype(entries)::value_type& rhs) {
+              return *lhs.first < *rhs.first;
+            });
+
+  std::vector<const std::pair<std::string, uint32_t>*> sorted_decisions;
+  sorted_decisions.reserve(decisions.size());
+  for (const auto& decision : decisions) {
+    sorted_decisions.push_back(&decision);
+  }
+  std::sort(sorted_decisions.begin(), sorted_decisions.end(),
+            [](const std::pair<std::string, uint32_t>* lhs,
+               const std::pair<std::string, uint32_t>* rhs) {
+              return lhs->first < rhs->first;
+            });
+  sorted_decisions.erase(
+      std::unique(sorted_decisions.begin(), sorted_decisions.end(),
+                  [](const std::pair<std::string, uint32_t>* lhs,
+                     const std::pair<std::string, uint32_t>* rhs) {
+                    return lhs->first == rhs->first;
+                  }),
+      sorted_decisions.end());
+
+  StringTable strings;
+  std::string dns_section, decision_section, address_section;
+  uint32_t address_count = 0;
+  for (const auto& pair : entries) {
+    DnsRecord record{};
+    record.key_offset = strings.Add(*pair.first);
+    record.key_length = uint32_t(pair.first->size());
+    record.expire_at =
+        wall_now + std::chrono::duration_cast<std::chrono::seconds>(
+                       pair.second->expire_at - clock_now)
+                       .count();
+    record.ttl = uint32_t(pair.second->ttl.count());
+    record.address_index = address_count;
+    for (const auto& address : *pair.second->addresses) {
+      AddressRecord address_record{};
+      if (address.is_v4()) {
+        address_record.family = kFamilyV4;
+        auto bytes = address.to_v4().to_bytes();
+        std::memcpy(address_record.bytes, bytes.data(), bytes.size());
+      } else {
+        address_record.family = kFamilyV6;
+        auto bytes = address.to_v6().to_bytes();
+        std::memcpy(address_record.bytes, bytes.data(), bytes.size());
+      }
+      Append(&address_section, address_record);
+      address_count++;
+    }
+    record.address_count = address_count - record.address_index;
+    Append(&dns_section, record);
+  }
+
+  for (const auto decision : sorted_decisions) {
+    DecisionRecord record{};
+    record.key_offset = strings.Add(decision->first);
+    record.key_length = uint32_t(decision->first.size());
+    record.value = decision->second;
+    Append(&decision_section, record);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.created_at = wall_now;
+  header.decision_tag = decision_tag;
+  header.dns_count = uint32_t(entries.size());
+  header.decision_count = uint32_t(sorted_decisions.size());
+  header.address_count = address_count;
+  header.dns_offset = sizeof(Header);
+  header.decision_offset = header.dns_offset + dns_section.size();
+  header.address_offset = header.decision_offset + decision_section.size();
+  header.string_offset = header.address_offset + address_section.size();
+  header.string_size = strings.data().size();
+
+  std::string data(reinterpret_cast<const char*>(&header), sizeof(Header));
+  data.append(dns_section)
+      .append(decision_section)
+      .append(address_section)
+      .append(strings.data());
+  auto ec = ReplaceFile(path, data);
+  if (ec) {
+    return ec;
+  }
+
+  NEDEBUG << "Wrote " << entries.size() << " DNS entries and "
+          << sorted_decisions.size() << " decisions to " << path << ".";
+  return std::error_code();
+}
+
+std::shared_ptr<WarmSnapshot> WarmSnapshot::Open(const std::string& path,
+                                                 std::error_code& ec) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ec = std::error_code(errno, std::generic_category());
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st)) {
+    ec = std::error_code(errno, std::generic_category());
+    close(fd);
+    return nullptr;
+  }
+
+  size_t size = size_t(st.st_size);
+  if (size < sizeof(Header)) {
+    close(fd);
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return nullptr;
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    ec = std::error_code(errno, std::generic_category());
+    return nullptr;
+  }
+
+  // Constructed before the checks so the mapping is released on failure.
+  std::shared_ptr<WarmSnapshot> snapshot{
+      new WarmSnapshot(static_cast<const uint8_t*>(data), size)};
+
+  // Only the header is checked here, records are checked on use.
+  Header header;
+  std::memcpy(&header, data, sizeof(Header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) ||
+      header.version != kVersion || header.byte_order != kByteOrder ||
+      header.dns_offset % alignof(DnsRecord) ||
+      header.decision_offset % alignof(DecisionRecord) ||
+      header.address_offset % alignof(AddressRecord) ||
+      !InBounds(header.dns_offset, header.dns_count, sizeof(DnsRecord),
+                size) ||
+      !InBounds(header.decision_offset, header.decision_count,
+                sizeof(DecisionRecord), size) ||
+      !InBounds(header.address_offset, header.address_count,
+                sizeof(AddressRecord), size) ||
+      !InBounds(header.string_offset, header.string_size, 1, size)) {
+    NEWARN << "Snapshot " << path << " is invalid, ignored.";
+    ec = std::make_error_code(std::errc::invalid_argument);
+    return nullptr;
+  }
+
+  ec = std::error_code();
+  return snapshot;
+}
+
+template <typename Record>
+const Record* WarmSnapshot::Find(uint64_t offset, uint32_t count,
+                                 const std::string& key) const {
+  const Header* header = reinterpret_cast<const Header*>(data_);
+  const Record* records = reinterpret_cast<const Record*>(data_ + offset);
+  const char* strings =
+      reinterpret_cast<const char*>(data_ + header->string_offset);
+
+  uint32_t low = 0, high = count;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    const Record& record = records[middle];
+    if (uint64_t(record.key_offset) + record.key_length >
+        header->string_size) {
+      return nullptr;
+    }
+
+    int result = key.compare(0, std::string::npos, strings + record.key_offset,
+                             record.key_length);
+    if (!result) {
+      return &record;
+    }
+    if (result < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return nullptr;
+}
+
+bool WarmSnapshot::FindAddresses(const std::string& key,
+                                 DnsCache::Addresses* addresses,
+                                 std::chrono::seconds* remaining,
+                                 std::chrono::seconds* ttl) const {
+  const Header* header = reinterpret_cast<const Header*>(data_);
+  auto record = Find<DnsRecord>(header->dns_offset, header->dns_count, key);
+  if (!record || !record->address_count ||
+      uint64_t(record->address_index) + record->address_count >
+          header->address_count) {
+    return false;
+  }
+
+  int64_t left = record->expire_at - WallNow();
+  if (left <= 0) {
+    return false;
+  }
+
+  auto result = std::make_shared<std::vector<boost::asio::ip::address>>();
+  result->reserve(record->address_count);
+  const AddressRecord* address_records =
+      reinterpret_cast<const AddressRecord*>(data_ + header->address_offset) +
+      record->address_index;
+  for (uint32_t i = 0; i < record->address_count; i++) {
+    const AddressRecord& address = address_records[i];
+    if (address.family == kFamilyV4) {
+      boost::asio::ip::address_v4::bytes_type bytes;
+      std::memcpy(bytes.data(), address.bytes, bytes.size());
+      result->emplace_back(boost::asio::ip::address_v4(bytes));
+    } else if (address.family == kFamilyV6) {
+      boost::asio::ip::address_v6::bytes_type bytes;
+      std::memcpy(bytes.data(), address.bytes, bytes.size());
+      result->emplace_back(boost::asio::ip::address_v6(bytes));
+    } else {
+      return false;
+    }
+  }
+
+  *addresses = result;
+  // The entry may have been written with a longer TTL than it has left.
+  *remaining = std::chrono::seconds(
+      std::min<int64_t>(left, std::max<uint32_t>(record->ttl, 1)));
+  *ttl = std::chrono::seconds(record->ttl);
+  return true;
+}
+
+bool WarmSnapshot::FindDecision(const std::string& key,
+                                uint32_t* value) const {
+  const Header* header = reinterpret_cast<const Header*>(data_);
+  auto record = Find<DecisionRecord>(header->decision_offset,
+                                     header->decision_count, key);
+  if (!record) {
+    return false;
+  }
+  *value = record->value;
+  return true;
+}
+
+uint64_t WarmSnapshot::decision_tag() const {
+  return reinterpret_cast<const Header*>(data_)->decision_tag;
+}
+
+size_t WarmSnapshot::address_entry_count() const {
+  return reinterpret_cast<const Header*>(data_)->dns_count;
+}
+
+size_t WarmSnapshot::decision_count() const {
+  return reinterpret_cast<const Header*>(data_)->decision_count;
+}
+}  // namespace utils
+}  // namespace nekit
@@ -0,0 +1,90 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <random>
+
+#include <boost/asio/ip/address.hpp>
+#include <gtest/gtest.h>
+
+#include "nekit/utils/bloom_filter.h"
+#include "nekit/utils/domain_set.h"
+#include "nekit/utils/subnet_tree.h"
+
+using namespace nekit::utils;
+using boost::asio::ip::address;
+
+TEST(BloomFilterUnitTest, FalsePositiveRateTest) {
+  for (double rate : {0.01, 0.001}) {
+    BloomFilter filter(100000, BloomFilter::BitsPerKey(rate));
+    std::mt19937_64 random{1};
+    for (int i = 0; i < 100000; i++) {
+      filter.Insert(random());
+    }
+
+    random.seed(1);
+    for (int i = 0; i < 100000; i++) {
+      ASSERT_TRUE(filter.MayContain(random()));
+    }
+
+    int positives = 0;
+    for (int i = 0; i < 100000; i++) {
+      positives += filter.MayContain(random());
+    }
+    EXPECT_LT(positives, 100000 * rate * 1.5) << rate;
+  }
+}
+
+TEST(BloomFilterUnitTest, EmptyTest) {
+  BloomFilter filter;
+  EXPECT_TRUE(filter.MayContain(1));
+  filter.Insert(1);
+  EXPECT_EQ(filter.memory_usage(), 0u);
+}
+
+TEST(BloomFilterUnitTest, DomainSetTest) {
+  DomainSet set;
+  set.AddSuffix("example.com");
+  set.AddDomain("a.example.org");
+  set.BuildFilter(10);
+  set.AddDomain("b.example.org");
+
+  EXPECT_TRUE(set.Contains("x.example.com"));
+  EXPECT_TRUE(set.Contains("a.example.org"));
+  EXPECT_TRUE(set.Contains("B.example.org"));
+  EXPECT_FALSE(set.Contains("c.example.org"));
+  EXPECT_FALSE(set.Contains("example.net"));
+}
+
+TEST(BloomFilterUnitTest, SubnetTreeTest) {
+  SubnetTree tree;
+  tree.Insert(address::from_string("10.0.0.0"), 8);
+  tree.Insert(address::from_string("2001:db8::"), 32);
+  tree.BuildFilter(10);
+  tree.Insert(address::from_string("192.168.1.0"), 24);
+
+  EXPECT_TRUE(tree.Contains(address::from_string("10.1.2.3")));
+  EXPECT_TRUE(tree.Contains(address::from_string("2001:db8::1")));
+  EXPECT_TRUE(tree.Contains(address::from_string("192.168.1.1")));
+  EXPECT_FALSE(tree.Contains(address::from_string("192.168.2.1")));
+  EXPECT_FALSE(tree.Contains(address::from_string("2001:db9::1")));
+  EXPECT_FALSE(tree.Contains(address::from_string("11.0.0.1")));
+}
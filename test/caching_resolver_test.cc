@@ -0,0 +1,251 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake_resolver.h"
+#include "nekit/utils/caching_resolver.h"
+#include "nekit/utils/error.h"
+#include "nekit/utils/stub_resolver.h"
+#include "nekit/utils/system_resolver.h"
+
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+using Preference = ResolverInterface::AddressPreference;
+using nekit::test::FakeResolver;
+using nekit::test::ResolveResult;
+using nekit::test::StartResolve;
+
+namespace {
+// Inserts an entry of `domain` that expires in half a second.
+void InsertExpiring(DnsCache* cache, const std::string& domain) {
+  cache->Insert(
+      ResolverInterface::QueryKey(domain, Preference::IPv4Only),
+      std::make_shared<std::vector<address>>(
+          1, address::from_string("1.2.3.4")),
+      std::chrono::seconds(10),
+      DnsCache::Clock::now() - std::chrono::milliseconds(9500));
+}
+
+void Lookup(boost::asio::io_context* io, CachingResolver* resolver,
+            const std::string& domain, size_t times) {
+  for (size_t i = 0; i < times; i++) {
+    ResolveResult result;
+    auto cancelable = StartResolve(resolver, domain, &result);
+    io->restart();
+    io->run();
+    ASSERT_TRUE(result.called);
+    ASSERT_EQ(result.addresses->front(), address::from_string("1.2.3.4"));
+  }
+}
+}  // namespace
+
+TEST(CachingResolverUnitTest, CacheHitTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake),
+                           std::make_shared<DnsCache>()};
+
+  ResolveResult result;
+  auto cancelable = StartResolve(&resolver, "a.com", &result);
+  ASSERT_EQ(fake->count(), 1);
+  fake->Complete(0, "1.2.3.4");
+  ASSERT_TRUE(result.called);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.ttl, std::chrono::seconds(NEKIT_DNS_CACHE_DEFAULT_TTL));
+
+  // A cached answer is posted, never delivered from inside `Resolve`.
+  result = ResolveResult();
+  cancelable = StartResolve(&resolver, "A.com", &result);
+  ASSERT_EQ(fake->count(), 1);
+  ASSERT_FALSE(result.called);
+  io.run();
+  ASSERT_TRUE(result.called);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->front(), address::from_string("1.2.3.4"));
+
+  // Canceling a cached answer drops it.
+  result = ResolveResult();
+  cancelable = StartResolve(&resolver, "a.com", &result);
+  cancelable.Cancel();
+  io.restart();
+  io.run();
+  ASSERT_FALSE(result.called);
+}
+
+TEST(CachingResolverUnitTest, TtlTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake),
+                           std::make_shared<DnsCache>()};
+
+  ResolveResult result;
+  auto cancelable = StartResolve(&resolver, "a.com", &result);
+  fake->Complete(0, "1.2.3.4", std::chrono::seconds(300));
+  ASSERT_EQ(result.ttl, std::chrono::seconds(300));
+
+  // A TTL of zero is a real TTL, not an unknown one.
+  cancelable = StartResolve(&resolver, "b.com", &result);
+  fake->Complete(1, "1.2.3.4", std::chrono::seconds(0));
+  ASSERT_EQ(result.ttl, std::chrono::seconds(NEKIT_DNS_CACHE_MIN_TTL));
+  auto entry = resolver.cache()->Lookup(
+      ResolverInterface::QueryKey("b.com", Preference::IPv4Only));
+  ASSERT_TRUE(entry);
+  ASSERT_LE(entry->expire_at - DnsCache::Clock::now(),
+            std::chrono::seconds(NEKIT_DNS_CACHE_MIN_TTL));
+
+  cancelable = StartResolve(&resolver, "c.com", &result);
+  fake->Complete(2, "1.2.3.4", std::chrono::seconds(1000000));
+  ASSERT_EQ(result.ttl, std::chrono::seconds(NEKIT_DNS_CACHE_MAX_TTL));
+}
+
+TEST(CachingResolverUnitTest, NegativeCacheTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake),
+                           std::make_shared<DnsCache>()};
+
+  ResolveResult result;
+  auto cancelable = StartResolve(&resolver, "a.com", &result);
+  fake->Fail(0, StubResolver::ErrorCode::NameError);
+  ASSERT_EQ(result.ec, StubResolver::ErrorCode::NameError);
+  ASSERT_EQ(result.ttl, std::chrono::seconds(NEKIT_DNS_CACHE_NEGATIVE_TTL));
+
+  result = ResolveResult();
+  cancelable = StartResolve(&resolver, "a.com", &result);
+  io.run();
+  ASSERT_EQ(fake->count(), 1);
+  ASSERT_EQ(result.ec, StubResolver::ErrorCode::NameError);
+  ASSERT_FALSE(result.addresses);
+
+  // Server failures are only cached briefly.
+  cancelable = StartResolve(&resolver, "b.com", &result);
+  fake->Fail(1, StubResolver::ErrorCode::ServerFailure);
+  ASSERT_EQ(result.ttl, std::chrono::seconds(NEKIT_DNS_CACHE_FAILURE_TTL));
+  ASSERT_EQ(resolver.cache()->size(), 2);
+}
+
+TEST(CachingResolverUnitTest, LocalErrorNotCachedTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake),
+                           std::make_shared<DnsCache>()};
+
+  std::vector<std::error_code> errors{
+      NEKitErrorCode::Canceled, StubResolver::ErrorCode::TimedOut,
+      SystemResolver::ErrorCode::QueueFull,
+      SystemResolver::ErrorCode::TimedOut};
+
+  for (size_t i = 0; i < errors.size(); i++) {
+    ResolveResult result;
+    auto cancelable = StartResolve(&resolver, "a.com", &result);
+    ASSERT_EQ(fake->count(), i + 1);
+    fake->Fail(i, errors[i]);
+    ASSERT_EQ(result.ec, errors[i]);
+    ASSERT_EQ(result.ttl.count(), 0);
+    ASSERT_EQ(resolver.cache()->size(), 0);
+  }
+}
+
+TEST(CachingResolverUnitTest, PrefetchTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  auto cache = std::make_shared<DnsCache>();
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake), cache};
+  InsertExpiring(cache.get(), "a.com");
+
+  // Only entries looked up often enough are prefetched.
+  Lookup(&io, &resolver, "a.com", NEKIT_DNS_PREFETCH_MIN_HITS - 1);
+  ASSERT_EQ(fake->count(), 0);
+  Lookup(&io, &resolver, "a.com", 2);
+  ASSERT_EQ(fake->count(), 1);
+  ASSERT_EQ(resolver.prefetches(), 1);
+
+  fake->Complete(0, "5.6.7.8");
+  auto entry = cache->Lookup(
+      ResolverInterface::QueryKey("a.com", Preference::IPv4Only));
+  ASSERT_TRUE(entry);
+  ASSERT_EQ(entry->addresses->front(), address::from_string("5.6.7.8"));
+  ASSERT_GT(entry->expire_at - DnsCache::Clock::now(), std::chrono::seconds(1));
+}
+
+TEST(CachingResolverUnitTest, PrefetchFailureTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  auto cache = std::make_shared<DnsCache>();
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake), cache};
+  InsertExpiring(cache.get(), "a.com");
+
+  Lookup(&io, &resolver, "a.com", NEKIT_DNS_PREFETCH_MIN_HITS);
+  ASSERT_EQ(fake->count(), 1);
+
+  // The current entry is kept until it expires.
+  fake->Fail(0, StubResolver::ErrorCode::ServerFailure);
+  Lookup(&io, &resolver, "a.com", 1);
+  ASSERT_EQ(cache->statistics().negative_hits, 0);
+}
+
+TEST(CachingResolverUnitTest, PrefetchStopTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  auto cache = std::make_shared<DnsCache>();
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake), cache};
+  InsertExpiring(cache.get(), "a.com");
+
+  Lookup(&io, &resolver, "a.com", NEKIT_DNS_PREFETCH_MIN_HITS);
+  ASSERT_EQ(fake->count(), 1);
+
+  resolver.Stop();
+  ASSERT_TRUE(fake->canceled(0));
+
+  // A late answer is ignored.
+  fake->Complete(0, "5.6.7.8");
+  auto entry = cache->Lookup(
+      ResolverInterface::QueryKey("a.com", Preference::IPv4Only));
+  ASSERT_TRUE(entry);
+  ASSERT_EQ(entry->addresses->front(), address::from_string("1.2.3.4"));
+}
+
+TEST(CachingResolverUnitTest, PrefetchThrottleTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  auto cache = std::make_shared<DnsCache>();
+  CachingResolver resolver{std::unique_ptr<ResolverInterface>(fake), cache};
+  // Rates below one per second still allow a prefetch now and then.
+  resolver.set_prefetch_rate(0.5);
+  InsertExpiring(cache.get(), "a.com");
+  InsertExpiring(cache.get(), "b.com");
+
+  Lookup(&io, &resolver, "a.com", NEKIT_DNS_PREFETCH_MIN_HITS);
+  ASSERT_EQ(resolver.prefetches(), 1);
+  Lookup(&io, &resolver, "b.com", NEKIT_DNS_PREFETCH_MIN_HITS);
+  ASSERT_EQ(resolver.prefetches(), 1);
+  ASSERT_EQ(resolver.prefetches_throttled(), 1);
+  ASSERT_EQ(fake->count(), 1);
+
+  resolver.set_prefetch_rate(0);
+  Lookup(&io, &resolver, "b.com", 1);
+  ASSERT_EQ(resolver.prefetches(), 1);
+  ASSERT_EQ(resolver.prefetches_throttled(), 2);
+}
@@ -0,0 +1,107 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake_resolver.h"
+#include "nekit/utils/coalescing_resolver.h"
+
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+using Preference = ResolverInterface::AddressPreference;
+using nekit::test::FakeResolver;
+
+TEST(CoalescingResolverUnitTest, CoalesceTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  CoalescingResolver resolver{std::unique_ptr<ResolverInterface>(fake)};
+
+  const size_t count = 5;
+  std::vector<int> called(count, 0);
+  std::vector<Cancelable> cancelables;
+  for (size_t i = 0; i < count; i++) {
+    cancelables.push_back(resolver.Resolve(
+        "a.com", Preference::IPv4Only,
+        [&called, i](std::shared_ptr<std::vector<address>> addresses,
+                     std::error_code ec) {
+          ASSERT_FALSE(ec);
+          ASSERT_EQ(addresses->front(), address::from_string("1.2.3.4"));
+          called[i]++;
+        }));
+  }
+
+  ASSERT_EQ(fake->count(), 1);
+  ASSERT_EQ(resolver.coalesced(), count - 1);
+  ASSERT_EQ(resolver.pending_queries(), 1);
+
+  // Canceling one waiter, even the one that started the query, keeps the
+  // shared query.
+  cancelables[0].Cancel();
+  cancelables[2].Cancel();
+  ASSERT_FALSE(fake->canceled(0));
+
+  fake->Complete(0, "1.2.3.4");
+  ASSERT_EQ(called, std::vector<int>({0, 1, 0, 1, 1}));
+  ASSERT_EQ(resolver.pending_queries(), 0);
+
+  // A finished query is not joined.
+  auto cancelable = resolver.Resolve(
+      "a.com", Preference::IPv4Only,
+      [](std::shared_ptr<std::vector<address>>, std::error_code) {});
+  ASSERT_EQ(fake->count(), 2);
+}
+
+TEST(CoalescingResolverUnitTest, PreferenceTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  CoalescingResolver resolver{std::unique_ptr<ResolverInterface>(fake)};
+
+  auto handler = [](std::shared_ptr<std::vector<address>>, std::error_code) {};
+  auto c1 = resolver.Resolve("a.com", Preference::IPv4Only, handler);
+  auto c2 = resolver.Resolve("A.COM", Preference::IPv4Only, handler);
+  auto c3 = resolver.Resolve("a.com", Preference::IPv6Only, handler);
+  ASSERT_EQ(fake->count(), 2);
+  ASSERT_EQ(resolver.coalesced(), 1);
+}
+
+TEST(CoalescingResolverUnitTest, StopTest) {
+  boost::asio::io_context io;
+  auto fake = new FakeResolver(&io);
+  CoalescingResolver resolver{std::unique_ptr<ResolverInterface>(fake)};
+
+  int called = 0;
+  auto handler = [&called](std::shared_ptr<std::vector<address>>,
+                           std::error_code) { called++; };
+  auto c1 = resolver.Resolve("a.com", Preference::IPv4Only, handler);
+  auto c2 = resolver.Resolve("a.com", Preference::IPv4Only, handler);
+  ASSERT_EQ(resolver.pending_queries(), 1);
+
+  resolver.Stop();
+  ASSERT_TRUE(fake->canceled(0));
+  ASSERT_EQ(resolver.pending_queries(), 0);
+
+  // A late answer of the dropped query is ignored.
+  fake->Complete(0, "1.2.3.4");
+  ASSERT_EQ(called, 0);
+}
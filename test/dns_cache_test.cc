@@ -0,0 +1,162 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "nekit/utils/dns_cache.h"
+#include "nekit/utils/warm_snapshot.h"
+
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+
+namespace {
+DnsCache::Addresses MakeAddresses(const std::string& ip) {
+  return std::make_shared<std::vector<address>>(
+      std::vector<address>{address::from_string(ip)});
+}
+}  // namespace
+
+TEST(DnsCacheUnitTest, ExpireTest) {
+  DnsCache cache{4};
+  auto now = DnsCache::Clock::now();
+
+  cache.Insert("example.com", MakeAddresses("1.1.1.1"),
+               std::chrono::seconds(10), now);
+
+  auto entry = cache.Lookup("example.com", now + std::chrono::seconds(9));
+  ASSERT_TRUE(entry);
+  ASSERT_EQ(entry->addresses->front(), address::from_string("1.1.1.1"));
+
+  ASSERT_FALSE(cache.Lookup("example.com", now + std::chrono::seconds(10)));
+  ASSERT_EQ(cache.size(), 0);
+  ASSERT_EQ(cache.statistics().hits, 1);
+  ASSERT_EQ(cache.statistics().misses, 1);
+  ASSERT_EQ(cache.statistics().expired, 1);
+}
+
+TEST(DnsCacheUnitTest, NegativeTest) {
+  DnsCache cache{4};
+  auto now = DnsCache::Clock::now();
+
+  cache.InsertNegative("nx.example.com",
+                       std::make_error_code(std::errc::host_unreachable),
+                       std::chrono::seconds(10), now);
+
+  auto entry = cache.Lookup("nx.example.com", now);
+  ASSERT_TRUE(entry);
+  ASSERT_FALSE(entry->addresses);
+  ASSERT_EQ(entry->error, std::errc::host_unreachable);
+  ASSERT_EQ(cache.statistics().negative_hits, 1);
+}
+
+TEST(DnsCacheUnitTest, EvictTest) {
+  DnsCache cache{2};
+  auto now = DnsCache::Clock::now();
+  auto ttl = std::chrono::seconds(10);
+
+  cache.Insert("a", MakeAddresses("1.1.1.1"), ttl, now);
+  cache.Insert("b", MakeAddresses("2.2.2.2"), ttl, now);
+  // Make "a" the most recently used.
+  ASSERT_TRUE(cache.Lookup("a", now));
+  cache.Insert("c", MakeAddresses("3.3.3.3"), ttl, now);
+
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_TRUE(cache.Lookup("a", now));
+  ASSERT_FALSE(cache.Lookup("b", now));
+  ASSERT_TRUE(cache.Lookup("c", now));
+  ASSERT_EQ(cache.statistics().evicted, 1);
+}
+
+TEST(DnsCacheUnitTest, ReplaceTest) {
+  DnsCache cache{2};
+  auto now = DnsCache::Clock::now();
+
+  cache.Insert("a", MakeAddresses("1.1.1.1"), std::chrono::seconds(1), now);
+  cache.Insert("a", MakeAddresses("2.2.2.2"), std::chrono::seconds(10), now);
+
+  ASSERT_EQ(cache.size(), 1);
+  auto entry = cache.Lookup("a", now + std::chrono::seconds(5));
+  ASSERT_TRUE(entry);
+  ASSERT_EQ(entry->addresses->front(), address::from_string("2.2.2.2"));
+}
+
+TEST(DnsCacheUnitTest, WarmSnapshotTest) {
+  std::string path =
+      "/tmp/nekit_warm_snapshot_" + std::to_string(getpid()) + ".bin";
+  auto now = DnsCache::Clock::now();
+
+  {
+    DnsCache cache{4};
+    auto addresses = MakeAddresses("1.1.1.1");
+    addresses->push_back(address::from_string("2001:db8::1"));
+    cache.Insert("a", addresses, std::chrono::seconds(100), now);
+    cache.Insert("b", MakeAddresses("2.2.2.2"), std::chrono::seconds(100),
+                 now);
+    cache.InsertNegative("nx", std::make_error_code(std::errc::io_error),
+                         std::chrono::seconds(100), now);
+    ASSERT_FALSE(
+        WarmSnapshot::Write(path, cache, {{"b", 2}, {"a", 1}}, 42));
+  }
+
+  std::error_code ec;
+  auto snapshot = WarmSnapshot::Open(path, ec);
+  ASSERT_FALSE(ec);
+  ASSERT_EQ(snapshot->address_entry_count(), 2);
+  ASSERT_EQ(snapshot->decision_tag(), 42);
+
+  uint32_t value;
+  ASSERT_TRUE(snapshot->FindDecision("a", &value));
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(snapshot->FindDecision("b", &value));
+  ASSERT_EQ(value, 2);
+  ASSERT_FALSE(snapshot->FindDecision("c", &value));
+
+  DnsCache cache{4};
+  cache.set_snapshot(snapshot);
+  auto entry = cache.Lookup("a", now);
+  ASSERT_TRUE(entry);
+  ASSERT_EQ(entry->addresses->size(), 2);
+  ASSERT_EQ(entry->addresses->back(), address::from_string("2001:db8::1"));
+  ASSERT_LE(entry->expire_at, now + std::chrono::seconds(100));
+  ASSERT_FALSE(cache.Lookup("nx", now));
+  ASSERT_EQ(cache.statistics().snapshot_hits, 1);
+  ASSERT_EQ(cache.statistics().misses, 1);
+
+  std::remove(path.c_str());
+}
+
+TEST(DnsCacheUnitTest, InvalidWarmSnapshotTest) {
+  std::string path =
+      "/tmp/nekit_invalid_snapshot_" + std::to_string(getpid()) + ".bin";
+  std::ofstream(path) << "not a snapshot";
+
+  std::error_code ec;
+  ASSERT_FALSE(WarmSnapshot::Open(path, ec));
+  ASSERT_TRUE(ec);
+
+  std::remove(path.c_str());
+}
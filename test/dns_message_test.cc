@@ -0,0 +1,130 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "nekit/utils/dns_message.h"
+
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+
+namespace {
+void AppendName(const std::string& name, std::vector<uint8_t>* buffer) {
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = std::min(name.find('.', start), name.size());
+    buffer->push_back(static_cast<uint8_t>(end - start));
+    buffer->insert(buffer->end(), name.begin() + start, name.begin() + end);
+    start = end + 1;
+  }
+  buffer->push_back(0);
+}
+
+// Builds the response to the A query of `domain` with records appended by
+// `Add`.
+class Response {
+ public:
+  explicit Response(const std::string& domain) {
+    EncodeDnsQuery(1, domain, DnsRecordType::A, &buffer_);
+    buffer_[2] |= 0x80;
+  }
+
+  void Add(const std::string& owner, DnsRecordType type, uint32_t ttl,
+           const std::vector<uint8_t>& data) {
+    AppendName(owner, &buffer_);
+    buffer_.insert(buffer_.end(), {0, static_cast<uint8_t>(type), 0, 1,
+                                   static_cast<uint8_t>(ttl >> 24),
+                                   static_cast<uint8_t>(ttl >> 16),
+                                   static_cast<uint8_t>(ttl >> 8),
+                                   static_cast<uint8_t>(ttl), 0,
+                                   static_cast<uint8_t>(data.size())});
+    buffer_.insert(buffer_.end(), data.begin(), data.end());
+    buffer_[7]++;
+  }
+
+  void AddAddress(const std::string& owner, const std::string& ip,
+                  uint32_t ttl = 60) {
+    auto bytes = address_v4::from_string(ip).to_bytes();
+    Add(owner, DnsRecordType::A, ttl, {bytes.begin(), bytes.end()});
+  }
+
+  void AddAlias(const std::string& owner, const std::string& target,
+                uint32_t ttl = 60) {
+    std::vector<uint8_t> data;
+    AppendName(target, &data);
+    Add(owner, DnsRecordType::CNAME, ttl, data);
+  }
+
+  std::vector<address> Parse(const std::string& domain,
+                             std::vector<uint32_t>* ttls = nullptr) {
+    DnsResponse response;
+    EXPECT_TRUE(ParseDnsResponse(buffer_.data(), buffer_.size(), domain,
+                                 DnsRecordType::A, &response));
+    std::vector<address> addresses;
+    for (const auto& record : response.records) {
+      addresses.push_back(record.address);
+      if (ttls) {
+        ttls->push_back(record.ttl);
+      }
+    }
+    return addresses;
+  }
+
+ private:
+  std::vector<uint8_t> buffer_;
+};
+}  // namespace
+
+TEST(DnsMessageUnitTest, OwnerTest) {
+  Response response{"a.com"};
+  response.AddAddress("A.com", "1.1.1.1");
+  response.AddAddress("b.com", "2.2.2.2");
+  ASSERT_EQ(response.Parse("a.com"),
+            std::vector<address>({address::from_string("1.1.1.1")}));
+}
+
+TEST(DnsMessageUnitTest, CnameChainTest) {
+  Response response{"a.com"};
+  response.AddAlias("a.com", "b.com", 30);
+  response.AddAddress("evil.com", "6.6.6.6");
+  response.AddAlias("b.com", "c.com", 300);
+  response.AddAddress("c.com", "3.3.3.3", 60);
+  response.AddAddress("c.com", "4.4.4.4", 10);
+
+  std::vector<uint32_t> ttls;
+  ASSERT_EQ(response.Parse("a.com.", &ttls),
+            std::vector<address>({address::from_string("3.3.3.3"),
+                                  address::from_string("4.4.4.4")}));
+  ASSERT_EQ(ttls, std::vector<uint32_t>({30, 10}));
+}
+
+TEST(DnsMessageUnitTest, CnameLoopTest) {
+  Response response{"a.com"};
+  response.AddAlias("a.com", "b.com");
+  response.AddAlias("b.com", "a.com");
+  response.AddAddress("c.com", "3.3.3.3");
+  ASSERT_TRUE(response.Parse("a.com").empty());
+}
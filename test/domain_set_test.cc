@@ -0,0 +1,159 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "nekit/utils/domain_set.h"
+
+using namespace nekit::utils;
+
+TEST(DomainSetUnitTest, ExactTest) {
+  DomainSet set;
+  EXPECT_FALSE(set.Contains("example.com"));
+
+  set.AddDomain("example.com");
+  set.AddDomain("");
+  EXPECT_EQ(set.size(), 1u);
+
+  EXPECT_TRUE(set.Contains("example.com"));
+  EXPECT_FALSE(set.Contains("a.example.com"));
+  EXPECT_FALSE(set.Contains("com"));
+  EXPECT_FALSE(set.Contains("example.co"));
+  EXPECT_FALSE(set.Contains(""));
+}
+
+TEST(DomainSetUnitTest, SuffixTest) {
+  DomainSet set;
+  set.AddSuffix("example.com");
+
+  EXPECT_TRUE(set.Contains("example.com"));
+  EXPECT_TRUE(set.Contains("a.example.com"));
+  EXPECT_TRUE(set.Contains("b.a.example.com"));
+  EXPECT_FALSE(set.Contains("badexample.com"));
+  EXPECT_FALSE(set.Contains("com"));
+  EXPECT_FALSE(set.Contains("example.com.cn"));
+  EXPECT_FALSE(set.Contains("example"));
+}
+
+TEST(DomainSetUnitTest, LowestValueTest) {
+  DomainSet set;
+  set.AddSuffix("com", 5);
+  set.AddSuffix("example.com", 3);
+  set.AddDomain("a.example.com", 1);
+  set.AddDomain("a.example.com", 2);
+  set.AddDomain("example.com", 4);
+
+  EXPECT_EQ(set.Match("a.example.com"), 1u);
+  EXPECT_EQ(set.Match("b.example.com"), 3u);
+  EXPECT_EQ(set.Match("example.com"), 3u);
+  EXPECT_EQ(set.Match("x.a.example.com"), 3u);
+  EXPECT_EQ(set.Match("other.com"), 5u);
+  EXPECT_EQ(set.Match("other.org"), DomainSet::kNoMatch);
+
+  size_t entries = 0;
+  set.ForEach([&entries](const std::string& domain, bool suffix,
+                         uint32_t value) {
+    entries++;
+    if (domain == "example.com") {
+      EXPECT_EQ(value, suffix ? 3u : 4u);
+    }
+  });
+  EXPECT_EQ(entries, 4u);
+}
+
+TEST(DomainSetUnitTest, GrowTest) {
+  DomainSet set;
+  for (int i = 0; i < 10000; i++) {
+    set.AddSuffix("d" + std::to_string(i) + ".com", i);
+  }
+  EXPECT_EQ(set.size(), 10000u);
+  for (int i = 0; i < 10000; i += 7) {
+    EXPECT_EQ(set.Match("www.d" + std::to_string(i) + ".com"), uint32_t(i));
+  }
+  EXPECT_FALSE(set.Contains("d10000.com"));
+}
+
+TEST(DomainSetUnitTest, CaseInsensitiveTest) {
+  DomainSet set;
+  set.AddSuffix("Example.COM", 1);
+  set.AddDomain("example.com", 0);
+  EXPECT_EQ(set.size(), 1u);
+
+  EXPECT_EQ(set.Match("EXAMPLE.com"), 0u);
+  EXPECT_EQ(set.Match("WWW.example.Com"), 1u);
+  EXPECT_FALSE(set.Contains("example.con"));
+
+  set.ForEach([](const std::string& domain, bool, uint32_t) {
+    EXPECT_EQ(domain, "Example.COM");
+  });
+}
+
+TEST(DomainSetUnitTest, SaveMapTest) {
+  DomainSet set;
+  for (int i = 0; i < 1000; i++) {
+    set.AddSuffix("d" + std::to_string(i) + ".com", i);
+  }
+  set.AddDomain("Example.com", 7);
+  std::string saved;
+  set.Save(&saved);
+
+  // Aligned like a section of a mapped file.
+  auto buffer = std::make_shared<std::vector<uint64_t>>(saved.size() / 8 + 1);
+  std::memcpy(buffer->data(), saved.data(), saved.size());
+
+  DomainSet mapped;
+  mapped.AddDomain("replaced.com");
+  ASSERT_TRUE(mapped.Map(buffer->data(), saved.size(), buffer));
+  EXPECT_TRUE(mapped.mapped());
+  EXPECT_EQ(mapped.size(), set.size());
+  EXPECT_EQ(mapped.memory_usage(), 0u);
+  EXPECT_FALSE(mapped.Contains("replaced.com"));
+  EXPECT_EQ(mapped.Match("a.d42.com"), 42u);
+  EXPECT_EQ(mapped.Match("example.COM"), 7u);
+  EXPECT_FALSE(mapped.Contains("a.example.com"));
+
+  // Changing it copies the mapped data.
+  mapped.AddDomain("added.com", 3);
+  EXPECT_FALSE(mapped.mapped());
+  EXPECT_EQ(mapped.Match("added.com"), 3u);
+  EXPECT_EQ(mapped.Match("a.d42.com"), 42u);
+  EXPECT_EQ(std::memcmp(buffer->data(), saved.data(), saved.size()), 0);
+
+  DomainSet invalid;
+  EXPECT_FALSE(invalid.Map(buffer->data(), saved.size() - 1, buffer));
+  // Point the first used slot past the pool.
+  char* slots = reinterpret_cast<char*>(buffer->data()) + 5 * 8;
+  for (uint32_t offset;; slots += 8) {
+    std::memcpy(&offset, slots + 4, 4);
+    if (offset != 0xffffffff) {
+      break;
+    }
+  }
+  std::memset(slots + 4, 0x7f, 4);
+  EXPECT_FALSE(invalid.Map(buffer->data(), saved.size(), buffer));
+  EXPECT_FALSE(invalid.mapped());
+}
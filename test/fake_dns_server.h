@@ -0,0 +1,274 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace nekit {
+namespace test {
+
+// A DNS server on loopback answering A and AAAA queries from a static table,
+// over both UDP and TCP on the same port. Unknown names get NXDOMAIN.
+class FakeDnsServer {
+ public:
+  explicit FakeDnsServer(boost::asio::io_context* io)
+      : io_{io}, udp_socket_{*io}, tcp_acceptor_{*io} {
+    auto loopback = boost::asio::ip::address_v4::loopback();
+    // Find a port free for both protocols.
+    while (true) {
+      udp_socket_.open(boost::asio::ip::udp::v4());
+      udp_socket_.bind({loopback, 0});
+      boost::system::error_code ec;
+      tcp_acceptor_.open(boost::asio::ip::tcp::v4());
+      tcp_acceptor_.set_option(boost::asio::socket_base::reuse_address(true));
+      tcp_acceptor_.bind({loopback, udp_socket_.local_endpoint().port()}, ec);
+      if (!ec) {
+        break;
+      }
+      udp_socket_.close();
+      tcp_acceptor_.close();
+    }
+    tcp_acceptor_.listen();
+
+    ReceiveUdp();
+    AcceptTcp();
+  }
+
+  boost::asio::ip::udp::endpoint endpoint() const {
+    return udp_socket_.local_endpoint();
+  }
+
+  void AddRecord(const std::string& name, const std::string& address,
+                 uint32_t ttl) {
+    records_[name].push_back(
+        {boost::asio::ip::address::from_string(address), ttl});
+  }
+
+  // Answers over UDP are truncated with no record.
+  void set_truncate_udp(bool truncate) { truncate_udp_ = truncate; }
+
+  // The next `count` UDP queries are not answered.
+  void set_drop(size_t count) { drop_ = count; }
+
+  // Each UDP query is not answered with probability `loss`.
+  void set_loss(double loss) { loss_ = loss; }
+
+  // Answers are sent after `delay`.
+  void set_delay(std::chrono::milliseconds delay) {
+    a_delay_ = aaaa_delay_ = delay;
+  }
+  void set_aaaa_delay(std::chrono::milliseconds delay) { aaaa_delay_ = delay; }
+
+  size_t udp_queries() const { return udp_queries_; }
+  size_t tcp_queries() const { return tcp_queries_; }
+
+ private:
+  struct Record {
+    boost::asio::ip::address address;
+    uint32_t ttl;
+  };
+
+  using Buffer = std::shared_ptr<std::vector<uint8_t>>;
+
+  void ReceiveUdp() {
+    udp_socket_.async_receive_from(
+        boost::asio::buffer(udp_buffer_), udp_peer_,
+        [this](const boost::system::error_code& ec, size_t size) {
+          if (ec) {
+            return;
+          }
+
+          udp_queries_++;
+          if (drop_) {
+            drop_--;
+          } else if (!Lose()) {
+            auto response = Answer(udp_buffer_.data(), size, truncate_udp_);
+            auto peer = udp_peer_;
+            Later(response, [this, response, peer]() {
+              udp_socket_.send_to(boost::asio::buffer(*response), peer);
+            });
+          }
+          ReceiveUdp();
+        });
+  }
+
+  bool Lose() {
+    return loss_ > 0 && std::bernoulli_distribution(loss_)(random_);
+  }
+
+  void AcceptTcp() {
+    auto socket = std::make_shared<boost::asio::ip::tcp::socket>(*io_);
+    tcp_acceptor_.async_accept(
+        *socket, [this, socket](const boost::system::error_code& ec) {
+          if (ec) {
+            return;
+          }
+
+          ReadTcp(socket);
+          AcceptTcp();
+        });
+  }
+
+  void ReadTcp(std::shared_ptr<boost::asio::ip::tcp::socket> socket) {
+    auto buffer = std::make_shared<std::vector<uint8_t>>(2);
+    boost::asio::async_read(
+        *socket, boost::asio::buffer(*buffer),
+        [this, socket, buffer](const boost::system::error_code& ec, size_t) {
+          if (ec) {
+            return;
+          }
+
+          buffer->resize((*buffer)[0] << 8 | (*buffer)[1]);
+          boost::asio::async_read(
+              *socket, boost::asio::buffer(*buffer),
+              [this, socket, buffer](const boost::system::error_code& ec,
+                                     size_t size) {
+                if (ec) {
+                  return;
+                }
+
+                tcp_queries_++;
+                auto response = Answer(buffer->data(), size, false);
+                Later(response, [socket, response]() {
+                  response->insert(
+                      response->begin(),
+                      {static_cast<uint8_t>(response->size() >> 8),
+                       static_cast<uint8_t>(response->size())});
+                  boost::asio::async_write(
+                      *socket, boost::asio::buffer(*response),
+                      [socket, response](const boost::system::error_code&,
+                                         size_t) {});
+                });
+              });
+        });
+  }
+
+  template <typename Handler>
+  void Later(Buffer response, Handler handler) {
+    // Find the type of the question.
+    size_t offset = 12;
+    while ((*response)[offset]) {
+      offset += (*response)[offset] + 1;
+    }
+    auto delay = (*response)[offset + 2] == 28 ? aaaa_delay_ : a_delay_;
+    if (!delay.count()) {
+      return handler();
+    }
+
+    auto timer = std::make_shared<boost::asio::steady_timer>(*io_, delay);
+    timer->async_wait(
+        [timer, handler](const boost::system::error_code&) { handler(); });
+  }
+
+  Buffer Answer(const uint8_t* query, size_t size, bool truncate) {
+    // Read the question name and type.
+    std::string name;
+    size_t offset = 12;
+    while (offset < size && query[offset]) {
+      if (!name.empty()) {
+        name.push_back('.');
+      }
+      for (size_t i = 0; i < query[offset]; i++) {
+        name.push_back(
+            static_cast<char>(std::tolower(query[offset + 1 + i])));
+      }
+      offset += query[offset] + 1;
+    }
+    offset++;
+    uint16_t type = query[offset] << 8 | query[offset + 1];
+    size_t question_end = offset + 4;
+
+    std::vector<Record> answers;
+    uint8_t code = 0;
+    auto iter = records_.find(name);
+    if (iter == records_.end()) {
+      code = 3;
+    } else if (!truncate) {
+      for (const auto& record : iter->second) {
+        if ((type == 1 && record.address.is_v4()) ||
+            (type == 28 && record.address.is_v6())) {
+          answers.push_back(record);
+        }
+      }
+    }
+
+    auto response = std::make_shared<std::vector<uint8_t>>(
+        query, query + question_end);
+    // QR, RD and RA, plus TC and RCODE.
+    (*response)[2] = 0x81 | (truncate ? 0x02 : 0);
+    (*response)[3] = 0x80 | code;
+    (*response)[6] = 0;
+    (*response)[7] = static_cast<uint8_t>(answers.size());
+    for (size_t i = 8; i < 12; i++) {
+      (*response)[i] = 0;
+    }
+
+    for (const auto& record : answers) {
+      // Point to the name in the question.
+      std::vector<uint8_t> header{0xC0, 12, 0, static_cast<uint8_t>(type), 0,
+                                  1};
+      response->insert(response->end(), header.begin(), header.end());
+      for (int shift = 24; shift >= 0; shift -= 8) {
+        response->push_back(static_cast<uint8_t>(record.ttl >> shift));
+      }
+      if (record.address.is_v4()) {
+        auto bytes = record.address.to_v4().to_bytes();
+        response->push_back(0);
+        response->push_back(static_cast<uint8_t>(bytes.size()));
+        response->insert(response->end(), bytes.begin(), bytes.end());
+      } else {
+        auto bytes = record.address.to_v6().to_bytes();
+        response->push_back(0);
+        response->push_back(static_cast<uint8_t>(bytes.size()));
+        response->insert(response->end(), bytes.begin(), bytes.end());
+      }
+    }
+
+    return response;
+  }
+
+  boost::asio::io_context* io_;
+  boost::asio::ip::udp::socket udp_socket_;
+  boost::asio::ip::tcp::acceptor tcp_acceptor_;
+  boost::asio::ip::udp::endpoint udp_peer_;
+  std::array<uint8_t, 512> udp_buffer_;
+
+  std::map<std::string, std::vector<Record>> records_;
+  bool truncate_udp_{false};
+  size_t drop_{0};
+  double loss_{0};
+  std::mt19937 random_;
+  std::chrono::milliseconds a_delay_{0}, aaaa_delay_{0};
+  size_t udp_queries_{0}, tcp_queries_{0};
+};
+}  // namespace test
+}  // namespace nekit
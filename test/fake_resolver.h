@@ -0,0 +1,135 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "nekit/utils/cancelable.h"
+#include "nekit/utils/resolver_interface.h"
+
+namespace nekit {
+namespace test {
+
+// Keeps the handlers of the queries until the test completes them.
+class FakeResolver : public utils::ResolverInterface {
+ public:
+  explicit FakeResolver(boost::asio::io_context* io) : io_{io} {}
+
+  utils::Cancelable Resolve(std::string domain, AddressPreference preference,
+                            EventHandler handler) override {
+    return ResolveWithTtl(
+        domain, preference,
+        [handler](
+            std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+            std::chrono::seconds, std::error_code ec) {
+          handler(addresses, ec);
+        });
+  }
+
+  utils::Cancelable ResolveWithTtl(std::string domain,
+                                   AddressPreference preference,
+                                   TtlEventHandler handler) override {
+    (void)domain;
+    (void)preference;
+    handlers_.push_back(handler);
+    cancelables_.emplace_back();
+    return cancelables_.back();
+  }
+
+  size_t count() const { return handlers_.size(); }
+
+  bool canceled(size_t index) const {
+    return cancelables_.at(index).canceled();
+  }
+
+  // Calls the handler even if the query is canceled.
+  void Complete(size_t index, const std::string& ip,
+                std::chrono::seconds ttl = utils::kUnknownTtl) {
+    handlers_.at(index)(
+        std::make_shared<std::vector<boost::asio::ip::address>>(
+            1, boost::asio::ip::address::from_string(ip)),
+        ttl, std::error_code());
+  }
+
+  void Fail(size_t index, std::error_code ec) {
+    handlers_.at(index)(nullptr, std::chrono::seconds(0), ec);
+  }
+
+  void Stop() override {}
+  void Reset() override {}
+  boost::asio::io_context* io() override { return io_; }
+
+ private:
+  boost::asio::io_context* io_;
+  std::vector<TtlEventHandler> handlers_;
+  std::vector<utils::Cancelable> cancelables_;
+};
+
+struct ResolveResult {
+  bool called{false};
+  std::shared_ptr<std::vector<boost::asio::ip::address>> addresses;
+  std::chrono::seconds ttl;
+  std::error_code ec;
+};
+
+// Fills `result` once the handler is called.
+inline utils::Cancelable StartResolve(
+    utils::ResolverInterface* resolver, const std::string& domain,
+    ResolveResult* result,
+    utils::ResolverInterface::AddressPreference preference =
+        utils::ResolverInterface::AddressPreference::IPv4Only) {
+  return resolver->ResolveWithTtl(
+      domain, preference,
+      [result](std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+               std::chrono::seconds ttl,
+               std::error_code ec) { *result = {true, addresses, ttl, ec}; });
+}
+
+// Runs `io` until the handler is called, for at most five seconds.
+inline ResolveResult Resolve(
+    boost::asio::io_context* io, utils::ResolverInterface* resolver,
+    const std::string& domain,
+    utils::ResolverInterface::AddressPreference preference =
+        utils::ResolverInterface::AddressPreference::IPv4Only) {
+  ResolveResult result;
+  auto cancelable = resolver->ResolveWithTtl(
+      domain, preference,
+      [io, &result](
+          std::shared_ptr<std::vector<boost::asio::ip::address>> addresses,
+          std::chrono::seconds ttl, std::error_code ec) {
+        result = {true, addresses, ttl, ec};
+        io->stop();
+      });
+  io->restart();
+  io->run_for(std::chrono::seconds(5));
+  return result;
+}
+
+}  // namespace test
+}  // namespace nekit
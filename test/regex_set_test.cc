@@ -0,0 +1,202 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "nekit/utils/regex_set.h"
+
+using namespace nekit::utils;
+
+namespace {
+const std::vector<std::string> kExpressions{
+    "google\\.com$",
+    "(^|\\.)example\\.org$",
+    "^ads?\\d*\\.",
+    "^(?:www\\.)?face(book)?\\.com$",
+    "track(er|ing)",
+    "[^a-z0-9.-]",
+    "^cdn[0-9]{1,3}\\.",
+    "\\.(cn|ru)$",
+    "a.b",
+    "^x+y*z?$",
+    "\\w+-\\w+\\.net$",
+    "^$",
+    "^[A-F]{4}$",
+    "o{2,}",
+    "(a|^b)(c$|d)",
+    "$^",
+};
+
+const std::vector<std::string> kHosts{
+    "",
+    "google.com",
+    "www.GOOGLE.com",
+    "google.com.hk",
+    "example.org",
+    "badexample.org",
+    "a.example.org",
+    "ads.site.com",
+    "AD12.site.com",
+    "bads.site.com",
+    "facebook.com",
+    "www.face.com",
+    "m.facebook.com",
+    "tracker.io",
+    "trackin.io",
+    "under_score.com",
+    "cdn12.x.com",
+    "cdn1234.x.com",
+    "baidu.cn",
+    "baidu.cn.com",
+    "axb",
+    "ab",
+    "xxyz",
+    "XZ",
+    "xyy z",
+    "foo-bar.net",
+    "foo-.net",
+    "abcd",
+    "abcde",
+    "zoo",
+    "bc",
+    "abd",
+    "xbd",
+    "xac",
+    "xbc",
+};
+
+bool Reference(const std::vector<std::string>& expressions,
+               const std::string& text) {
+  for (const auto& expression : expressions) {
+    std::regex regex(expression, std::regex::ECMAScript | std::regex::icase);
+    if (std::regex_search(text, regex)) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+TEST(RegexSetUnitTest, CompilesCommonExpressions) {
+  RegexSet set(true);
+  for (const auto& expression : kExpressions) {
+    EXPECT_TRUE(set.Add(expression)) << expression;
+  }
+  EXPECT_EQ(set.compiled_count(), kExpressions.size());
+  EXPECT_EQ(set.fallback_count(), 0u);
+}
+
+TEST(RegexSetUnitTest, FallsBackToStdRegex) {
+  RegexSet set(true);
+  EXPECT_TRUE(set.Add("\\bfoo"));
+  EXPECT_TRUE(set.Add("x(?=y)"));
+  EXPECT_TRUE(set.Add("^a(?!b)"));
+  EXPECT_TRUE(set.Add("(^z)"));
+  EXPECT_FALSE(set.Add("("));
+  EXPECT_FALSE(set.Add("[z-a]"));
+  EXPECT_EQ(set.compiled_count(), 1u);
+  EXPECT_EQ(set.fallback_count(), 3u);
+
+  EXPECT_TRUE(set.Search("a.foo"));
+  EXPECT_TRUE(set.Search("xy"));
+  EXPECT_TRUE(set.Search("ac"));
+  EXPECT_TRUE(set.Search("zz"));
+  EXPECT_FALSE(set.Search("ab"));
+  EXPECT_FALSE(set.Search("xfoo"));
+  EXPECT_FALSE(set.Search("bz"));
+}
+
+TEST(RegexSetUnitTest, AgreesWithStdRegex) {
+  for (const auto& expression : kExpressions) {
+    RegexSet set(true);
+    ASSERT_TRUE(set.Add(expression));
+    for (const auto& host : kHosts) {
+      EXPECT_EQ(set.Search(host), Reference({expression}, host))
+          << expression << " " << host;
+    }
+  }
+
+  RegexSet set(true);
+  for (const auto& expression : kExpressions) {
+    set.Add(expression);
+  }
+  for (const auto& host : kHosts) {
+    EXPECT_EQ(set.Search(host), Reference(kExpressions, host)) << host;
+  }
+}
+
+TEST(RegexSetUnitTest, CaseSensitive) {
+  RegexSet set;
+  EXPECT_TRUE(set.Add("^Abc$"));
+  EXPECT_TRUE(set.Search("Abc"));
+  EXPECT_FALSE(set.Search("abc"));
+}
+
+TEST(RegexSetUnitTest, FlushesFullCache) {
+  RegexSet set(true, 4);
+  for (const auto& expression : kExpressions) {
+    set.Add(expression);
+  }
+  for (const auto& host : kHosts) {
+    EXPECT_EQ(set.Search(host), Reference(kExpressions, host)) << host;
+    EXPECT_LE(set.dfa_state_count(), 4u);
+  }
+}
+
+TEST(RegexSetUnitTest, AddAfterSearch) {
+  RegexSet set(true);
+  ASSERT_TRUE(set.Add("^a"));
+  EXPECT_FALSE(set.Search("b.com"));
+  EXPECT_GT(set.dfa_state_count(), 0u);
+  ASSERT_TRUE(set.Add("^b"));
+  EXPECT_TRUE(set.Search("b.com"));
+}
+
+TEST(RegexSetUnitTest, SearchesFromThreads) {
+  RegexSet set(true, 8);
+  for (const auto& expression : kExpressions) {
+    set.Add(expression);
+  }
+  set.Prepare();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&set]() {
+      for (int round = 0; round < 50; round++) {
+        for (const auto& host : kHosts) {
+          EXPECT_EQ(set.Search(host), Reference(kExpressions, host)) << host;
+        }
+      }
+      EXPECT_LE(set.dfa_state_count(), 8u);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // The DFAs of the threads are their own.
+  EXPECT_EQ(set.dfa_state_count(), 0u);
+}
@@ -0,0 +1,120 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <list>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+
+#include "nekit/transport/tcp_socket.h"
+#include "nekit/utils/rotating_device.h"
+#include "nekit/utils/session.h"
+
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+
+TEST(RotatingDeviceUnitTest, RotateTest) {
+  RotatingDevice device{{address::from_string("127.0.0.1"),
+                         address::from_string("127.0.0.2"),
+                         address::from_string("::1")}};
+
+  auto target = address::from_string("10.0.0.1");
+  ASSERT_EQ(device.FindSourceIpToBind(target),
+            address::from_string("127.0.0.1"));
+  ASSERT_EQ(device.FindSourceIpToBind(target),
+            address::from_string("127.0.0.2"));
+  ASSERT_EQ(device.FindSourceIpToBind(target),
+            address::from_string("127.0.0.1"));
+
+  auto target6 = address::from_string("fe80::1");
+  ASSERT_EQ(device.FindSourceIpToBind(target6), address::from_string("::1"));
+  ASSERT_EQ(device.FindSourceIpToBind(target6), address::from_string("::1"));
+}
+
+TEST(RotatingDeviceUnitTest, MissingFamilyTest) {
+  RotatingDevice device{{address::from_string("127.0.0.1")}};
+
+  ASSERT_TRUE(device.FindSourceIpToBind(address::from_string("fe80::1"))
+                  .is_unspecified());
+}
+
+TEST(RotatingDeviceUnitTest, ConcurrentTest) {
+  auto first = address::from_string("127.0.0.2");
+  auto second = address::from_string("127.0.0.3");
+  RotatingDevice device{{first, second}};
+
+  const int count = 10000;
+  std::vector<std::map<address, int>> picked(4);
+  std::vector<std::thread> threads;
+  for (auto& result : picked) {
+    threads.emplace_back([&device, &result]() {
+      auto target = address::from_string("10.0.0.1");
+      for (int i = 0; i < count; i++) {
+        result[device.FindSourceIpToBind(target)]++;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  int total_first = 0, total_second = 0;
+  for (auto& result : picked) {
+    total_first += result[first];
+    total_second += result[second];
+  }
+  ASSERT_EQ(total_first, count * 2);
+  ASSERT_EQ(total_second, count * 2);
+}
+
+TEST(RotatingDeviceUnitTest, TcpSocketTest) {
+  boost::asio::io_context io;
+  tcp::acceptor acceptor{io, {address_v4::loopback(), 0}};
+  auto device = std::make_shared<RotatingDevice>(std::vector<address>{
+      address::from_string("127.0.0.2"), address::from_string("127.0.0.3")});
+
+  std::list<nekit::transport::TcpSocket> sockets;
+  std::vector<address> peers;
+  for (int i = 0; i < 2; i++) {
+    sockets.emplace_back(std::make_shared<Session>(
+        &io, "127.0.0.1", acceptor.local_endpoint().port()));
+    sockets.back().set_device(device);
+    auto cancelable = sockets.back().Connect(
+        [](std::error_code ec) { ASSERT_FALSE(ec); });
+
+    tcp::socket peer{io};
+    acceptor.async_accept(peer, [&peers, &peer](
+                                    const boost::system::error_code& ec) {
+      ASSERT_FALSE(ec);
+      peers.push_back(peer.remote_endpoint().address());
+    });
+    io.restart();
+    io.run();
+  }
+
+  ASSERT_EQ(peers, std::vector<address>({address::from_string("127.0.0.2"),
+                                         address::from_string("127.0.0.3")}));
+}
@@ -0,0 +1,717 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "nekit/rule/all_rule.h"
+#include "nekit/rule/dns_fail_rule.h"
+#include "nekit/rule/domain_affix_rule.h"
+#include "nekit/rule/domain_regex_rule.h"
+#include "nekit/rule/domain_rule.h"
+#include "nekit/rule/rule_manager.h"
+#include "nekit/rule/rule_set_image.h"
+#include "nekit/rule/subnet_rule.h"
+
+using namespace nekit;
+using namespace nekit::rule;
+using namespace boost::asio::ip;
+
+namespace {
+RuleInterface::RuleHandler NullHandler() {
+  return [](std::shared_ptr<utils::Session>) { return nullptr; };
+}
+
+// Resolves every domain to `address`, or fails if it is unspecified.
+class FakeResolver : public utils::ResolverInterface {
+ public:
+  FakeResolver(boost::asio::io_context* io, const std::string& ip)
+      : io_{io}, address_{address::from_string(ip)} {}
+
+  utils::Cancelable Resolve(std::string domain, AddressPreference preference,
+                            EventHandler handler) override {
+    (void)domain;
+    (void)preference;
+    auto address = address_;
+    boost::asio::post(*io_, [handler, address]() {
+      if (address.is_unspecified()) {
+        handler(nullptr, std::make_error_code(std::errc::host_unreachable));
+      } else {
+        handler(std::make_shared<std::vector<boost::asio::ip::address>>(
+                    1, address),
+                std::error_code());
+      }
+    });
+    return utils::Cancelable();
+  }
+
+  void Stop() override {}
+  void Reset() override {}
+  boost::asio::io_context* io() override { return io_; }
+
+ private:
+  boost::asio::io_context* io_;
+  address address_;
+};
+
+// Resolves when `Complete` is called.
+class DeferredResolver : public utils::ResolverInterface {
+ public:
+  explicit DeferredResolver(boost::asio::io_context* io) : io_{io} {}
+
+  utils::Cancelable Resolve(std::string domain, AddressPreference preference,
+                            EventHandler handler) override {
+    (void)domain;
+    (void)preference;
+    handler_ = handler;
+    cancelable_ = utils::Cancelable();
+    count_++;
+    return cancelable_;
+  }
+
+  int count() const { return count_; }
+
+  // Does nothing if the query is canceled.
+  void Complete(const std::string& ip) {
+    if (cancelable_.canceled()) {
+      return;
+    }
+    handler_(std::make_shared<std::vector<boost::asio::ip::address>>(
+                 1, address::from_string(ip)),
+             std::error_code());
+  }
+
+  void Stop() override {}
+  void Reset() override {}
+  boost::asio::io_context* io() override { return io_; }
+
+ private:
+  boost::asio::io_context* io_;
+  EventHandler handler_;
+  utils::Cancelable cancelable_;
+  int count_{0};
+};
+
+std::shared_ptr<RuleInterface> Match(boost::asio::io_context* io,
+                                     RuleManager* manager,
+                                     std::shared_ptr<utils::Session> session) {
+  std::shared_ptr<RuleInterface> result;
+  auto cancelable = manager->Match(
+      session, [&result](std::shared_ptr<RuleInterface> rule,
+                         std::error_code) { result = rule; });
+  io->restart();
+  io->run();
+  return result;
+}
+}  // namespace
+
+TEST(RuleManagerUnitTest, DomainTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+
+  auto regex = std::make_shared<DomainRegexRule>(NullHandler());
+  regex->AddRegex("\\.foo$");
+  auto suffix = std::make_shared<DomainSuffixRule>(NullHandler());
+  suffix->AddSuffix("a.com");
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  domain->AddDomain("a.com");
+  domain->AddDomain("b.com");
+  auto prefix = std::make_shared<DomainPrefixRule>(NullHandler());
+  prefix->AddPrefix("www.");
+  auto all = std::make_shared<AllRule>(NullHandler());
+
+  manager.AppendRule(regex);
+  manager.AppendRule(suffix);
+  manager.AppendRule(domain);
+  manager.AppendRule(prefix);
+  manager.AppendRule(all);
+
+  auto match = [&](const std::string& host) {
+    return Match(&io, &manager, std::make_shared<utils::Session>(&io, host));
+  };
+  ASSERT_EQ(match("www.a.foo"), regex);
+  ASSERT_EQ(match("a.com"), suffix);
+  ASSERT_EQ(match("xa.com"), suffix);
+  ASSERT_EQ(match("b.com"), domain);
+  ASSERT_EQ(match("www.b.org"), prefix);
+  ASSERT_EQ(match("c.org"), all);
+  ASSERT_EQ(Match(&io, &manager,
+                  std::make_shared<utils::Session>(
+                      &io, address::from_string("1.2.3.4"))),
+            all);
+}
+
+TEST(RuleManagerUnitTest, DomainSuffixTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+
+  auto first = std::make_shared<DomainRule>(NullHandler());
+  first->AddSuffix("a.com");
+  first->AddDomain("b.com");
+  auto second = std::make_shared<DomainRule>(NullHandler());
+  second->AddSuffix("com");
+  auto all = std::make_shared<AllRule>(NullHandler());
+
+  manager.AppendRule(first);
+  manager.AppendRule(second);
+  manager.AppendRule(all);
+
+  auto match = [&](const std::string& host) {
+    return Match(&io, &manager, std::make_shared<utils::Session>(&io, host));
+  };
+  ASSERT_EQ(match("a.com"), first);
+  ASSERT_EQ(match("x.y.a.com"), first);
+  ASSERT_EQ(match("xa.com"), second);
+  ASSERT_EQ(match("b.com"), first);
+  ASSERT_EQ(match("x.b.com"), second);
+  ASSERT_EQ(match("a.org"), all);
+
+  // The rule agrees with the index.
+  auto session = std::make_shared<utils::Session>(&io, "x.a.com");
+  ASSERT_EQ(first->Match(session), MatchResult::Match);
+  session = std::make_shared<utils::Session>(&io, "x.b.com");
+  ASSERT_EQ(first->Match(session), MatchResult::NotMatch);
+}
+
+TEST(RuleManagerUnitTest, AddressTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+
+  auto narrow = std::make_shared<SubnetRule>(NullHandler());
+  narrow->AddSubnet(address::from_string("10.1.0.0"), 16);
+  narrow->AddSubnet(address::from_string("2001:db8:1::"), 48);
+  auto wide = std::make_shared<SubnetRule>(NullHandler());
+  wide->AddSubnet(address::from_string("10.0.0.0"), 8);
+  wide->AddSubnet(address::from_string("10.1.2.3"), 32);
+  wide->AddSubnet(address::from_string("2001:db8::"), 32);
+
+  manager.AppendRule(narrow);
+  manager.AppendRule(wide);
+
+  auto match = [&](const std::string& ip) {
+    return Match(&io, &manager, std::make_shared<utils::Session>(
+                                    &io, address::from_string(ip)));
+  };
+  ASSERT_EQ(match("10.1.2.3"), narrow);
+  ASSERT_EQ(match("10.2.0.1"), wide);
+  ASSERT_EQ(match("11.0.0.1"), nullptr);
+  ASSERT_EQ(match("2001:db8:1::1"), narrow);
+  ASSERT_EQ(match("2001:db8:2::1"), wide);
+  ASSERT_EQ(match("2001:db9::1"), nullptr);
+}
+
+TEST(RuleManagerUnitTest, PrefilterTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+  manager.EnablePrefilter(0.01);
+  FakeResolver resolver{&io, "0.0.0.0"};
+
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  auto subnet = std::make_shared<SubnetRule>(NullHandler());
+  for (int i = 0; i < 1000; i++) {
+    domain->AddSuffix("d" + std::to_string(i) + ".com");
+    subnet->AddSubnet(address::from_string("10." + std::to_string(i % 256) +
+                                           ".0.0"),
+                      16 + i % 9);
+  }
+  manager.AppendRule(domain);
+  manager.AppendRule(subnet);
+
+  auto match = [&](std::shared_ptr<utils::Session> session) {
+    return Match(&io, &manager, session);
+  };
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(match(std::make_shared<utils::Session>(
+                  &io, "x.d" + std::to_string(i) + ".com")),
+              domain);
+    // The subnet rule asks to resolve it, and the resolving fails.
+    auto session =
+        std::make_shared<utils::Session>(&io, "d" + std::to_string(i) + ".org");
+    session->set_resolver(&resolver);
+    ASSERT_EQ(match(session), nullptr);
+  }
+  ASSERT_EQ(match(std::make_shared<utils::Session>(
+                &io, address::from_string("10.3.0.1"))),
+            subnet);
+  ASSERT_EQ(match(std::make_shared<utils::Session>(
+                &io, address::from_string("11.3.0.1"))),
+            nullptr);
+}
+
+TEST(RuleManagerUnitTest, RuleSetImageTest) {
+  std::string path =
+      "/tmp/nekit_rule_set_image_" + std::to_string(getpid()) + ".bin";
+  {
+    RuleSetImage::Builder builder;
+    utils::DomainSet domains;
+    domains.AddDomain("a.com");
+    domains.AddSuffix("b.com");
+    builder.AddDomains("domains", domains);
+    utils::CompactTrie suffixes{true};
+    suffixes.AddPrefix(".org");
+    builder.AddTrie("suffixes", &suffixes);
+    utils::SubnetTree subnets;
+    subnets.Insert(address::from_string("10.0.0.0"), 8);
+    builder.AddSubnets("subnets", subnets);
+    builder.AddRegexes("regexes", {"^www\\.", "\\.foo$"});
+    ASSERT_FALSE(builder.Write(path));
+  }
+
+  std::error_code ec;
+  auto image = RuleSetImage::Open(path, ec);
+  ASSERT_FALSE(ec);
+  ASSERT_EQ(image->list_count(), 4u);
+
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+  auto regex = std::make_shared<DomainRegexRule>(NullHandler());
+  ASSERT_TRUE(regex->Load(image, "regexes"));
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  ASSERT_FALSE(domain->Load(image, "suffixes"));
+  ASSERT_TRUE(domain->Load(image, "domains"));
+  auto suffix = std::make_shared<DomainSuffixRule>(NullHandler());
+  ASSERT_TRUE(suffix->Load(image, "suffixes"));
+  auto subnet = std::make_shared<SubnetRule>(NullHandler());
+  ASSERT_TRUE(subnet->Load(image, "subnets"));
+  // A list is used in place after the image is released.
+  image.reset();
+
+  manager.AppendRule(regex);
+  manager.AppendRule(domain);
+  manager.AppendRule(suffix);
+  manager.AppendRule(subnet);
+
+  auto match = [&](const std::string& host) {
+    return Match(&io, &manager, std::make_shared<utils::Session>(&io, host));
+  };
+  ASSERT_EQ(match("www.c.net"), regex);
+  ASSERT_EQ(match("a.foo"), regex);
+  ASSERT_EQ(match("a.com"), domain);
+  ASSERT_EQ(match("x.b.com"), domain);
+  ASSERT_EQ(match("a.org"), suffix);
+  ASSERT_EQ(Match(&io, &manager,
+                  std::make_shared<utils::Session>(
+                      &io, address::from_string("10.1.2.3"))),
+            subnet);
+  ASSERT_EQ(Match(&io, &manager,
+                  std::make_shared<utils::Session>(
+                      &io, address::from_string("11.1.2.3"))),
+            nullptr);
+
+  std::remove(path.c_str());
+}
+
+TEST(RuleManagerUnitTest, InvalidRuleSetImageTest) {
+  std::string path =
+      "/tmp/nekit_invalid_rule_set_image_" + std::to_string(getpid()) + ".bin";
+  std::ofstream(path) << "not a rule set image";
+
+  std::error_code ec;
+  ASSERT_FALSE(RuleSetImage::Open(path, ec));
+  ASSERT_TRUE(ec);
+
+  std::remove(path.c_str());
+}
+
+TEST(RuleManagerUnitTest, ResolveTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  domain->AddDomain("a.com");
+  auto subnet = std::make_shared<SubnetRule>(NullHandler());
+  subnet->AddSubnet(address::from_string("127.0.0.0"), 8);
+  auto dns_fail = std::make_shared<DnsFailRule>(NullHandler());
+  auto all = std::make_shared<AllRule>(NullHandler());
+
+  manager.AppendRule(domain);
+  manager.AppendRule(subnet);
+  manager.AppendRule(dns_fail);
+  manager.AppendRule(all);
+
+  auto match = [&](const std::string& host, FakeResolver* resolver) {
+    auto session = std::make_shared<utils::Session>(&io, host);
+    session->set_resolver(resolver);
+    return Match(&io, &manager, session);
+  };
+
+  FakeResolver loopback{&io, "127.0.0.1"};
+  ASSERT_EQ(match("a.com", &loopback), domain);
+  ASSERT_EQ(match("b.com", &loopback), subnet);
+
+  FakeResolver other{&io, "8.8.8.8"};
+  ASSERT_EQ(match("b.com", &other), all);
+
+  FakeResolver failing{&io, "0.0.0.0"};
+  ASSERT_EQ(match("b.com", &failing), dns_fail);
+}
+
+TEST(RuleManagerUnitTest, PublishTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+  manager.EnableDecisionCache();
+
+  auto old_subnet = std::make_shared<SubnetRule>(NullHandler());
+  old_subnet->AddSubnet(address::from_string("127.0.0.0"), 8);
+  std::weak_ptr<RuleInterface> old_rule = old_subnet;
+  manager.AppendRule(old_subnet);
+  old_subnet.reset();
+
+  // Starts a match that waits for resolution.
+  DeferredResolver resolver{&io};
+  auto session = std::make_shared<utils::Session>(&io, "a.com");
+  session->set_resolver(&resolver);
+  std::shared_ptr<RuleInterface> result;
+  auto cancelable = manager.Match(
+      session, [&result](std::shared_ptr<RuleInterface> rule,
+                         std::error_code) { result = rule; });
+  io.run();
+
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  domain->AddDomain("a.com");
+  manager.Publish(std::make_shared<RuleSnapshot>(
+      std::vector<std::shared_ptr<RuleInterface>>{domain}));
+  io.restart();
+  io.run();
+  ASSERT_EQ(manager.snapshot()->size(), 1u);
+  ASSERT_EQ(manager.snapshot()->rules()[0], domain);
+
+  // The match started before goes on with the old rules.
+  ASSERT_FALSE(old_rule.expired());
+  resolver.Complete("127.0.0.1");
+  io.restart();
+  io.run();
+  ASSERT_EQ(result, old_rule.lock());
+  result.reset();
+  ASSERT_TRUE(old_rule.expired());
+  ASSERT_EQ(manager.decision_cache()->size(), 0u);
+
+  auto match = [&](const std::string& host) {
+    return Match(&io, &manager, std::make_shared<utils::Session>(&io, host));
+  };
+  ASSERT_EQ(match("a.com"), domain);
+
+  // Published from another thread.
+  auto all = std::make_shared<AllRule>(NullHandler());
+  std::thread([&manager, all]() {
+    manager.Publish(std::make_shared<RuleSnapshot>(
+        std::vector<std::shared_ptr<RuleInterface>>{all}));
+  }).join();
+  ASSERT_EQ(match("a.com"), all);
+
+  // Appending adds to the published rules.
+  manager.AppendRule(domain);
+  ASSERT_EQ(manager.snapshot()->size(), 2u);
+}
+
+TEST(RuleManagerUnitTest, SpeculativeResolutionTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+  manager.EnableSpeculativeResolution();
+
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  domain->AddDomain("a.com");
+  auto subnet = std::make_shared<SubnetRule>(NullHandler());
+  subnet->AddSubnet(address::from_string("127.0.0.0"), 8);
+  manager.AppendRule(domain);
+  manager.AppendRule(subnet);
+
+  auto start = [&](const std::string& host, DeferredResolver* resolver,
+                   std::shared_ptr<RuleInterface>* result) {
+    auto session = std::make_shared<utils::Session>(&io, host);
+    session->set_resolver(resolver);
+    auto cancelable = manager.Match(
+        session, [result](std::shared_ptr<RuleInterface> rule,
+                          std::error_code) { *result = rule; });
+    return session;
+  };
+
+  // The resolution starts with the match, which does not wait for it.
+  DeferredResolver first{&io};
+  std::shared_ptr<RuleInterface> result;
+  auto session = start("a.com", &first, &result);
+  ASSERT_EQ(first.count(), 1);
+  io.run();
+  ASSERT_EQ(result, domain);
+  ASSERT_TRUE(session->endpoint()->IsResolving());
+
+  // The address rule and a later caller wait for the same resolution.
+  DeferredResolver second{&io};
+  result.reset();
+  session = start("b.com", &second, &result);
+  io.restart();
+  io.run();
+  ASSERT_EQ(result, nullptr);
+  bool waited = false;
+  auto cancelable = session->endpoint()->WaitResolved(
+      [&waited](std::error_code ec) { waited = !ec; });
+  second.Complete("127.0.0.1");
+  io.restart();
+  io.run();
+  ASSERT_EQ(second.count(), 1);
+  ASSERT_EQ(result, subnet);
+  ASSERT_TRUE(waited);
+}
+
+TEST(RuleManagerUnitTest, WaitResolvedCancelTest) {
+  boost::asio::io_context io;
+  DeferredResolver resolver{&io};
+  utils::Endpoint endpoint{"a.com", 80};
+  endpoint.set_resolver(&resolver);
+
+  // Canceling the waiter that started the resolution only drops its handler.
+  bool first = false, second = false;
+  auto first_cancelable =
+      endpoint.WaitResolved([&first](std::error_code) { first = true; });
+  auto second_cancelable = endpoint.WaitResolved(
+      [&second](std::error_code ec) { second = !ec; });
+  first_cancelable.Cancel();
+
+  ASSERT_EQ(resolver.count(), 1);
+  resolver.Complete("127.0.0.1");
+  io.run();
+  ASSERT_FALSE(first);
+  ASSERT_TRUE(second);
+  ASSERT_FALSE(endpoint.IsResolving());
+  ASSERT_TRUE(endpoint.IsAddressAvailable());
+}
+
+TEST(RuleManagerUnitTest, ResolveCancelTest) {
+  boost::asio::io_context io;
+  DeferredResolver resolver{&io};
+  utils::Endpoint endpoint{"a.com", 80};
+  endpoint.set_resolver(&resolver);
+
+  // Canceling the caller of `Resolve` leaves the resolution to the waiter.
+  bool first = false, second = false;
+  auto first_cancelable =
+      endpoint.Resolve([&first](std::error_code) { first = true; });
+  auto second_cancelable = endpoint.WaitResolved(
+      [&second](std::error_code ec) { second = !ec; });
+  first_cancelable.Cancel();
+  ASSERT_TRUE(endpoint.IsResolving());
+
+  resolver.Complete("127.0.0.1");
+  io.run();
+  ASSERT_FALSE(first);
+  ASSERT_TRUE(second);
+  ASSERT_FALSE(endpoint.IsResolving());
+  ASSERT_TRUE(endpoint.IsAddressAvailable());
+
+  // Once every caller cancels, so does the resolution, and the next caller
+  // starts another one.
+  utils::Endpoint other{"b.com", 80};
+  other.set_resolver(&resolver);
+  first = second = false;
+  first_cancelable =
+      other.Resolve([&first](std::error_code) { first = true; });
+  second_cancelable =
+      other.WaitResolved([&second](std::error_code) { second = true; });
+  first_cancelable.Cancel();
+  second_cancelable.Cancel();
+  ASSERT_FALSE(other.IsResolving());
+  ASSERT_FALSE(other.IsResolved());
+  resolver.Complete("127.0.0.1");
+  io.restart();
+  io.run();
+  ASSERT_FALSE(first);
+  ASSERT_FALSE(second);
+
+  auto third_cancelable = other.WaitResolved(
+      [&second](std::error_code ec) { second = !ec; });
+  ASSERT_EQ(resolver.count(), 3);
+  resolver.Complete("127.0.0.2");
+  io.restart();
+  io.run();
+  ASSERT_TRUE(second);
+  ASSERT_EQ(other.address(), address::from_string("127.0.0.2"));
+}
+
+TEST(RuleManagerUnitTest, ProfileTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+  manager.EnableProfiling(1);
+
+  auto regex = std::make_shared<DomainRegexRule>(NullHandler());
+  regex->AddRegex("\\.foo$");
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  domain->AddSuffix("a.com");
+  auto all = std::make_shared<AllRule>(NullHandler());
+  manager.AppendRule(regex);
+  manager.AppendRule(domain);
+  manager.AppendRule(all);
+
+  auto match = [&](const std::string& host) {
+    return Match(&io, &manager, std::make_shared<utils::Session>(&io, host));
+  };
+  ASSERT_EQ(match("x.foo"), regex);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(match("x.a.com"), domain);
+    ASSERT_EQ(match("b.com"), all);
+  }
+
+  auto profiles = manager.Profile();
+  ASSERT_EQ(profiles.size(), 3u);
+  ASSERT_EQ(profiles[0].rule, regex);
+  ASSERT_FALSE(profiles[0].indexed);
+  ASSERT_EQ(profiles[0].matches, 1u);
+  ASSERT_EQ(profiles[0].not_matches, 6u);
+  ASSERT_EQ(profiles[0].samples, 7u);
+  ASSERT_TRUE(profiles[1].indexed);
+  ASSERT_EQ(profiles[1].matches, 3u);
+  ASSERT_EQ(profiles[2].matches, 3u);
+  ASSERT_EQ(profiles[2].not_matches, 0u);
+
+  // The indexed rule goes first and the rule that always matches before the
+  // regex, unless they can not be swapped.
+  auto any = [](const RuleInterface&, const RuleInterface&) { return true; };
+  ASSERT_EQ(SuggestRuleOrder(profiles, any), (std::vector<size_t>{1, 2, 0}));
+  auto pinned_all = [&all](const RuleInterface&, const RuleInterface& after) {
+    return &after != all.get();
+  };
+  ASSERT_EQ(SuggestRuleOrder(profiles, pinned_all),
+            (std::vector<size_t>{1, 0, 2}));
+  ASSERT_NE(RuleProfileReport(profiles, any).find("indexed"),
+            std::string::npos);
+
+  // Counting restarts with new rules.
+  manager.AppendRule(all);
+  ASSERT_EQ(match("b.com"), all);
+  profiles = manager.Profile();
+  ASSERT_EQ(profiles.size(), 4u);
+  ASSERT_EQ(profiles[0].not_matches, 1u);
+  ASSERT_EQ(profiles[2].matches, 1u);
+
+  // Cached decisions count as matches without evaluating any rule.
+  manager.EnableDecisionCache(16);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(match("x.a.com"), domain);
+  }
+  profiles = manager.Profile();
+  ASSERT_EQ(profiles[0].not_matches, 2u);
+  ASSERT_EQ(profiles[1].matches, 3u);
+}
+
+TEST(RuleManagerUnitTest, DecisionCacheTest) {
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+  manager.EnableDecisionCache(16);
+
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  domain->AddDomain("a.com");
+  auto subnet = std::make_shared<SubnetRule>(NullHandler());
+  subnet->AddSubnet(address::from_string("127.0.0.0"), 8);
+  auto all = std::make_shared<AllRule>(NullHandler());
+
+  manager.AppendRule(domain);
+  manager.AppendRule(subnet);
+  manager.AppendRule(all);
+
+  FakeResolver resolver{&io, "127.0.0.1"};
+  auto match = [&](const std::string& host) {
+    auto session = std::make_shared<utils::Session>(&io, host);
+    session->set_resolver(&resolver);
+    return Match(&io, &manager, session);
+  };
+
+  ASSERT_EQ(match("a.com"), domain);
+  ASSERT_EQ(match("a.com"), domain);
+  // Depends on the resolved address.
+  ASSERT_EQ(match("b.com"), subnet);
+  ASSERT_EQ(match("b.com"), subnet);
+  ASSERT_EQ(Match(&io, &manager,
+                  std::make_shared<utils::Session>(
+                      &io, address::from_string("10.0.0.1"))),
+            all);
+  ASSERT_EQ(Match(&io, &manager,
+                  std::make_shared<utils::Session>(
+                      &io, address::from_string("10.0.0.1"))),
+            all);
+
+  auto cache = manager.decision_cache();
+  ASSERT_EQ(cache->size(), 2);
+  ASSERT_EQ(cache->statistics().hits, 2);
+  ASSERT_EQ(cache->statistics().misses, 4);
+  ASSERT_EQ(cache->statistics().uncacheable, 2);
+  ASSERT_DOUBLE_EQ(cache->hit_ratio(), 2.0 / 6);
+
+  manager.AppendRule(all);
+  ASSERT_EQ(cache->size(), 0);
+}
+
+TEST(RuleManagerUnitTest, DecisionCacheRuleSetImageTest) {
+  std::string path =
+      "/tmp/nekit_decision_cache_image_" + std::to_string(getpid()) + ".bin";
+  {
+    RuleSetImage::Builder builder;
+    utils::DomainSet domains;
+    domains.AddDomain("a.com");
+    builder.AddDomains("domains", domains);
+    utils::CompactTrie suffixes{true};
+    suffixes.AddPrefix(".org");
+    builder.AddTrie("suffixes", &suffixes);
+    ASSERT_FALSE(builder.Write(path));
+  }
+
+  std::error_code ec;
+  auto image = RuleSetImage::Open(path, ec);
+  ASSERT_FALSE(ec);
+
+  boost::asio::io_context io;
+  RuleManager manager{&io};
+  manager.EnableDecisionCache(16);
+
+  // Loaded rules are matched by `Match` and still cached.
+  auto domain = std::make_shared<DomainRule>(NullHandler());
+  ASSERT_TRUE(domain->Load(image, "domains"));
+  auto suffix = std::make_shared<DomainSuffixRule>(NullHandler());
+  ASSERT_TRUE(suffix->Load(image, "suffixes"));
+  auto all = std::make_shared<AllRule>(NullHandler());
+  image.reset();
+
+  manager.AppendRule(domain);
+  manager.AppendRule(suffix);
+  manager.AppendRule(all);
+
+  auto match = [&](const std::string& host) {
+    return Match(&io, &manager, std::make_shared<utils::Session>(&io, host));
+  };
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(match("a.com"), domain);
+    ASSERT_EQ(match("a.org"), suffix);
+    ASSERT_EQ(match("b.net"), all);
+  }
+
+  auto cache = manager.decision_cache();
+  ASSERT_EQ(cache->size(), 3);
+  ASSERT_EQ(cache->statistics().hits, 3);
+  ASSERT_EQ(cache->statistics().misses, 3);
+  ASSERT_EQ(cache->statistics().uncacheable, 0);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,182 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include "fake_dns_server.h"
+#include "fake_resolver.h"
+#include "nekit/utils/stub_resolver.h"
+
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+using Preference = ResolverInterface::AddressPreference;
+using nekit::test::Resolve;
+
+TEST(StubResolverUnitTest, ResolveTest) {
+  boost::asio::io_context io;
+  nekit::test::FakeDnsServer server{&io};
+  server.AddRecord("example.com", "1.2.3.4", 300);
+  server.AddRecord("example.com", "1.2.3.5", 100);
+  server.AddRecord("example.com", "::1", 300);
+
+  StubResolver resolver{&io, {server.endpoint()}};
+  auto result = Resolve(&io, &resolver, "Example.COM.");
+  ASSERT_TRUE(result.called);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->size(), 2);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("1.2.3.4"));
+  ASSERT_EQ(result.addresses->at(1), address::from_string("1.2.3.5"));
+  ASSERT_EQ(result.ttl.count(), 100);
+
+  result = Resolve(&io, &resolver, "example.com", Preference::IPv6Only);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->size(), 1);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("::1"));
+}
+
+TEST(StubResolverUnitTest, NameErrorTest) {
+  boost::asio::io_context io;
+  nekit::test::FakeDnsServer server{&io};
+  server.AddRecord("v6.example.com", "::1", 300);
+
+  StubResolver resolver{&io, {server.endpoint()}};
+  auto result = Resolve(&io, &resolver, "nx.example.com");
+  ASSERT_EQ(result.ec, StubResolver::ErrorCode::NameError);
+  ASSERT_EQ(server.udp_queries(), 1);
+
+  result = Resolve(&io, &resolver, "v6.example.com");
+  ASSERT_EQ(result.ec, StubResolver::ErrorCode::NoData);
+
+  result = Resolve(&io, &resolver, "invalid..example.com");
+  ASSERT_EQ(result.ec, StubResolver::ErrorCode::InvalidName);
+}
+
+TEST(StubResolverUnitTest, TcpFallbackTest) {
+  boost::asio::io_context io;
+  nekit::test::FakeDnsServer server{&io};
+  server.AddRecord("example.com", "1.2.3.4", 300);
+  server.set_truncate_udp(true);
+
+  StubResolver resolver{&io, {server.endpoint()}};
+  auto result = Resolve(&io, &resolver, "example.com");
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("1.2.3.4"));
+  ASSERT_EQ(server.udp_queries(), 1);
+  ASSERT_EQ(server.tcp_queries(), 1);
+}
+
+TEST(StubResolverUnitTest, RetryTest) {
+  boost::asio::io_context io;
+  nekit::test::FakeDnsServer dead{&io}, server{&io};
+  dead.set_drop(100);
+  server.AddRecord("example.com", "1.2.3.4", 300);
+
+  StubResolver resolver{&io, {dead.endpoint(), server.endpoint()}};
+  resolver.set_timeout(std::chrono::milliseconds(50));
+  auto result = Resolve(&io, &resolver, "example.com");
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(dead.udp_queries(), 1);
+  ASSERT_EQ(server.udp_queries(), 1);
+
+  StubResolver dead_resolver{&io, {dead.endpoint()}};
+  dead_resolver.set_timeout(std::chrono::milliseconds(50));
+  dead_resolver.set_attempts(3);
+  result = Resolve(&io, &dead_resolver, "example.com");
+  ASSERT_EQ(result.ec, StubResolver::ErrorCode::TimedOut);
+  ASSERT_EQ(dead.udp_queries(), 4);
+}
+
+TEST(StubResolverUnitTest, NoServerTest) {
+  boost::asio::io_context io;
+
+  StubResolver resolver{&io, {}};
+  bool called = false;
+  std::error_code error;
+  auto cancelable = resolver.ResolveWithTtl(
+      "example.com", Preference::IPv6,
+      [&called, &error](std::shared_ptr<std::vector<address>>,
+                        std::chrono::seconds, std::error_code ec) {
+        called = true;
+        error = ec;
+      });
+  ASSERT_FALSE(called);
+
+  io.run_for(std::chrono::milliseconds(200));
+  ASSERT_TRUE(called);
+  ASSERT_EQ(error, StubResolver::ErrorCode::TimedOut);
+}
+
+TEST(StubResolverUnitTest, CancelTest) {
+  boost::asio::io_context io;
+  nekit::test::FakeDnsServer server{&io};
+  server.AddRecord("example.com", "1.2.3.4", 300);
+
+  StubResolver resolver{&io, {server.endpoint()}};
+  bool called = false;
+  auto cancelable = resolver.Resolve(
+      "example.com", Preference::IPv4Only,
+      [&called](std::shared_ptr<std::vector<address>>, std::error_code) {
+        called = true;
+      });
+  cancelable.Cancel();
+  io.run_for(std::chrono::milliseconds(200));
+  ASSERT_FALSE(called);
+}
+
+TEST(StubResolverUnitTest, DualStackTest) {
+  boost::asio::io_context io;
+  nekit::test::FakeDnsServer server{&io};
+  server.AddRecord("example.com", "1.2.3.4", 300);
+  server.AddRecord("example.com", "::1", 100);
+  server.AddRecord("v4.example.com", "1.2.3.4", 300);
+
+  StubResolver resolver{&io, {server.endpoint()}};
+  auto result = Resolve(&io, &resolver, "example.com", Preference::IPv6);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->size(), 2);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("::1"));
+  ASSERT_EQ(result.addresses->at(1), address::from_string("1.2.3.4"));
+  ASSERT_EQ(result.ttl.count(), 100);
+
+  result = Resolve(&io, &resolver, "example.com", Preference::IPv4);
+  ASSERT_EQ(result.addresses->size(), 2);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("1.2.3.4"));
+
+  // The missing family does not fail the query.
+  result = Resolve(&io, &resolver, "v4.example.com", Preference::IPv6);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->size(), 1);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("1.2.3.4"));
+
+  // Do not wait for a slow family once the preferred one answered.
+  server.set_aaaa_delay(std::chrono::milliseconds(1000));
+  resolver.set_dual_stack_grace(std::chrono::milliseconds(20));
+  result = Resolve(&io, &resolver, "example.com", Preference::IPv4);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->size(), 1);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("1.2.3.4"));
+
+  // But wait for the preferred family.
+  result = Resolve(&io, &resolver, "example.com", Preference::IPv6);
+  ASSERT_EQ(result.addresses->size(), 2);
+  ASSERT_EQ(result.addresses->at(0), address::from_string("::1"));
+}
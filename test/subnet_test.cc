@@ -20,11 +20,17 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <boost/asio/ip/address.hpp>
 
 #include "nekit/utils/subnet.h"
+#include "nekit/utils/subnet_tree.h"
 
 using namespace nekit::utils;
 using namespace boost::asio::ip;
@@ -82,3 +88,102 @@ TEST(SubnetUnitTest, Ipv6AlignedSubnetTest) {
       subnet.Contains(address::from_string("fe80::1f:ffff:ffff:ffff:ffff")));
   ASSERT_FALSE(subnet.Contains(address::from_string("127.0.0.1")));
 }
+
+TEST(SubnetTreeUnitTest, Ipv4Test) {
+  SubnetTree tree;
+  tree.Insert(address::from_string("10.0.0.0"), 8, 1);
+  tree.Insert(address::from_string("10.1.2.3"), 16, 2);
+  tree.Insert(address::from_string("10.1.2.3"), 32, 3);
+  tree.Insert(address::from_string("10.128.0.0"), 9, 4);
+  ASSERT_EQ(tree.size(), 4);
+
+  uint32_t value;
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("10.1.2.3"), &value));
+  ASSERT_EQ(value, 3);
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("10.1.2.4"), &value));
+  ASSERT_EQ(value, 2);
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("10.200.0.1"), &value));
+  ASSERT_EQ(value, 4);
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("10.2.0.1"), &value));
+  ASSERT_EQ(value, 1);
+  ASSERT_FALSE(tree.Contains(address::from_string("11.0.0.1")));
+  ASSERT_FALSE(tree.Contains(address::from_string("::a01:203")));
+
+  std::vector<unsigned> prefixes;
+  tree.ForEachMatch(address::from_string("10.1.2.3"),
+                    [&prefixes](unsigned prefix, uint32_t) {
+                      prefixes.push_back(prefix);
+                    });
+  ASSERT_EQ(prefixes, (std::vector<unsigned>{8, 16, 32}));
+
+  // The lower value is kept.
+  tree.Insert(address::from_string("10.0.0.0"), 8, 0);
+  tree.Insert(address::from_string("10.0.0.0"), 8, 5);
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("10.2.0.1"), &value));
+  ASSERT_EQ(value, 0);
+  ASSERT_EQ(tree.size(), 4);
+}
+
+TEST(SubnetTreeUnitTest, Ipv6Test) {
+  SubnetTree tree;
+  tree.Insert(address::from_string("fe80::"), 60, 1);
+  tree.Insert(address::from_string("fe80::"), 64, 2);
+  tree.Insert(address::from_string("2001:db8::1"), 128, 3);
+  tree.Insert(address::from_string("::"), 0, 4);
+
+  uint32_t value;
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("fe80::1"), &value));
+  ASSERT_EQ(value, 2);
+  ASSERT_TRUE(tree.LongestMatch(
+      address::from_string("fe80::f:ffff:ffff:ffff:ffff"), &value));
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("2001:db8::1"), &value));
+  ASSERT_EQ(value, 3);
+  ASSERT_TRUE(tree.LongestMatch(address::from_string("2001:db8::2"), &value));
+  ASSERT_EQ(value, 4);
+  ASSERT_FALSE(tree.Contains(address::from_string("127.0.0.1")));
+
+  size_t count = 0;
+  tree.ForEach([&count](const address& network, unsigned prefix, uint32_t) {
+    if (prefix == 128) {
+      EXPECT_EQ(network, address::from_string("2001:db8::1"));
+    }
+    count++;
+  });
+  ASSERT_EQ(count, 4);
+}
+
+TEST(SubnetTreeUnitTest, SaveMapTest) {
+  SubnetTree tree;
+  tree.Insert(address::from_string("10.0.0.0"), 8, 1);
+  tree.Insert(address::from_string("10.1.0.0"), 16, 2);
+  tree.Insert(address::from_string("2001:db8::"), 32, 3);
+  std::string saved;
+  tree.Save(&saved);
+
+  auto buffer = std::make_shared<std::vector<uint64_t>>(saved.size() / 8 + 1);
+  std::memcpy(buffer->data(), saved.data(), saved.size());
+
+  SubnetTree mapped;
+  ASSERT_TRUE(mapped.Map(buffer->data(), saved.size(), buffer));
+  EXPECT_TRUE(mapped.mapped());
+  EXPECT_EQ(mapped.size(), 3u);
+  uint32_t value;
+  ASSERT_TRUE(mapped.LongestMatch(address::from_string("10.1.2.3"), &value));
+  EXPECT_EQ(value, 2u);
+  ASSERT_TRUE(mapped.LongestMatch(address::from_string("2001:db8::1"), &value));
+  EXPECT_EQ(value, 3u);
+  EXPECT_FALSE(mapped.Contains(address::from_string("11.0.0.1")));
+
+  mapped.Insert(address::from_string("11.0.0.0"), 8, 4);
+  EXPECT_FALSE(mapped.mapped());
+  EXPECT_TRUE(mapped.Contains(address::from_string("11.0.0.1")));
+  EXPECT_TRUE(mapped.Contains(address::from_string("10.0.0.1")));
+
+  SubnetTree invalid;
+  EXPECT_FALSE(invalid.Map(buffer->data(), saved.size() - 8, buffer));
+  // Set `has_value` of the third node to something other than 0 or 1.
+  reinterpret_cast<char*>(buffer->data())[16 + 2 * 32 + 29] = 2;
+  EXPECT_FALSE(invalid.Map(buffer->data(), saved.size(), buffer));
+  EXPECT_FALSE(invalid.mapped());
+}
@@ -0,0 +1,133 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "fake_resolver.h"
+#include "nekit/utils/system_resolver.h"
+
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+using Preference = ResolverInterface::AddressPreference;
+using nekit::test::Resolve;
+
+TEST(SystemResolverUnitTest, ResolveTest) {
+  boost::asio::io_context io;
+  SystemResolver resolver{&io, 1, 2};
+
+  auto result = Resolve(&io, &resolver, "127.0.0.1");
+  ASSERT_TRUE(result.called);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.addresses->front(), address::from_string("127.0.0.1"));
+
+  auto statistics = resolver.statistics();
+  ASSERT_EQ(statistics.completed, 1);
+  ASSERT_EQ(statistics.queue_depth, 0);
+  ASSERT_GE(statistics.threads, 1);
+}
+
+TEST(SystemResolverUnitTest, IdleTimeoutTest) {
+  boost::asio::io_context io;
+  SystemResolver resolver{&io, 0, 1};
+  resolver.set_idle_timeout(std::chrono::milliseconds(10));
+  resolver.set_timeout(std::chrono::milliseconds(1000));
+
+  // Lookups made around the time the idle thread exits are still run.
+  for (int i = 0; i < 20; i++) {
+    auto result = Resolve(&io, &resolver, "127.0.0.1");
+    ASSERT_TRUE(result.called);
+    ASSERT_FALSE(result.ec);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_EQ(resolver.statistics().threads, 0);
+  auto result = Resolve(&io, &resolver, "127.0.0.1");
+  ASSERT_FALSE(result.ec);
+}
+
+TEST(SystemResolverUnitTest, QueueFullTest) {
+  boost::asio::io_context io;
+  SystemResolver resolver{&io, 1};
+  resolver.set_queue_limit(0);
+
+  auto result = Resolve(&io, &resolver, "127.0.0.1");
+  ASSERT_TRUE(result.called);
+  ASSERT_EQ(result.ec, SystemResolver::ErrorCode::QueueFull);
+  ASSERT_EQ(resolver.statistics().rejected, 1);
+}
+
+TEST(SystemResolverUnitTest, TimeoutTest) {
+  boost::asio::io_context io;
+  SystemResolver resolver{&io, 1};
+  resolver.set_timeout(std::chrono::milliseconds(0));
+
+  auto result = Resolve(&io, &resolver, "127.0.0.1");
+  ASSERT_TRUE(result.called);
+  ASSERT_EQ(result.ec, SystemResolver::ErrorCode::TimedOut);
+  ASSERT_EQ(resolver.statistics().timed_out, 1);
+}
+
+TEST(SystemResolverUnitTest, CancelTest) {
+  boost::asio::io_context io;
+  SystemResolver resolver{&io, 1};
+
+  bool called = false;
+  auto cancelable = resolver.Resolve(
+      "127.0.0.1", Preference::Any,
+      [&called](std::shared_ptr<std::vector<address>>, std::error_code) {
+        called = true;
+      });
+  cancelable.Cancel();
+  io.run();
+  ASSERT_FALSE(called);
+  ASSERT_EQ(resolver.statistics().queue_depth, 0);
+}
+
+TEST(SystemResolverUnitTest, CancelQueuedTest) {
+  boost::asio::io_context io;
+  SystemResolver resolver{&io, 1};
+
+  // The worker keeps running lookups while the queued ones are canceled.
+  const size_t count = 1000;
+  size_t called = 0;
+  std::vector<Cancelable> cancelables;
+  for (size_t i = 0; i < count; i++) {
+    cancelables.push_back(resolver.Resolve(
+        "127.0.0.1", Preference::IPv4Only,
+        [&called](std::shared_ptr<std::vector<address>>, std::error_code) {
+          called++;
+        }));
+  }
+  for (auto& cancelable : cancelables) {
+    cancelable.Cancel();
+  }
+
+  auto statistics = resolver.statistics();
+  ASSERT_EQ(statistics.queue_depth, 0);
+  ASSERT_LE(statistics.completed + statistics.canceled, count);
+
+  io.run();
+  ASSERT_EQ(called, 0);
+}
@@ -0,0 +1,254 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <sys/resource.h>
+#include <unistd.h>
+#include <functional>
+#include <list>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "nekit/transport/tcp_connection_pool.h"
+#include "nekit/transport/tcp_socket.h"
+#include "nekit/utils/session.h"
+
+using namespace nekit::transport;
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+
+namespace {
+// Accepts every connection on loopback and keeps it open.
+class Server {
+ public:
+  explicit Server(boost::asio::io_context* io) : acceptor_{*io} {
+    acceptor_.open(tcp::v4());
+    acceptor_.bind({address_v4::loopback(), 0});
+    acceptor_.listen();
+    Accept();
+  }
+
+  uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+  std::list<tcp::socket>& sockets() { return sockets_; }
+
+ private:
+  void Accept() {
+    acceptor_.async_accept([this](const boost::system::error_code& ec,
+                                  tcp::socket socket) {
+      if (ec) {
+        return;
+      }
+      sockets_.push_back(std::move(socket));
+      Accept();
+    });
+  }
+
+  tcp::acceptor acceptor_;
+  std::list<tcp::socket> sockets_;
+};
+
+bool RunUntil(boost::asio::io_context* io, std::function<bool()> done) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    io->restart();
+    io->run_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+}  // namespace
+
+TEST(TcpConnectionPoolUnitTest, TakeSkipsClosedTest) {
+  boost::asio::io_context io;
+  Server server{&io};
+  TcpConnectionPool pool{&io, nullptr, 2};
+  pool.Add("127.0.0.1", server.port());
+
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 2 &&
+           server.sockets().size() == 2;
+  }));
+
+  // The pool has not seen the close yet, `Take` has to check by itself.
+  for (auto& socket : server.sockets()) {
+    socket.close();
+  }
+  server.sockets().clear();
+
+  Endpoint endpoint{"127.0.0.1", server.port()};
+  tcp::socket socket{io};
+  ASSERT_FALSE(pool.Take(endpoint, &socket));
+  ASSERT_EQ(pool.statistics().broken, 2);
+  ASSERT_EQ(pool.statistics().misses, 1);
+  ASSERT_EQ(pool.IdleCount("127.0.0.1", server.port()), 0);
+
+  // The pool refills after the miss.
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 2;
+  }));
+  ASSERT_TRUE(pool.Take(endpoint, &socket));
+  ASSERT_EQ(pool.statistics().hits, 1);
+  ASSERT_EQ(socket.remote_endpoint().port(), server.port());
+}
+
+TEST(TcpConnectionPoolUnitTest, WatchTest) {
+  boost::asio::io_context io;
+  Server server{&io};
+  TcpConnectionPool pool{&io, nullptr, 1};
+  pool.Add("127.0.0.1", server.port());
+
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 1 &&
+           server.sockets().size() == 1;
+  }));
+
+  server.sockets().front().close();
+
+  // The broken connection is dropped and replaced in background.
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.statistics().broken == 1 && server.sockets().size() == 2 &&
+           pool.IdleCount("127.0.0.1", server.port()) == 1;
+  }));
+}
+
+TEST(TcpConnectionPoolUnitTest, IdleSweepTest) {
+  boost::asio::io_context io;
+  Server server{&io};
+  TcpConnectionPool pool{&io, nullptr, 2};
+  pool.set_idle_timeout(std::chrono::milliseconds(100));
+  pool.Add("127.0.0.1", server.port());
+
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 2;
+  }));
+  ASSERT_EQ(pool.statistics().expired, 0);
+
+  // Expired connections are closed and replaced by new ones.
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.statistics().expired >= 2 && server.sockets().size() >= 4 &&
+           pool.IdleCount("127.0.0.1", server.port()) == 2;
+  }));
+  ASSERT_EQ(pool.statistics().broken, 0);
+}
+
+TEST(TcpConnectionPoolUnitTest, SocketConnectTest) {
+  boost::asio::io_context io;
+  Server server{&io};
+  TcpConnectionPool pool{&io, nullptr, 1};
+  pool.Add("127.0.0.1", server.port());
+
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 1;
+  }));
+
+  TcpSocket socket{std::make_shared<Session>(&io, "127.0.0.1", server.port())};
+  socket.set_connection_pool(&pool);
+
+  bool called = false;
+  auto cancelable = socket.Connect([&called](std::error_code ec) {
+    ASSERT_FALSE(ec);
+    called = true;
+  });
+  ASSERT_TRUE(RunUntil(&io, [&]() { return called; }));
+  ASSERT_EQ(socket.State(), nekit::data_flow::State::Established);
+  ASSERT_EQ(pool.statistics().hits, 1);
+}
+
+TEST(TcpConnectionPoolUnitTest, TakeNewestTest) {
+  boost::asio::io_context io;
+  Server server{&io};
+  TcpConnectionPool pool{&io, nullptr, 2};
+  pool.Add("127.0.0.1", server.port());
+
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 2 &&
+           server.sockets().size() == 2;
+  }));
+
+  Endpoint endpoint{"127.0.0.1", server.port()};
+  tcp::socket first{io};
+  ASSERT_TRUE(pool.Take(endpoint, &first));
+
+  // The connection refilled after the take is newer than the one left.
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 2 &&
+           server.sockets().size() == 3;
+  }));
+  tcp::socket second{io};
+  ASSERT_TRUE(pool.Take(endpoint, &second));
+  ASSERT_EQ(second.local_endpoint(),
+            server.sockets().back().remote_endpoint());
+}
+
+TEST(TcpConnectionPoolUnitTest, TakeExpiredTest) {
+  boost::asio::io_context io;
+  Server server{&io};
+  TcpConnectionPool pool{&io, nullptr, 2};
+  pool.set_idle_timeout(std::chrono::milliseconds(200));
+  pool.Add("127.0.0.1", server.port());
+
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 2;
+  }));
+
+  // The sweep does not get a chance to run, `Take` has to check by itself.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  Endpoint endpoint{"127.0.0.1", server.port()};
+  tcp::socket socket{io};
+  ASSERT_FALSE(pool.Take(endpoint, &socket));
+  ASSERT_EQ(pool.statistics().expired, 2);
+  ASSERT_EQ(pool.statistics().misses, 1);
+}
+
+TEST(TcpConnectionPoolUnitTest, OpenFailureTest) {
+  boost::asio::io_context io;
+  Server server{&io};
+  TcpConnectionPool pool{&io, nullptr, 2};
+  // With options set the connector opens the socket by itself.
+  pool.set_tcp_options(std::make_shared<const TcpOptions>());
+  pool.set_idle_timeout(std::chrono::milliseconds(100));
+
+  // Run out of file descriptors so every connect fails right away.
+  int fd = dup(0);
+  close(fd);
+  rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  rlimit lowered = limit;
+  lowered.rlim_cur = fd;
+  setrlimit(RLIMIT_NOFILE, &lowered);
+
+  pool.Add("127.0.0.1", server.port());
+  io.run_for(std::chrono::milliseconds(100));
+  auto idle = pool.IdleCount("127.0.0.1", server.port());
+
+  setrlimit(RLIMIT_NOFILE, &limit);
+  ASSERT_EQ(idle, 0);
+
+  // The pool recovers in the next sweep.
+  ASSERT_TRUE(RunUntil(&io, [&]() {
+    return pool.IdleCount("127.0.0.1", server.port()) == 2;
+  }));
+}
@@ -0,0 +1,183 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "nekit/transport/error_code.h"
+#include "nekit/transport/tcp_connector.h"
+#include "nekit/utils/rotating_device.h"
+
+using namespace nekit::transport;
+using namespace nekit::utils;
+using namespace boost::asio::ip;
+
+namespace {
+// A loopback listener whose accept queue is full. The kernel drops further
+// SYNs, so connecting to it hangs like connecting to a blackholed address.
+class BlackholeListener {
+ public:
+  explicit BlackholeListener(boost::asio::io_context* io) : acceptor_{*io} {
+    acceptor_.open(tcp::v4());
+    acceptor_.bind({address_v4::loopback(), 0});
+    acceptor_.listen(0);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < 16 && !blackholed_; i++) {
+      int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      fds_.push_back(fd);
+      connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+      pollfd pfd{fd, POLLOUT, 0};
+      blackholed_ = !poll(&pfd, 1, 200);
+    }
+  }
+
+  ~BlackholeListener() {
+    for (int fd : fds_) {
+      close(fd);
+    }
+  }
+
+  bool blackholed() const { return blackholed_; }
+  uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+ private:
+  tcp::acceptor acceptor_;
+  std::vector<int> fds_;
+  bool blackholed_{false};
+};
+
+struct Result {
+  bool called{false};
+  std::error_code ec;
+  tcp::endpoint remote;
+};
+}  // namespace
+
+TEST(TcpConnectorUnitTest, AttemptTimeoutTest) {
+  boost::asio::io_context io;
+  BlackholeListener blackhole{&io};
+  ASSERT_TRUE(blackhole.blackholed());
+
+  // The accepting listener uses another loopback address with the same port
+  // so both addresses of the connector share `port`.
+  tcp::acceptor acceptor{io};
+  acceptor.open(tcp::v4());
+  acceptor.bind({address::from_string("127.0.0.2"), blackhole.port()});
+  acceptor.listen();
+
+  auto before = TcpConnector::GetStatistics();
+
+  TcpConnector connector{
+      std::make_shared<const std::vector<address>>(std::vector<address>{
+          address_v4::loopback(), address::from_string("127.0.0.2")}),
+      blackhole.port(), &io};
+  connector.set_attempt_timeout(std::chrono::milliseconds(100));
+  connector.set_connect_timeout(std::chrono::milliseconds(5000));
+
+  Result result;
+  auto cancelable =
+      connector.Connect([&result](tcp::socket&& socket, std::error_code ec) {
+        result.called = true;
+        result.ec = ec;
+        if (!ec) {
+          result.remote = socket.remote_endpoint();
+        }
+      });
+  io.run();
+
+  ASSERT_TRUE(result.called);
+  ASSERT_FALSE(result.ec);
+  ASSERT_EQ(result.remote.address(), address::from_string("127.0.0.2"));
+
+  auto after = TcpConnector::GetStatistics();
+  ASSERT_EQ(after.attempts - before.attempts, 2);
+  ASSERT_EQ(after.attempt_timeouts - before.attempt_timeouts, 1);
+  ASSERT_EQ(after.connected - before.connected, 1);
+  ASSERT_EQ(after.deadline_timeouts - before.deadline_timeouts, 0);
+}
+
+TEST(TcpConnectorUnitTest, DeadlineTest) {
+  boost::asio::io_context io;
+  BlackholeListener blackhole{&io};
+  ASSERT_TRUE(blackhole.blackholed());
+
+  auto before = TcpConnector::GetStatistics();
+
+  TcpConnector connector{address_v4::loopback(), blackhole.port(), &io};
+  connector.set_attempt_timeout(std::chrono::milliseconds(0));
+  connector.set_connect_timeout(std::chrono::milliseconds(100));
+
+  Result result;
+  auto start = std::chrono::steady_clock::now();
+  auto cancelable =
+      connector.Connect([&result](tcp::socket&&, std::error_code ec) {
+        result.called = true;
+        result.ec = ec;
+      });
+  io.run();
+
+  ASSERT_TRUE(result.called);
+  ASSERT_EQ(result.ec, ErrorCode::TimedOut);
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+  auto after = TcpConnector::GetStatistics();
+  ASSERT_EQ(after.attempts - before.attempts, 1);
+  ASSERT_EQ(after.deadline_timeouts - before.deadline_timeouts, 1);
+  ASSERT_EQ(after.attempt_timeouts - before.attempt_timeouts, 0);
+  ASSERT_EQ(after.connected - before.connected, 0);
+}
+
+TEST(TcpConnectorUnitTest, BindFailureTest) {
+  boost::asio::io_context io;
+
+  auto before = TcpConnector::GetStatistics();
+
+  // The address is reserved for documentation and not on any interface.
+  TcpConnector connector{address_v4::loopback(), 9, &io};
+  connector.Bind(std::make_shared<RotatingDevice>(
+      std::vector<address>{address::from_string("192.0.2.1")}));
+
+  Result result;
+  auto cancelable =
+      connector.Connect([&result](tcp::socket&&, std::error_code ec) {
+        result.called = true;
+        result.ec = ec;
+      });
+
+  // The failure is reported asynchronously like any other.
+  ASSERT_FALSE(result.called);
+  io.run();
+
+  ASSERT_TRUE(result.called);
+  ASSERT_TRUE(result.ec);
+
+  auto after = TcpConnector::GetStatistics();
+  ASSERT_EQ(after.attempts - before.attempts, 0);
+}
@@ -20,8 +20,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "nekit/utils/compact_trie.h"
 #include "nekit/utils/trie.h"
 
 using namespace nekit::utils;
@@ -48,3 +56,172 @@ TEST(TrieUnitTest, PrefixMatchTest) {
   EXPECT_FALSE(trie.MatchPrefixWith(","));
   EXPECT_FALSE(trie.MatchPrefixWith("aabbd"));
 }
+
+TEST(CompactTrieUnitTest, InputValidationTest) {
+  CompactTrie trie;
+  EXPECT_TRUE(trie.AddPrefix(".AZaz-109"));
+  EXPECT_FALSE(trie.AddPrefix(""));
+  EXPECT_FALSE(trie.AddPrefix("{"));
+  EXPECT_FALSE(trie.AddPrefix(","));
+  EXPECT_EQ(trie.entries().size(), 1u);
+}
+
+TEST(CompactTrieUnitTest, PrefixMatchTest) {
+  CompactTrie trie;
+  EXPECT_FALSE(trie.MatchPrefixWith("aabbcc"));
+
+  EXPECT_TRUE(trie.AddPrefix("aabbcc"));
+  EXPECT_TRUE(trie.AddPrefix("aabbdd"));
+  EXPECT_TRUE(trie.AddPrefix("aabbccee"));
+
+  EXPECT_TRUE(trie.MatchPrefixWith("aabbccdd"));
+  EXPECT_TRUE(trie.MatchPrefixWith("aabbdddee"));
+  EXPECT_TRUE(trie.MatchPrefixWith("aabbdd"));
+
+  EXPECT_FALSE(trie.MatchPrefixWith(""));
+  EXPECT_FALSE(trie.MatchPrefixWith("1"));
+  EXPECT_FALSE(trie.MatchPrefixWith("{"));
+  EXPECT_FALSE(trie.MatchPrefixWith(","));
+  EXPECT_FALSE(trie.MatchPrefixWith("aabbd"));
+
+  // Adding after a match builds the trie again.
+  EXPECT_TRUE(trie.AddPrefix("aab"));
+  EXPECT_TRUE(trie.MatchPrefixWith("aabbd"));
+  EXPECT_EQ(trie.node_count(), 4u);
+}
+
+TEST(CompactTrieUnitTest, SuffixMatchTest) {
+  CompactTrie trie(true);
+  EXPECT_TRUE(trie.AddPrefix(".google.com"));
+  EXPECT_TRUE(trie.AddPrefix("facebook.com"));
+
+  EXPECT_TRUE(trie.MatchPrefixWith("www.google.com"));
+  EXPECT_TRUE(trie.MatchPrefixWith("facebook.com"));
+  EXPECT_TRUE(trie.MatchPrefixWith("m.facebook.com"));
+
+  EXPECT_FALSE(trie.MatchPrefixWith("google.com"));
+  EXPECT_FALSE(trie.MatchPrefixWith("www.google.com.hk"));
+  EXPECT_FALSE(trie.MatchPrefixWith("acebook.com"));
+}
+
+TEST(CompactTrieUnitTest, AgreesWithTrieTest) {
+  DomainTrie<> trie;
+  CompactTrie compact_trie;
+  const std::vector<std::string> prefixes{"a", "abc", "b-c", "bd", "b.e",
+                                          "zz", "z9", "Z"};
+  for (const auto& prefix : prefixes) {
+    trie.AddPrefix(prefix);
+    compact_trie.AddPrefix(prefix);
+  }
+  for (const std::string literal :
+       {"a", "ab", "b", "b-", "b-c", "bdd", "b.", "b.ef", "z", "zz", "z9x",
+        "Za", "c", "-"}) {
+    EXPECT_EQ(compact_trie.MatchPrefixWith(literal),
+              trie.MatchPrefixWith(literal))
+        << literal;
+  }
+}
+
+TEST(CompactTrieUnitTest, LowestValueTest) {
+  CompactTrie trie{true};
+  trie.AddPrefix("com", 5);
+  trie.AddPrefix("example.com", 3);
+  trie.AddPrefix("a.example.com", 1);
+  trie.AddPrefix("a.example.com", 2);
+  // Extends a string with a lower value, never decides a match.
+  trie.AddPrefix("b.example.com", 4);
+  trie.Build();
+
+  EXPECT_EQ(trie.MatchLowest("a.example.com"), 1u);
+  EXPECT_EQ(trie.MatchLowest("x.a.example.com"), 1u);
+  EXPECT_EQ(trie.MatchLowest("b.example.com"), 3u);
+  EXPECT_EQ(trie.MatchLowest("example.com"), 3u);
+  EXPECT_EQ(trie.MatchLowest("other.com"), 5u);
+  EXPECT_EQ(trie.MatchLowest("other.org"), CompactTrie::kNoValue);
+  EXPECT_EQ(trie.MatchLowest(""), CompactTrie::kNoValue);
+  EXPECT_TRUE(trie.MatchPrefixWith("a.example.com"));
+  EXPECT_FALSE(trie.MatchPrefixWith("other.org"));
+  EXPECT_GT(trie.memory_usage(), trie.node_count() * 9);
+
+  // Without values every string is 0 and extensions are left out.
+  CompactTrie plain{true};
+  plain.AddPrefix("com");
+  plain.AddPrefix("example.com");
+  plain.Build();
+  EXPECT_EQ(plain.node_count(), 4u);
+  EXPECT_EQ(plain.MatchLowest("example.com"), 0u);
+
+  // The extensions are kept in a saved trie and recovered after mapping it.
+  std::string saved;
+  trie.Save(&saved);
+  auto buffer = std::make_shared<std::vector<uint64_t>>(saved.size() / 8 + 1);
+  std::memcpy(buffer->data(), saved.data(), saved.size());
+  CompactTrie mapped{true};
+  ASSERT_TRUE(mapped.Map(buffer->data(), saved.size(), buffer));
+  EXPECT_EQ(mapped.MatchLowest("a.example.com"), 0u);
+  mapped.AddPrefix("org");
+  auto entries = mapped.entries();
+  std::sort(entries.begin(), entries.end());
+  EXPECT_EQ(entries, (std::vector<std::string>{"a.example.com", "com",
+                                               "example.com", "org"}));
+}
+
+TEST(CompactTrieUnitTest, SaveMapTest) {
+  CompactTrie trie{true};
+  trie.AddPrefix("a.com");
+  trie.AddPrefix("b.org");
+  trie.AddPrefix("x.b.org");
+  std::string saved;
+  trie.Save(&saved);
+
+  auto buffer = std::make_shared<std::vector<uint64_t>>(saved.size() / 8 + 1);
+  std::memcpy(buffer->data(), saved.data(), saved.size());
+
+  CompactTrie prefixes;
+  EXPECT_FALSE(prefixes.Map(buffer->data(), saved.size(), buffer));
+
+  CompactTrie mapped{true};
+  ASSERT_TRUE(mapped.Map(buffer->data(), saved.size(), buffer));
+  EXPECT_TRUE(mapped.mapped());
+  EXPECT_TRUE(mapped.MatchPrefixWith("www.a.com"));
+  EXPECT_TRUE(mapped.MatchPrefixWith("b.org"));
+  EXPECT_FALSE(mapped.MatchPrefixWith("a.org"));
+  EXPECT_TRUE(mapped.entries().empty());
+
+  // The strings are recovered from the nodes, without the extension.
+  mapped.AddPrefix("c.net");
+  auto entries = mapped.entries();
+  std::sort(entries.begin(), entries.end());
+  EXPECT_EQ(entries, (std::vector<std::string>{"a.com", "b.org", "c.net"}));
+  EXPECT_TRUE(mapped.MatchPrefixWith("c.net"));
+  EXPECT_TRUE(mapped.MatchPrefixWith("a.com"));
+  EXPECT_FALSE(mapped.mapped());
+
+  EXPECT_FALSE(mapped.Map(buffer->data(), saved.size() - 1, buffer));
+  // Set `end` of the second node to something other than 0 or 1.
+  reinterpret_cast<char*>(buffer->data())[8 + 8 + 6] = 2;
+  CompactTrie invalid{true};
+  EXPECT_FALSE(invalid.Map(buffer->data(), saved.size(), buffer));
+  EXPECT_FALSE(invalid.mapped());
+}
+
+TEST(CompactTrieUnitTest, MatchesFromThreads) {
+  CompactTrie trie{true};
+  for (int i = 0; i < 100; i++) {
+    trie.AddPrefix("d" + std::to_string(i) + ".com");
+  }
+  trie.Build();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&trie]() {
+      for (int j = 0; j < 200; j++) {
+        EXPECT_EQ(trie.MatchPrefixWith("www.d" + std::to_string(j) + ".com"),
+                  j < 100);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
@@ -0,0 +1,222 @@
+// MIT License
+
+// Copyright (c) 2018 Zhuhao Wang
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compiles text rule lists into a rule set image, see `rule::RuleSetImage`.
+// Each list is given as `KIND:NAME=FILE` and loaded by the rule of that kind
+// with `Load(image, NAME)`:
+//
+//   domains   `DomainRule`, a domain per line, matching itself only, or
+//             matching its subdomains too if it starts with a dot.
+//   prefixes  `DomainPrefixRule`, a prefix per line.
+//   suffixes  `DomainSuffixRule`, a suffix per line.
+//   subnets   `SubnetRule`, an address with an optional `/prefix` per line.
+//   regexes   `DomainRegexRule`, an expression per line.
+//
+// Empty lines and lines starting with `#` are skipped, as is the space around
+// an entry.
+//
+// rule_compiler OUTPUT KIND:NAME=FILE...
+
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+
+#include "nekit/rule/rule_set_image.h"
+#include "nekit/utils/compact_trie.h"
+#include "nekit/utils/domain_set.h"
+#include "nekit/utils/subnet_tree.h"
+
+using namespace nekit;
+
+namespace {
+std::string Trim(const std::string& line) {
+  const char* space = " \t\r\n";
+  size_t begin = line.find_first_not_of(space);
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  return line.substr(begin, line.find_last_not_of(space) - begin + 1);
+}
+
+// Calls `add(entry)` for each entry of `path`, which returns `false` if the
+// entry is invalid.
+template <typename Adder>
+bool ReadList(const std::string& path, Adder add, size_t* count) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Can not open " << path << "." << std::endl;
+    return false;
+  }
+
+  std::string line;
+  for (size_t number = 1; std::getline(file, line); number++) {
+    std::string entry = Trim(line);
+    if (entry.empty() || entry[0] == '#') {
+      continue;
+    }
+    if (!add(entry)) {
+      std::cerr << path << ":" << number << ": invalid entry \"" << entry
+                << "\"." << std::endl;
+      return false;
+    }
+    ++*count;
+  }
+  return true;
+}
+
+bool ParseSubnet(const std::string& entry, boost::asio::ip::address* address,
+                 unsigned* prefix) {
+  size_t slash = entry.find('/');
+  boost::system::error_code ec;
+  *address = boost::asio::ip::make_address(entry.substr(0, slash), ec);
+  if (ec) {
+    return false;
+  }
+
+  unsigned max_prefix = address->is_v4() ? 32 : 128;
+  if (slash == std::string::npos) {
+    *prefix = max_prefix;
+    return true;
+  }
+  std::string digits = entry.substr(slash + 1);
+  if (digits.empty() || digits.size() > 3 ||
+      digits.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  *prefix = unsigned(std::stoul(digits));
+  return *prefix <= max_prefix;
+}
+
+bool Compile(const std::string& kind, const std::string& name,
+             const std::string& path, rule::RuleSetImage::Builder* builder) {
+  size_t count = 0;
+  if (kind == "domains") {
+    utils::DomainSet domains;
+    if (!ReadList(path,
+                  [&domains](const std::string& entry) {
+                    bool suffix = entry[0] == '.';
+                    std::string domain = entry.substr(suffix);
+                    if (domain.empty() || domain.size() > 255) {
+                      return false;
+                    }
+                    if (suffix) {
+                      domains.AddSuffix(domain);
+                    } else {
+                      domains.AddDomain(domain);
+                    }
+                    return true;
+                  },
+                  &count)) {
+      return false;
+    }
+    builder->AddDomains(name, domains);
+  } else if (kind == "prefixes" || kind == "suffixes") {
+    utils::CompactTrie trie(kind == "suffixes");
+    if (!ReadList(path,
+                  [&trie](const std::string& entry) {
+                    return trie.AddPrefix(entry);
+                  },
+                  &count)) {
+      return false;
+    }
+    builder->AddTrie(name, &trie);
+  } else if (kind == "subnets") {
+    utils::SubnetTree subnets;
+    if (!ReadList(path,
+                  [&subnets](const std::string& entry) {
+                    boost::asio::ip::address address;
+                    unsigned prefix;
+                    if (!ParseSubnet(entry, &address, &prefix)) {
+                      return false;
+                    }
+                    subnets.Insert(address, prefix);
+                    return true;
+                  },
+                  &count)) {
+      return false;
+    }
+    subnets.ShrinkToFit();
+    builder->AddSubnets(name, subnets);
+  } else if (kind == "regexes") {
+    std::vector<std::string> expressions;
+    if (!ReadList(path,
+                  [&expressions](const std::string& entry) {
+                    // Rejected here rather than when the image is loaded.
+                    try {
+                      std::regex(entry, std::regex::ECMAScript);
+                    } catch (const std::regex_error&) {
+                      return false;
+                    }
+                    expressions.push_back(entry);
+                    return true;
+                  },
+                  &count)) {
+      return false;
+    }
+    builder->AddRegexes(name, expressions);
+  } else {
+    std::cerr << "Unknown list kind " << kind << "." << std::endl;
+    return false;
+  }
+
+  std::cout << name << ": " << count << " " << kind << " from " << path
+            << std::endl;
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " OUTPUT KIND:NAME=FILE..."
+              << std::endl;
+    return 2;
+  }
+
+  rule::RuleSetImage::Builder builder;
+  for (int i = 2; i < argc; i++) {
+    std::string list = argv[i];
+    size_t colon = list.find(':'), equal = list.find('=');
+    if (colon == std::string::npos || equal == std::string::npos ||
+        equal < colon || equal == colon + 1) {
+      std::cerr << "Invalid list " << list << ", expecting KIND:NAME=FILE."
+                << std::endl;
+      return 2;
+    }
+    if (!Compile(list.substr(0, colon),
+                 list.substr(colon + 1, equal - colon - 1),
+                 list.substr(equal + 1), &builder)) {
+      return 1;
+    }
+  }
+
+  auto ec = builder.Write(argv[1]);
+  if (ec) {
+    std::cerr << "Can not write " << argv[1] << ": " << ec.message() << "."
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}